@@ -0,0 +1,355 @@
+// Micro-benchmarks for the src/simd kernels, run directly on raw buffers
+// (no Python, no per-call allocation) over a sweep of working-set sizes
+// from L1 to DRAM and both float types.
+//
+//   capnhook_bench [--out results.json] [--baseline baseline.json]
+//                  [--threshold 0.10] [--max-bytes 134217728]
+//                  [--min-time-ms 50] [--filter name] [--stores 100000000]
+//
+// Each result reports ns/element, GB/s and GFLOP/s, plus the fraction of
+// the streaming bandwidth measured at the same size (a triad over buffers
+// of the same footprint), which is the roofline for these memory-bound
+// kernels. The JSON has one result per line so that two runs diff cleanly;
+// with --baseline, results slower than the baseline by more than the
+// threshold are listed and the exit status is 1.
+//
+// exp, log, sin and cos also run with the reduced precision tiers of
+// simd/approx.hpp (exp_fast, exp_fastest, ...).
+//
+// --stores N adds an add over N elements per dtype with cached stores,
+// non-temporal stream stores and misaligned inputs (add_cached,
+// add_stream, add_unaligned), to show the store-path gain on arrays past
+// the last-level cache. It needs 3 * N elements of memory per dtype.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "simd/binary.hpp"
+#include "simd/unary.hpp"
+#include "simd/reduce.hpp"
+#include "simd/linalg.hpp"
+#include "simd/random.hpp"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+volatile double g_sink = 0.0;
+
+struct Options {
+    std::string out;
+    std::string baseline;
+    std::string filter;
+    double threshold = 0.10;
+    size_t max_bytes = size_t(128) << 20;
+    double min_time_ms = 50.0;
+    size_t stores_n = 0;
+};
+
+// Median ns per call. The repetition count is doubled until one sample
+// takes at least 100 us, then samples are collected for min_time_ms.
+template <typename F>
+double time_ns(F&& fn, double min_time_ms) {
+    auto run = [&](size_t reps) {
+        const auto t0 = clock_type::now();
+        for (size_t r = 0; r < reps; ++r) fn();
+        return std::chrono::duration<double, std::nano>(clock_type::now() - t0).count();
+    };
+    size_t reps = 1;
+    fn();  // warm caches and page in buffers
+    while (run(reps) < 1e5 && reps < (size_t(1) << 24)) reps *= 2;
+
+    std::vector<double> samples;
+    const auto deadline = clock_type::now() +
+        std::chrono::duration<double, std::milli>(min_time_ms);
+    while (samples.size() < 5 || (clock_type::now() < deadline && samples.size() < 200))
+        samples.push_back(run(reps) / double(reps));
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+struct Result {
+    std::string kernel;
+    std::string dtype;
+    size_t n;
+    double bytes;       // bytes moved per call
+    double flops;       // floating point operations per call
+    double ns;          // median ns per call
+    double peak_gbs;    // streaming bandwidth at the same footprint
+};
+
+// a benchmarked kernel: bytes and flops per element, and the call itself
+template <typename T>
+struct Case {
+    std::string name;
+    double bytes_per_elem;
+    double flops_per_elem;
+    std::function<void(T* a, T* b, T* c, size_t n)> fn;
+};
+
+// a unary op evaluated with the kernels of one precision tier
+template <typename T, typename Op, precision::Mode P>
+void tiered_n(const T* a, T* c, size_t n) {
+    Op op;
+    capnhook::elementwise_n<T>(c, n, [&](auto d, auto v) { return op.template at<P>(d, v); }, a);
+}
+
+// name_fast and name_fastest cases for a tiered unary op
+template <typename T, typename Op>
+void add_tiers(std::vector<Case<T>>& cases, const std::string& name) {
+    const double s = double(sizeof(T));
+    cases.push_back({ name + "_fast", 2 * s, 1,
+                      [](T* a, T*, T* c, size_t n) { tiered_n<T, Op, precision::Mode::Fast>(a, c, n); } });
+    cases.push_back({ name + "_fastest", 2 * s, 1,
+                      [](T* a, T*, T* c, size_t n) { tiered_n<T, Op, precision::Mode::Fastest>(a, c, n); } });
+}
+
+template <typename T>
+std::vector<Case<T>> make_cases() {
+    using namespace capnhook;
+    const double s = double(sizeof(T));
+    std::vector<Case<T>> cases;
+    // binary: two reads, one write
+    cases.push_back({ "add", 3 * s, 1, [](T* a, T* b, T* c, size_t n) { binary_n<T, addOp>(a, b, c, n); } });
+    cases.push_back({ "sub", 3 * s, 1, [](T* a, T* b, T* c, size_t n) { binary_n<T, subOp>(a, b, c, n); } });
+    cases.push_back({ "mul", 3 * s, 1, [](T* a, T* b, T* c, size_t n) { binary_n<T, mulOp>(a, b, c, n); } });
+    cases.push_back({ "div", 3 * s, 1, [](T* a, T* b, T* c, size_t n) { binary_n<T, divOp>(a, b, c, n); } });
+    // unary: one read, one write; transcendental calls count as one op
+    cases.push_back({ "exp", 2 * s, 1, [](T* a, T*, T* c, size_t n) { unary_n<T, expOp>(a, c, n); } });
+    cases.push_back({ "log", 2 * s, 1, [](T* a, T*, T* c, size_t n) { unary_n<T, logOp>(a, c, n); } });
+    cases.push_back({ "sqrt", 2 * s, 1, [](T* a, T*, T* c, size_t n) { unary_n<T, sqrtOp>(a, c, n); } });
+    cases.push_back({ "sin", 2 * s, 1, [](T* a, T*, T* c, size_t n) { unary_n<T, sinOp>(a, c, n); } });
+    cases.push_back({ "cos", 2 * s, 1, [](T* a, T*, T* c, size_t n) { unary_n<T, cosOp>(a, c, n); } });
+    cases.push_back({ "asin", 2 * s, 1, [](T* a, T*, T* c, size_t n) { unary_n<T, asinOp>(a, c, n); } });
+    cases.push_back({ "acos", 2 * s, 1, [](T* a, T*, T* c, size_t n) { unary_n<T, acosOp>(a, c, n); } });
+    add_tiers<T, expOp>(cases, "exp");
+    add_tiers<T, logOp>(cases, "log");
+    add_tiers<T, sinOp>(cases, "sin");
+    add_tiers<T, cosOp>(cases, "cos");
+    // reductions: one read
+    cases.push_back({ "reduce_sum", s, 1, [](T* a, T*, T*, size_t n) { g_sink = double(reduce_sum_n<T>(a, n)); } });
+    cases.push_back({ "reduce_min", s, 1, [](T* a, T*, T*, size_t n) { g_sink = double(reduce_min_n<T>(a, n)); } });
+    cases.push_back({ "reduce_max", s, 1, [](T* a, T*, T*, size_t n) { g_sink = double(reduce_max_n<T>(a, n)); } });
+    cases.push_back({ "reduce_prod", s, 1, [](T* a, T*, T*, size_t n) { g_sink = double(reduce_prod_n<T>(a, n)); } });
+    cases.push_back({ "reduce_mean", s, 1, [](T* a, T*, T*, size_t n) { g_sink = double(reduce_mean_n<T>(a, n)); } });
+    cases.push_back({ "reduce_var", 2 * s, 3, [](T* a, T*, T*, size_t n) { g_sink = double(reduce_var_n<T>(a, n)); } });
+    cases.push_back({ "reduce_all", s, 1, [](T* a, T*, T*, size_t n) { g_sink = double(reduce_all_n<T>(a, n)); } });
+    cases.push_back({ "argmax", s, 1, [](T* a, T*, T*, size_t n) { g_sink = double(argmax_n<T>(a, n)); } });
+    cases.push_back({ "argmin", s, 1, [](T* a, T*, T*, size_t n) { g_sink = double(argmin_n<T>(a, n)); } });
+    cases.push_back({ "cumsum", 2 * s, 1, [](T* a, T*, T* c, size_t n) { cumsum_n<T>(a, c, n); } });
+    cases.push_back({ "cumprod", 2 * s, 1, [](T* a, T*, T* c, size_t n) { cumprod_n<T>(a, c, n); } });
+    // linear algebra
+    cases.push_back({ "dot", 2 * s, 2, [](T* a, T* b, T*, size_t n) { g_sink = double(dot_n<T>(a, b, n)); } });
+    cases.push_back({ "sq_dist", 2 * s, 3, [](T* a, T* b, T*, size_t n) { g_sink = double(sq_dist_n<T>(a, b, n)); } });
+    // random numbers: one write (generation runs across threads)
+    cases.push_back({ "random_uniform", s, 0, [](T*, T*, T* c, size_t n) {
+        fill_random<T>(c, n, Dist::Uniform, T(0), T(1), 1, 0); } });
+    cases.push_back({ "random_normal", s, 0, [](T*, T*, T* c, size_t n) {
+        fill_random<T>(c, n, Dist::Normal, T(0), T(1), 1, 0); } });
+    return cases;
+}
+
+// a[i] = b[i] + s * c[i]: the streaming reference for each footprint, run
+// through the same driver (threads, store path) as the elementwise kernels
+template <typename T>
+double triad_gbs(T* a, const T* b, const T* c, size_t n, double min_time_ms) {
+    namespace hn = hwy::HWY_NAMESPACE;
+    const double ns = time_ns([&] {
+        hn::capnhook::elementwise_n(a, n, [](auto d, auto x, auto y) {
+            return hn::MulAdd(hn::Set(d, T(0.5)), y, x);
+        }, b, c);
+    }, min_time_ms);
+    return 3.0 * double(n * sizeof(T)) / ns;
+}
+
+template <typename T>
+T* alloc_filled(size_t n, T lo, T hi, unsigned seed) {
+    T* p = static_cast<T*>(aligned_alloc64(std::max<size_t>(n, 1) * sizeof(T)));
+    unsigned x = seed;
+    for (size_t i = 0; i < n; ++i) {
+        x = x * 1664525u + 1013904223u;
+        p[i] = lo + (hi - lo) * T(double(x >> 8) / double(1u << 24));
+    }
+    return p;
+}
+
+template <typename T>
+void run_dtype(const char* dtype, const Options& opt, std::vector<Result>& out) {
+    const size_t max_n = opt.max_bytes / sizeof(T);
+    // inputs stay inside every kernel's domain (log, asin, acos, div)
+    T* a = alloc_filled<T>(max_n, T(0.1), T(0.9), 1);
+    T* b = alloc_filled<T>(max_n, T(0.1), T(0.9), 2);
+    T* c = alloc_filled<T>(max_n, T(0.1), T(0.9), 3);
+
+    std::vector<size_t> sizes;
+    for (size_t bytes = size_t(4) << 10; bytes <= opt.max_bytes; bytes *= 4)
+        sizes.push_back(bytes / sizeof(T));
+
+    const auto cases = make_cases<T>();
+    for (size_t n : sizes) {
+        const double peak = triad_gbs(c, a, b, n, opt.min_time_ms);
+        for (const auto& k : cases) {
+            if (!opt.filter.empty() && k.name.find(opt.filter) == std::string::npos) continue;
+            const double ns = time_ns([&] { k.fn(a, b, c, n); }, opt.min_time_ms);
+            out.push_back({ k.name, dtype, n, k.bytes_per_elem * double(n),
+                            k.flops_per_elem * double(n), ns, peak });
+        }
+        // matmul on the largest square operands whose three matrices fit
+        const size_t dim = size_t(std::sqrt(double(n)));
+        if (dim >= 8 && (opt.filter.empty() || std::string("matmul").find(opt.filter) != std::string::npos)) {
+            const double ns = time_ns([&] {
+                capnhook::gemm<T>(false, false, dim, dim, dim, T(1), a, dim, b, dim, T(0), c, dim);
+            }, opt.min_time_ms);
+            const double d3 = double(dim) * double(dim) * double(dim);
+            out.push_back({ "matmul", dtype, dim * dim, 3.0 * double(dim * dim * sizeof(T)),
+                            2.0 * d3, ns, peak });
+        }
+    }
+    free(a);
+    free(b);
+    free(c);
+}
+
+// add over n elements with each store path; GB/s counts the 3 useful
+// bytes per element, so cached stores pay their read-for-ownership here
+template <typename T>
+void run_stores(const char* dtype, const Options& opt, std::vector<Result>& out) {
+    using namespace capnhook;
+    const size_t n = opt.stores_n;
+    // one spare element so the misaligned case stays in bounds
+    T* a = alloc_filled<T>(n + 1, T(0.1), T(0.9), 1);
+    T* b = alloc_filled<T>(n + 1, T(0.1), T(0.9), 2);
+    T* c = alloc_filled<T>(n, T(0.1), T(0.9), 3);
+    const double peak = triad_gbs(c, a, b, n, opt.min_time_ms);
+    const double bytes = 3.0 * double(n * sizeof(T));
+
+    const double cached = time_ns([&] { binary_n<T, addOp, Stores::Cached>(a, b, c, n); }, opt.min_time_ms);
+    const double stream = time_ns([&] { binary_n<T, addOp, Stores::Stream>(a, b, c, n); }, opt.min_time_ms);
+    const double unaligned = time_ns([&] { binary_n<T, addOp>(a + 1, b + 1, c, n); }, opt.min_time_ms);
+    out.push_back({ "add_cached", dtype, n, bytes, double(n), cached, peak });
+    out.push_back({ "add_stream", dtype, n, bytes, double(n), stream, peak });
+    out.push_back({ "add_unaligned", dtype, n, bytes, double(n), unaligned, peak });
+    std::fprintf(stderr, "add %s n=%zu: cached %.2f GB/s, stream %.2f GB/s (%+.1f%%), unaligned inputs %.2f GB/s\n",
+                 dtype, n, bytes / cached, bytes / stream, 100.0 * (cached / stream - 1.0), bytes / unaligned);
+    free(a);
+    free(b);
+    free(c);
+}
+
+std::string to_json(const std::vector<Result>& results) {
+    std::ostringstream os;
+    os << "{\n  \"target\": \"" << hwy::TargetName(HWY_TARGET) << "\",\n  \"results\": [\n";
+    char line[512];
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const double gbs = r.bytes / r.ns;
+        std::snprintf(line, sizeof(line),
+            "    {\"kernel\": \"%s\", \"dtype\": \"%s\", \"n\": %zu, \"ns_per_elem\": %.6g, "
+            "\"gbs\": %.4g, \"gflops\": %.4g, \"peak_gbs\": %.4g, \"peak_frac\": %.3f}%s\n",
+            r.kernel.c_str(), r.dtype.c_str(), r.n, r.ns / double(r.n), gbs,
+            r.flops / r.ns, r.peak_gbs, gbs / r.peak_gbs, i + 1 < results.size() ? "," : "");
+        os << line;
+    }
+    os << "  ]\n}\n";
+    return os.str();
+}
+
+// Reads the per-line results written by to_json: (kernel, dtype, n) ->
+// ns_per_elem. Not a general JSON parser.
+std::map<std::tuple<std::string, std::string, size_t>, double>
+read_baseline(const std::string& path) {
+    std::map<std::tuple<std::string, std::string, size_t>, double> base;
+    std::ifstream in(path);
+    if (!in) {
+        std::fprintf(stderr, "capnhook_bench: cannot read baseline %s\n", path.c_str());
+        std::exit(2);
+    }
+    auto field = [](const std::string& line, const std::string& key) {
+        const size_t p = line.find("\"" + key + "\": ");
+        if (p == std::string::npos) return std::string();
+        size_t b = p + key.size() + 4;
+        if (line[b] == '"') {
+            ++b;
+            return line.substr(b, line.find('"', b) - b);
+        }
+        return line.substr(b, line.find_first_of(",}", b) - b);
+    };
+    std::string line;
+    while (std::getline(in, line)) {
+        const std::string kernel = field(line, "kernel");
+        if (kernel.empty()) continue;
+        base[{ kernel, field(line, "dtype"), std::stoull(field(line, "n")) }] =
+            std::stod(field(line, "ns_per_elem"));
+    }
+    return base;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "capnhook_bench: %s needs a value\n", arg.c_str());
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--out") opt.out = next();
+        else if (arg == "--baseline") opt.baseline = next();
+        else if (arg == "--threshold") opt.threshold = std::stod(next());
+        else if (arg == "--max-bytes") opt.max_bytes = std::stoull(next());
+        else if (arg == "--min-time-ms") opt.min_time_ms = std::stod(next());
+        else if (arg == "--filter") opt.filter = next();
+        else if (arg == "--stores") opt.stores_n = std::stoull(next());
+        else {
+            std::fprintf(stderr, "capnhook_bench: unknown argument %s\n", arg.c_str());
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    run_dtype<float>("float32", opt, results);
+    run_dtype<double>("float64", opt, results);
+    if (opt.stores_n) {
+        run_stores<float>("float32", opt, results);
+        run_stores<double>("float64", opt, results);
+    }
+
+    const std::string json = to_json(results);
+    if (opt.out.empty()) {
+        std::fputs(json.c_str(), stdout);
+    } else {
+        std::ofstream(opt.out) << json;
+    }
+
+    if (opt.baseline.empty()) return 0;
+    const auto base = read_baseline(opt.baseline);
+    int regressions = 0;
+    for (const Result& r : results) {
+        auto it = base.find({ r.kernel, r.dtype, r.n });
+        if (it == base.end()) continue;
+        const double now = r.ns / double(r.n);
+        if (now > it->second * (1.0 + opt.threshold)) {
+            std::fprintf(stderr, "REGRESSION %-16s %-8s n=%-10zu %.4g -> %.4g ns/elem (+%.1f%%)\n",
+                         r.kernel.c_str(), r.dtype.c_str(), r.n, it->second, now,
+                         100.0 * (now / it->second - 1.0));
+            ++regressions;
+        }
+    }
+    std::fprintf(stderr, "%d regression(s) against %s\n", regressions, opt.baseline.c_str());
+    return regressions ? 1 : 0;
+}
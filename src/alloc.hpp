@@ -2,8 +2,10 @@
 #include <cstddef>
 #include <cstdlib>
 #include <new>
+#include "profile.hpp"
 
 inline void* aligned_alloc64(size_t bytes) {
+    profile::on_alloc(bytes);
     void* ptr = nullptr;
 #if defined(_MSC_VER)
     ptr = _aligned_malloc(bytes, 64);
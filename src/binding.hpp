@@ -0,0 +1,93 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <nanobind/nanobind.h>
+
+#include "interop.hpp"
+#include "profile.hpp"
+
+namespace nb = nanobind;
+
+namespace binding {
+
+// function type of a pointer or a lambda, as a null function pointer used
+// only to deduce R and Args
+template <typename R, typename... Args>
+constexpr R (*signature(R (*)(Args...)))(Args...) { return nullptr; }
+
+template <typename C, typename R, typename... Args>
+constexpr R (*signature_of_call(R (C::*)(Args...) const))(Args...) { return nullptr; }
+
+template <typename F>
+constexpr auto signature(const F&) -> decltype(signature_of_call(&F::operator())) {
+    return nullptr;
+}
+
+template <typename R, typename... Args>
+constexpr bool returns_array(R (*)(Args...)) { return interop::has_array<R>::value; }
+
+template <typename R, typename... Args>
+constexpr bool takes_array(R (*)(Args...)) { return (interop::takes_array<std::decay_t<Args>>::value || ...); }
+
+// array arguments are converted through interop::Input, which also
+// records the framework they came from
+template <typename A>
+using input_t = std::conditional_t<interop::takes_array<std::decay_t<A>>::value, interop::Input<std::decay_t<A>>, A>;
+
+template <typename A, typename X>
+decltype(auto) unwrap(X& x) {
+    if constexpr (!interop::takes_array<std::decay_t<A>>::value) return std::forward<A>(x);
+    else if constexpr (std::is_lvalue_reference_v<A>) return (x.value);
+    else return std::move(x.value);
+}
+
+// wraps f : R(Args...) so that arrays in its result are exported to the
+// framework of its first array argument (or the set_framework override);
+// nested calls back into capnhook see their own arguments
+template <typename R, typename... Args, typename F>
+auto exporting(F f, R (*)(Args...)) {
+    return [f](input_t<Args>... args) -> std::conditional_t<interop::has_array<R>::value, nb::object, R> {
+        std::optional<interop::Framework> source;
+        (interop::note_source(source, args), ...);
+        interop::SourceScope scope(source);
+        if constexpr (interop::has_array<R>::value)
+            return interop::export_value(f(unwrap<Args>(args)...));
+        else
+            return f(unwrap<Args>(args)...);
+    };
+}
+
+// nanobind module handle whose def() adds the profiling wrapper and, for
+// functions taking or returning arrays, the framework export; scope
+// prefixes the names of ops in submodules ("random.")
+class module {
+public:
+    explicit module(nb::module_ m, std::string scope = "") : m_(m), scope_(std::move(scope)) {}
+
+    template <typename F, typename... Extra>
+    module& def(const char* name, F f, const Extra&... extra) {
+#if CAPNHOOK_ENABLE_PROFILING
+        auto g = profile::instrument(profile::slot(scope_ + name), f, signature(f));
+#else
+        auto g = f;
+#endif
+        constexpr auto sig = decltype(signature(f))(nullptr);
+        if constexpr (returns_array(sig) || takes_array(sig))
+            m_.def(name, exporting(g, signature(f)), extra...);
+        else
+            m_.def(name, g, extra...);
+        return *this;
+    }
+
+    module def_submodule(const char* name, const char* doc) {
+        return module(m_.def_submodule(name, doc), scope_ + name + ".");
+    }
+
+private:
+    nb::module_ m_;
+    std::string scope_;
+};
+
+} // binding
@@ -0,0 +1,309 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+#include "alloc.hpp"
+#include "interop.hpp"
+#include "simd/binary.hpp"
+#include "simd/unary.hpp"
+#include "simd/reduce.hpp"
+#include "simd/linalg.hpp"
+
+namespace nb = nanobind;
+
+// Low-overhead entry points for the elementwise, reduction and index ops,
+// which are dominated by call overhead below ~10k elements. Each op is
+// registered once, ahead of its float/double overloads, taking an array
+// of any dtype and switching on the dtype code; arrays that need a
+// conversion fall through to the typed overloads via nb::next_overload.
+// batch() runs a list of ops in a single call into C++.
+namespace fastpath {
+
+using Array = nb::ndarray<nb::c_contig, nb::device::cpu>;
+
+// Scan is a unary kernel over the flattened array, with a 1-D result
+enum class Kind { Binary, Unary, Scan, Reduce, Predicate, Index, Dot };
+
+// pointer-level kernels of one op for one float type; only the member
+// matching the op's Kind is set
+template <typename T>
+struct Kernels {
+    void (*binary)(const T*, const T*, T*, size_t) = nullptr;
+    void (*unary)(const T*, T*, size_t) = nullptr;
+    T (*reduce)(const T*, size_t) = nullptr;
+    bool (*predicate)(const T*, size_t) = nullptr;
+    size_t (*index)(const T*, size_t) = nullptr;
+    T (*dot)(const T*, const T*, size_t) = nullptr;
+};
+
+struct FastOp {
+    Kind kind;
+    Kernels<float> f32;
+    Kernels<double> f64;
+};
+
+template <typename Op>
+FastOp binary_op() {
+    FastOp op{ Kind::Binary, {}, {} };
+    op.f32.binary = &capnhook::binary_n<float, Op>;
+    op.f64.binary = &capnhook::binary_n<double, Op>;
+    return op;
+}
+
+template <typename Op>
+FastOp unary_op() {
+    FastOp op{ Kind::Unary, {}, {} };
+    op.f32.unary = &capnhook::unary_n<float, Op>;
+    op.f64.unary = &capnhook::unary_n<double, Op>;
+    return op;
+}
+
+// name -> kernels for every op with a fast path
+inline const std::unordered_map<std::string, FastOp>& table() {
+    using namespace capnhook;
+    static const std::unordered_map<std::string, FastOp> t = [] {
+        std::unordered_map<std::string, FastOp> m;
+        m["add"] = binary_op<addOp>();
+        m["sub"] = binary_op<subOp>();
+        m["mul"] = binary_op<mulOp>();
+        m["div"] = binary_op<divOp>();
+        m["exp"] = unary_op<expOp>();
+        m["log"] = unary_op<logOp>();
+        m["sqrt"] = unary_op<sqrtOp>();
+        m["sin"] = unary_op<sinOp>();
+        m["cos"] = unary_op<cosOp>();
+        m["asin"] = unary_op<asinOp>();
+        m["acos"] = unary_op<acosOp>();
+
+        FastOp scan{ Kind::Scan, {}, {} };
+        scan.f32.unary = &cumsum_n<float>;
+        scan.f64.unary = &cumsum_n<double>;
+        m["cumsum"] = scan;
+        scan.f32.unary = &cumprod_n<float>;
+        scan.f64.unary = &cumprod_n<double>;
+        m["cumprod"] = scan;
+
+        auto reduce = [&](const char* name, float (*f)(const float*, size_t),
+                          double (*d)(const double*, size_t)) {
+            FastOp op{ Kind::Reduce, {}, {} };
+            op.f32.reduce = f;
+            op.f64.reduce = d;
+            m[name] = op;
+        };
+        reduce("reduce_sum", &reduce_sum_n<float>, &reduce_sum_n<double>);
+        reduce("reduce_prod", &reduce_prod_n<float>, &reduce_prod_n<double>);
+        reduce("reduce_min", &reduce_min_n<float>, &reduce_min_n<double>);
+        reduce("reduce_max", &reduce_max_n<float>, &reduce_max_n<double>);
+        reduce("reduce_mean", &reduce_mean_n<float>, &reduce_mean_n<double>);
+        reduce("reduce_var", &reduce_var_n<float>, &reduce_var_n<double>);
+        reduce("reduce_std", &reduce_std_n<float>, &reduce_std_n<double>);
+
+        FastOp pred{ Kind::Predicate, {}, {} };
+        pred.f32.predicate = &reduce_any_n<float>;
+        pred.f64.predicate = &reduce_any_n<double>;
+        m["reduce_any"] = pred;
+        pred.f32.predicate = &reduce_all_n<float>;
+        pred.f64.predicate = &reduce_all_n<double>;
+        m["reduce_all"] = pred;
+
+        FastOp index{ Kind::Index, {}, {} };
+        index.f32.index = &argmax_n<float>;
+        index.f64.index = &argmax_n<double>;
+        m["argmax"] = index;
+        index.f32.index = &argmin_n<float>;
+        index.f64.index = &argmin_n<double>;
+        m["argmin"] = index;
+
+        FastOp dot{ Kind::Dot, {}, {} };
+        dot.f32.dot = &dot_n<float>;
+        dot.f64.dot = &dot_n<double>;
+        m["dot"] = dot;
+        return m;
+    }();
+    return t;
+}
+
+inline size_t arity(Kind k) { return k == Kind::Binary || k == Kind::Dot ? 2 : 1; }
+
+enum class DType { F32, F64, Other };
+
+inline DType dtype_of(const Array& a) {
+    if (a.dtype() == nb::dtype<float>()) return DType::F32;
+    if (a.dtype() == nb::dtype<double>()) return DType::F64;
+    return DType::Other;
+}
+
+// uninitialised array of a's shape and dtype; 1-D of a's size when flat
+template <typename T>
+nb::ndarray<nb::numpy> empty_like(const Array& a, T** data, bool flat = false) {
+    T* C = static_cast<T*>(aligned_alloc64(std::max<size_t>(a.size(), 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+    std::vector<size_t> shape(a.ndim());
+    for (size_t i = 0; i < a.ndim(); ++i) shape[i] = a.shape(i);
+    if (flat) shape.assign(1, a.size());
+    *data = C;
+    return nb::ndarray<nb::numpy>(C, shape.size(), shape.data(), deleter, nullptr, nb::dtype<T>());
+}
+
+inline void check_same_shape(const Array& a, const Array& b) {
+    bool same = a.ndim() == b.ndim();
+    for (size_t i = 0; same && i < a.ndim(); ++i) same = a.shape(i) == b.shape(i);
+    if (!same) throw std::runtime_error("shape mismatch");
+}
+
+template <typename T>
+nb::ndarray<nb::numpy> run_binary(const Kernels<T>& k, const Array& a, const Array& b) {
+    check_same_shape(a, b);
+    T* C;
+    auto out = empty_like<T>(a, &C);
+    k.binary(static_cast<const T*>(a.data()), static_cast<const T*>(b.data()), C, a.size());
+    return out;
+}
+
+template <typename T>
+nb::ndarray<nb::numpy> run_unary(const Kernels<T>& k, const Array& a, bool flat = false) {
+    T* C;
+    auto out = empty_like<T>(a, &C, flat);
+    k.unary(static_cast<const T*>(a.data()), C, a.size());
+    return out;
+}
+
+template <typename T>
+nb::object run(const FastOp& op, const Kernels<T>& k, const Array* args) {
+    const T* A = static_cast<const T*>(args[0].data());
+    const size_t N = args[0].size();
+    switch (op.kind) {
+    case Kind::Binary: return interop::export_value(run_binary(k, args[0], args[1]));
+    case Kind::Unary: return interop::export_value(run_unary(k, args[0]));
+    case Kind::Scan: return interop::export_value(run_unary(k, args[0], true));
+    case Kind::Reduce: return nb::cast(k.reduce(A, N));
+    case Kind::Predicate: return nb::cast(k.predicate(A, N));
+    case Kind::Index: return nb::cast(k.index(A, N));
+    case Kind::Dot:
+        if (args[1].size() != N) throw std::runtime_error("dot: vectors must have the same length");
+        return nb::cast(k.dot(A, static_cast<const T*>(args[1].data()), N));
+    }
+    return nb::none();
+}
+
+// Single-op entry points. A dtype other than float32/float64, or mixed
+// dtypes, defer to the typed overloads registered after these.
+inline DType dispatch_dtype(const Array& a) {
+    const DType dt = dtype_of(a);
+    if (dt == DType::Other) throw nb::next_overload();
+    return dt;
+}
+
+inline DType dispatch_dtype(const Array& a, const Array& b) {
+    const DType dt = dispatch_dtype(a);
+    if (dtype_of(b) != dt) throw nb::next_overload();
+    return dt;
+}
+
+inline nb::ndarray<nb::numpy> binary(const FastOp& op, const Array& a, const Array& b) {
+    return dispatch_dtype(a, b) == DType::F32 ? run_binary(op.f32, a, b) : run_binary(op.f64, a, b);
+}
+
+inline nb::ndarray<nb::numpy> unary(const FastOp& op, const Array& a) {
+    const bool flat = op.kind == Kind::Scan;
+    return dispatch_dtype(a) == DType::F32 ? run_unary(op.f32, a, flat) : run_unary(op.f64, a, flat);
+}
+
+inline double reduce(const FastOp& op, const Array& a) {
+    if (dispatch_dtype(a) == DType::F32) return op.f32.reduce(static_cast<const float*>(a.data()), a.size());
+    return op.f64.reduce(static_cast<const double*>(a.data()), a.size());
+}
+
+inline bool predicate(const FastOp& op, const Array& a) {
+    if (dispatch_dtype(a) == DType::F32) return op.f32.predicate(static_cast<const float*>(a.data()), a.size());
+    return op.f64.predicate(static_cast<const double*>(a.data()), a.size());
+}
+
+inline size_t index(const FastOp& op, const Array& a) {
+    if (dispatch_dtype(a) == DType::F32) return op.f32.index(static_cast<const float*>(a.data()), a.size());
+    return op.f64.index(static_cast<const double*>(a.data()), a.size());
+}
+
+inline double dot(const FastOp& op, const Array& a, const Array& b) {
+    const DType dt = dispatch_dtype(a, b);
+    if (a.size() != b.size()) throw std::runtime_error("dot: vectors must have the same length");
+    if (dt == DType::F32)
+        return op.f32.dot(static_cast<const float*>(a.data()), static_cast<const float*>(b.data()), a.size());
+    return op.f64.dot(static_cast<const double*>(a.data()), static_cast<const double*>(b.data()), a.size());
+}
+
+// the op name of a call: the string itself, or a function's __name__
+inline std::string op_name(nb::handle fn) {
+    return nb::isinstance<nb::str>(fn) ? nb::cast<std::string>(fn) : nb::cast<std::string>(fn.attr("__name__"));
+}
+
+// the table entry for `name` when fargs are float32/float64 arrays of one
+// dtype, with the arrays cast into args and their dtype into dt; nullptr
+// when the call must go through the module instead
+inline const FastOp* direct(const std::string& name, nb::tuple fargs, Array* args, DType& dt) {
+    auto it = table().find(name);
+    if (it == table().end() || nb::len(fargs) != arity(it->second.kind)) return nullptr;
+    dt = DType::Other;
+    for (size_t i = 0; i < nb::len(fargs); ++i) {
+        if (!nb::try_cast(fargs[i], args[i], false)) return nullptr;
+        const DType di = dtype_of(args[i]);
+        if (di == DType::Other || (i > 0 && di != dt)) return nullptr;
+        dt = di;
+    }
+    return &it->second;
+}
+
+// the table entry for calling fn (an op name or a function) on fargs, as
+// direct() gives it. A function takes the fast path only when it is the
+// module's own op of that name: a foreign callable that shares a name
+// (np.add) or has none (functools.partial) is called as given.
+inline const FastOp* lookup(nb::module_ module, nb::handle fn, nb::tuple fargs, Array* args, DType& dt) {
+    const bool by_name = nb::isinstance<nb::str>(fn);
+    if (!by_name && !nb::hasattr(fn, "__name__")) return nullptr;
+    const std::string name = op_name(fn);
+    if (!by_name && !fn.is(nb::getattr(module, name.c_str(), nb::none()))) return nullptr;
+    return direct(name, fargs, args, dt);
+}
+
+// Runs [(op, args), ...] and returns the list of results. op is an op name
+// or any callable, args a tuple of arguments or a single array. Ops in
+// table() on float32/float64 arrays call their kernels directly; names go
+// through the module and other callables are called as usual.
+inline nb::list batch(nb::module_ module, nb::iterable calls) {
+    nb::list results;
+    Array args[2];
+    for (nb::handle call : calls) {
+        if (!nb::isinstance<nb::tuple>(call) || nb::len(call) != 2)
+            throw std::runtime_error("batch: each entry must be an (op, args) tuple");
+        nb::tuple entry = nb::borrow<nb::tuple>(call);
+        nb::object fn = entry[0];
+        nb::tuple fargs = nb::isinstance<nb::tuple>(entry[1]) ? nb::borrow<nb::tuple>(entry[1])
+                                                              : nb::make_tuple(entry[1]);
+        DType dt;
+        const FastOp* op = lookup(module, fn, fargs, args, dt);
+        if (!op) {
+            nb::object f = nb::isinstance<nb::str>(fn) ? module.attr(op_name(fn).c_str()) : fn;
+            results.append(f(*fargs));
+            continue;
+        }
+        interop::SourceScope scope(interop::framework_of(fargs[0]));
+        if (dt == DType::F32) {
+            results.append(run(*op, op->f32, args));
+        } else {
+            results.append(run(*op, op->f64, args));
+        }
+    }
+    return results;
+}
+
+} // fastpath
@@ -0,0 +1,198 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+namespace nb = nanobind;
+
+// Output framework for returned arrays. Inputs already arrive through
+// nanobind's ndarray caster, which takes any CPU array that speaks DLPack
+// or the buffer protocol without copying. Results are created as numpy
+// arrays over an aligned_alloc64 buffer and returned in the framework of
+// the call's first array argument (numpy when it has none), so torch in
+// gives torch out; set_framework can override that for every call. Other
+// frameworks get the same buffer through a DLPack capsule, so the capsule
+// that frees it travels with the new tensor.
+namespace interop {
+
+// Auto only appears as the override: follow the inputs
+enum class Framework { Auto, NumPy, PyTorch, JAX, TensorFlow, DLPack };
+
+inline std::atomic<Framework> g_framework{ Framework::Auto };
+
+inline Framework framework() { return g_framework.load(std::memory_order_relaxed); }
+
+// framework of the array arguments of the op running on this thread, set
+// by binding::module's wrapper for the duration of the call
+inline thread_local std::optional<Framework> t_source;
+
+class SourceScope {
+public:
+    explicit SourceScope(std::optional<Framework> f) : prev_(t_source) { t_source = f; }
+    ~SourceScope() { t_source = prev_; }
+    SourceScope(const SourceScope&) = delete;
+    SourceScope& operator=(const SourceScope&) = delete;
+
+private:
+    std::optional<Framework> prev_;
+};
+
+// the framework results of the current call are returned in
+inline Framework output_framework() {
+    const Framework f = framework();
+    return f == Framework::Auto ? t_source.value_or(Framework::NumPy) : f;
+}
+
+inline const char* framework_name(Framework f) {
+    switch (f) {
+    case Framework::Auto: return "auto";
+    case Framework::NumPy: return "numpy";
+    case Framework::PyTorch: return "torch";
+    case Framework::JAX: return "jax";
+    case Framework::TensorFlow: return "tensorflow";
+    case Framework::DLPack: return "dlpack";
+    }
+    return "numpy";
+}
+
+// selects the framework every result is returned in ("auto" follows the
+// inputs again) and returns the previous setting
+inline std::string set_framework(const std::string& name) {
+    Framework f;
+    if (name == "auto") f = Framework::Auto;
+    else if (name == "numpy") f = Framework::NumPy;
+    else if (name == "torch" || name == "pytorch") f = Framework::PyTorch;
+    else if (name == "jax") f = Framework::JAX;
+    else if (name == "tensorflow") f = Framework::TensorFlow;
+    else if (name == "dlpack") f = Framework::DLPack;
+    else throw std::runtime_error("set_framework: unknown framework '" + name +
+                                  "' (auto, numpy, torch, jax, tensorflow or dlpack)");
+    return framework_name(g_framework.exchange(f, std::memory_order_relaxed));
+}
+
+// framework of an array argument, from the top-level package of its type
+// (numpy for anything unrecognised). Called under the GIL, which also
+// guards the per-type cache; cached types are kept alive.
+inline Framework framework_of(nb::handle src) {
+    static std::unordered_map<PyTypeObject*, Framework> cache;
+    PyTypeObject* type = Py_TYPE(src.ptr());
+    if (auto it = cache.find(type); it != cache.end()) return it->second;
+    Framework f = Framework::NumPy;
+    try {
+        nb::object module = nb::getattr(nb::handle(reinterpret_cast<PyObject*>(type)), "__module__", nb::none());
+        if (nb::isinstance<nb::str>(module)) {
+            const std::string name = nb::cast<std::string>(module);
+            const std::string top = name.substr(0, name.find('.'));
+            if (top == "torch") f = Framework::PyTorch;
+            else if (top == "jax" || top == "jaxlib") f = Framework::JAX;
+            else if (top == "tensorflow") f = Framework::TensorFlow;
+        }
+    } catch (...) {
+        return Framework::NumPy;
+    }
+    Py_INCREF(reinterpret_cast<PyObject*>(type));
+    cache.emplace(type, f);
+    return f;
+}
+
+// argument types that accept arrays: ndarrays, and variants with an
+// ndarray alternative (array-or-scalar operands)
+template <typename X> struct is_ndarray : std::false_type {};
+template <typename... Ts> struct is_ndarray<nb::ndarray<Ts...>> : std::true_type {};
+template <typename X> struct takes_array : is_ndarray<X> {};
+template <typename... Ts> struct takes_array<std::variant<Ts...>> : std::disjunction<is_ndarray<Ts>...> {};
+
+// a converted argument with the framework of the Python object it came
+// from, when that was an array
+template <typename X>
+struct Input {
+    X value;
+    std::optional<Framework> source;
+};
+
+template <typename X>
+bool holds_array(const X& x) {
+    if constexpr (is_ndarray<X>::value) return true;
+    else return std::visit([](const auto& v) { return is_ndarray<std::decay_t<decltype(v)>>::value; }, x);
+}
+
+// folds the first array argument's framework into f
+template <typename X> void note_source(std::optional<Framework>&, const X&) {}
+template <typename X> void note_source(std::optional<Framework>& f, const Input<X>& x) {
+    if (!f) f = x.source;
+}
+
+// true for a numpy ndarray result, or a tuple/pair holding one
+template <typename X> struct has_array : std::false_type {};
+template <typename... Ts> struct has_array<nb::ndarray<nb::numpy, Ts...>> : std::true_type {};
+template <typename... Ts> struct has_array<std::tuple<Ts...>> : std::disjunction<has_array<Ts>...> {};
+template <typename A, typename B> struct has_array<std::pair<A, B>> : std::disjunction<has_array<A>, has_array<B>> {};
+
+// the array under the output framework's tag; the converting constructor
+// shares the underlying buffer and its owner
+template <typename... Ts>
+nb::object export_array(const nb::ndarray<nb::numpy, Ts...>& a) {
+    constexpr auto p = nb::rv_policy::automatic;
+    switch (output_framework()) {
+    case Framework::Auto:
+    case Framework::NumPy: return nb::cast(a, p);
+    case Framework::PyTorch: return nb::cast(nb::ndarray<nb::pytorch, Ts...>(a), p);
+    case Framework::JAX: return nb::cast(nb::ndarray<nb::jax, Ts...>(a), p);
+    case Framework::TensorFlow: return nb::cast(nb::ndarray<nb::tensorflow, Ts...>(a), p);
+    case Framework::DLPack: return nb::cast(nb::ndarray<Ts...>(a), p);
+    }
+    return nb::cast(a, p);
+}
+
+// a result as a Python object, with every array in it exported
+template <typename X> nb::object export_value(const X& x);
+template <typename... Ts> nb::object export_value(const nb::ndarray<nb::numpy, Ts...>& a);
+template <typename... Ts> nb::object export_value(const std::tuple<Ts...>& t);
+template <typename A, typename B> nb::object export_value(const std::pair<A, B>& p);
+
+template <typename X> nb::object export_value(const X& x) { return nb::cast(x, nb::rv_policy::automatic); }
+template <typename... Ts> nb::object export_value(const nb::ndarray<nb::numpy, Ts...>& a) { return export_array(a); }
+template <typename... Ts> nb::object export_value(const std::tuple<Ts...>& t) {
+    return std::apply([](const auto&... x) -> nb::object { return nb::make_tuple(export_value(x)...); }, t);
+}
+template <typename A, typename B> nb::object export_value(const std::pair<A, B>& p) {
+    return nb::make_tuple(export_value(p.first), export_value(p.second));
+}
+
+} // interop
+
+namespace nanobind {
+namespace detail {
+
+// converts as X does, then records the framework of the source object
+template <typename X>
+struct type_caster<interop::Input<X>> {
+    using Caster = make_caster<X>;
+    NB_TYPE_CASTER(interop::Input<X>, Caster::Name)
+
+    bool from_python(handle src, uint8_t flags, cleanup_list* cleanup) noexcept {
+        Caster caster;
+        if (!caster.from_python(src, flags_for_local_caster<X>(flags), cleanup) ||
+            !caster.template can_cast<X>())
+            return false;
+        value.value = caster.operator cast_t<X>();
+        value.source = interop::holds_array(value.value) ? std::optional(interop::framework_of(src)) : std::nullopt;
+        return true;
+    }
+
+    template <typename T_>
+    static handle from_cpp(T_&& v, rv_policy policy, cleanup_list* cleanup) noexcept {
+        return Caster::from_cpp(forward_like_<T_>(v.value), policy, cleanup);
+    }
+};
+
+} // detail
+} // nanobind
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+#include "../simd/linalg.hpp"
+#include "../stats/covariance.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// rows per worker for the tall-skinny products below
+constexpr size_t kTallSkinnyGrain = 2048;
+
+// Cyclic Jacobi eigensolver for a small symmetric (n, n) matrix A, which is
+// destroyed. On return w holds the eigenvalues in descending order and the
+// columns of V (row-major, n x n) the matching eigenvectors.
+inline void sym_eig_jacobi(std::vector<double>& A, size_t n,
+                           std::vector<double>& V, std::vector<double>& w) {
+    V.assign(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) V[i * n + i] = 1.0;
+
+    for (int sweep = 0; sweep < 100; ++sweep) {
+        double off = 0.0, total = 0.0;
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = 0; j < n; ++j) {
+                total += A[i * n + j] * A[i * n + j];
+                if (i != j) off += A[i * n + j] * A[i * n + j];
+            }
+        if (off <= 1e-30 * total || off == 0.0) break;
+
+        for (size_t p = 0; p + 1 < n; ++p) {
+            for (size_t q = p + 1; q < n; ++q) {
+                const double apq = A[p * n + q];
+                if (apq == 0.0) continue;
+                const double theta = (A[q * n + q] - A[p * n + p]) / (2.0 * apq);
+                const double t = (theta >= 0 ? 1.0 : -1.0) /
+                                 (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                for (size_t r = 0; r < n; ++r) {
+                    const double arp = A[r * n + p], arq = A[r * n + q];
+                    A[r * n + p] = c * arp - s * arq;
+                    A[r * n + q] = s * arp + c * arq;
+                }
+                for (size_t r = 0; r < n; ++r) {
+                    const double apr = A[p * n + r], aqr = A[q * n + r];
+                    A[p * n + r] = c * apr - s * aqr;
+                    A[q * n + r] = s * apr + c * aqr;
+                }
+                for (size_t r = 0; r < n; ++r) {
+                    const double vrp = V[r * n + p], vrq = V[r * n + q];
+                    V[r * n + p] = c * vrp - s * vrq;
+                    V[r * n + q] = s * vrp + c * vrq;
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return A[a * n + a] > A[b * n + b]; });
+    std::vector<double> sorted(n * n);
+    w.resize(n);
+    for (size_t j = 0; j < n; ++j) {
+        w[j] = A[order[j] * n + order[j]];
+        for (size_t r = 0; r < n; ++r) sorted[r * n + j] = V[r * n + order[j]];
+    }
+    V.swap(sorted);
+}
+
+// rows of X a worker centres into scratch at a time: a few MB, at most
+// one grain
+inline size_t centred_block_rows(size_t D) {
+    return std::clamp<size_t>(kCovChunkElems / std::max<size_t>(D, 1), 64, kTallSkinnyGrain);
+}
+
+// out (N, l) = (X - 1 mu^T) W for row-major X (N, D) and W (D, l); each
+// worker multiplies its own slab of rows. As in centred_syrk, blocks of
+// rows are centred into scratch before the gemm rather than correcting
+// X W by 1 (mu^T W), which cancels in float32 when the means dwarf the
+// spread. mu may be null.
+template <typename T>
+void centred_times(const T* X, size_t N, size_t D, const T* mu,
+                   const T* W, size_t l, T* out) {
+    const size_t rows = centred_block_rows(D);
+    parallel_for(N, kTallSkinnyGrain, [&](size_t, size_t b, size_t e) {
+        if (b == e) return;
+        if (!mu) {
+            gemm<T>(false, false, e - b, l, D, T(1), X + b * D, D, W, l, T(0), out + b * l, l);
+            return;
+        }
+        std::vector<T> buf(std::min(rows, e - b) * D);
+        for (size_t r0 = b; r0 < e; r0 += rows) {
+            const size_t k = std::min(rows, e - r0);
+            for (size_t i = 0; i < k; ++i) sub_n(X + (r0 + i) * D, mu, D, buf.data() + i * D);
+            gemm<T>(false, false, k, l, D, T(1), buf.data(), D, W, l, T(0), out + r0 * l, l);
+        }
+    });
+}
+
+// out (D, l) = (X - 1 mu^T)^T Q for row-major X (N, D) and Q (N, l). Every
+// worker reduces its slab, centred a block at a time as in centred_times,
+// into a private (D, l) partial; these are summed at the end, so memory
+// stays O(threads * D * l). mu may be null.
+template <typename T>
+void centred_t_times(const T* X, size_t N, size_t D, const T* mu,
+                     const T* Q, size_t l, T* out) {
+    const size_t nt = parallel_threads(N, kTallSkinnyGrain);
+    const size_t rows = mu ? centred_block_rows(D) : N;
+    std::vector<T> partial(nt * D * l, T(0));
+    parallel_chunks(N, nt, [&](size_t t, size_t b, size_t e) {
+        T* p = partial.data() + t * D * l;
+        std::vector<T> buf(mu ? std::min(rows, e - b) * D : 0);
+        for (size_t r0 = b; r0 < e; r0 += rows) {
+            const size_t k = std::min(rows, e - r0);
+            const T* A = X + r0 * D;
+            if (mu) {
+                for (size_t i = 0; i < k; ++i) sub_n(X + (r0 + i) * D, mu, D, buf.data() + i * D);
+                A = buf.data();
+            }
+            gemm<T>(true, false, D, l, k, T(1), A, D, Q + r0 * l, l, r0 == b ? T(0) : T(1), p, l);
+        }
+    });
+    std::fill(out, out + D * l, T(0));
+    for (size_t t = 0; t < nt; ++t) {
+        const T* p = partial.data() + t * D * l;
+        for (size_t i = 0; i < D * l; ++i) out[i] += p[i];
+    }
+}
+
+// G (l, l) = Y^T Y in double for a row-major (R, l) Y. Each worker widens
+// its slab a block of rows at a time and folds it in with dsyrk, so float32
+// panels get a Gram matrix accurate to double rounding. Only the upper
+// triangle is summed; it is mirrored at the end.
+template <typename T>
+void gram_double(const T* Y, size_t R, size_t l, double* G) {
+    const size_t nt = parallel_threads(R, kTallSkinnyGrain);
+    std::vector<double> partial(nt * l * l, 0.0);
+    parallel_chunks(R, nt, [&](size_t t, size_t b, size_t e) {
+        std::vector<double> buf;
+        const double* rows = nullptr;
+        for (size_t r0 = b; r0 < e; r0 += kTallSkinnyGrain) {
+            const size_t k = std::min(kTallSkinnyGrain, e - r0);
+            if constexpr (std::is_same_v<T, double>) {
+                rows = Y + r0 * l;
+            } else {
+                buf.assign(Y + r0 * l, Y + (r0 + k) * l);
+                rows = buf.data();
+            }
+            syrk<double>(true, l, k, 1.0, rows, l, 1.0, partial.data() + t * l * l, l);
+        }
+    });
+    std::fill(G, G + l * l, 0.0);
+    for (size_t t = 0; t < nt; ++t) {
+        const double* p = partial.data() + t * l * l;
+        for (size_t i = 0; i < l; ++i)
+            for (size_t j = i; j < l; ++j) G[i * l + j] += p[i * l + j];
+    }
+    for (size_t i = 0; i < l; ++i)
+        for (size_t j = 0; j < i; ++j) G[i * l + j] = G[j * l + i];
+}
+
+// Replaces the columns of Y (R, l) by an orthonormal basis of their span.
+// The Gram matrix Y^T Y is formed and eigendecomposed in double as
+// V diag(w) V^T and Y is mapped to Y V diag(w)^-1/2; directions with
+// negligible energy are zeroed, which handles rank deficiency. Applied
+// twice, like CholeskyQR2, for accuracy. The cutoff keeps directions down
+// to a singular value ratio of about 64 eps of T (8e-6 in float32), or
+// to where double rounding of the Gram matrix takes over.
+template <typename T>
+void orthonormalize(std::vector<T>& Y, size_t R, size_t l, std::vector<T>& tmp) {
+    std::vector<T> W(l * l);
+    std::vector<double> Gd(l * l), V, w;
+    tmp.resize(R * l);
+    const double rel = 64.0 * std::numeric_limits<T>::epsilon();
+    const double ratio = std::max(rel * rel, 64.0 * std::numeric_limits<double>::epsilon());
+    for (int pass = 0; pass < 2; ++pass) {
+        gram_double(Y.data(), R, l, Gd.data());
+        sym_eig_jacobi(Gd, l, V, w);
+        const double cutoff = std::max(w[0], 0.0) * ratio;
+        for (size_t j = 0; j < l; ++j) {
+            const double s = (w[j] > cutoff && w[j] > 0.0) ? 1.0 / std::sqrt(w[j]) : 0.0;
+            for (size_t i = 0; i < l; ++i) W[i * l + j] = static_cast<T>(V[i * l + j] * s);
+        }
+        centred_times<T>(Y.data(), R, l, nullptr, W.data(), l, tmp.data());
+        Y.swap(tmp);
+    }
+}
+
+template <typename T>
+using SvdResult = std::tuple<nb::ndarray<nb::numpy, T, nb::ndim<2>>,
+                             nb::ndarray<nb::numpy, T, nb::ndim<1>>,
+                             nb::ndarray<nb::numpy, T, nb::ndim<2>>>;
+
+// Rank-k randomized SVD (Halko, Martinsson & Tropp, 2011) of X - 1 mu^T,
+// with mu optional. Only (N, k + oversample) and (D, k + oversample) panels
+// are ever held. Fills U (N, k), S (k) and Vt (k, D).
+template <typename T>
+void randomized_svd_impl(const T* X, size_t N, size_t D, const T* mu,
+                         size_t k, size_t n_iter, size_t oversample,
+                         uint64_t seed, T* U, T* S, T* Vt) {
+    const size_t l = std::min(k + oversample, std::min(N, D));
+
+    std::vector<T> omega(D * l);
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    for (auto& v : omega) v = static_cast<T>(gauss(rng));
+
+    // range finder with power iterations, re-orthonormalising each step
+    std::vector<T> Q(N * l), Z(D * l), tmp;
+    centred_times<T>(X, N, D, mu, omega.data(), l, Q.data());
+    orthonormalize(Q, N, l, tmp);
+    for (size_t it = 0; it < n_iter; ++it) {
+        centred_t_times<T>(X, N, D, mu, Q.data(), l, Z.data());
+        orthonormalize(Z, D, l, tmp);
+        centred_times<T>(X, N, D, mu, Z.data(), l, Q.data());
+        orthonormalize(Q, N, l, tmp);
+    }
+
+    // B = Q^T X is (l, D); keep it as Bt = X^T Q and take the SVD of B from
+    // the eigenpairs of B B^T = Bt^T Bt, formed in double so that the
+    // smaller singular values are not lost to rounding of their squares
+    std::vector<T> Bt(D * l);
+    centred_t_times<T>(X, N, D, mu, Q.data(), l, Bt.data());
+    std::vector<double> Md(l * l), V, w;
+    gram_double(Bt.data(), D, l, Md.data());
+    sym_eig_jacobi(Md, l, V, w);
+
+    std::vector<T> Wk(l * k);
+    for (size_t i = 0; i < l; ++i)
+        for (size_t j = 0; j < k; ++j) Wk[i * k + j] = static_cast<T>(V[i * l + j]);
+    for (size_t j = 0; j < k; ++j) S[j] = static_cast<T>(std::sqrt(std::max(w[j], 0.0)));
+
+    // U = Q W_k and Vt = diag(1/S) W_k^T B = diag(1/S) (Bt W_k)^T
+    centred_times<T>(Q.data(), N, l, nullptr, Wk.data(), k, U);
+    std::vector<T> P(D * k);
+    gemm<T>(false, false, D, k, l, T(1), Bt.data(), l, Wk.data(), k, T(0), P.data(), k);
+    for (size_t j = 0; j < k; ++j) {
+        const T inv = S[j] > T(0) ? T(1) / S[j] : T(0);
+        for (size_t i = 0; i < D; ++i) Vt[j * D + i] = P[i * k + j] * inv;
+    }
+
+    // deterministic signs: the largest |U| entry of each component is positive
+    for (size_t j = 0; j < k; ++j) {
+        size_t arg = 0;
+        T best = T(-1);
+        for (size_t i = 0; i < N; ++i) {
+            const T a = std::abs(U[i * k + j]);
+            if (a > best) { best = a; arg = i; }
+        }
+        if (U[arg * k + j] < T(0)) {
+            for (size_t i = 0; i < N; ++i) U[i * k + j] = -U[i * k + j];
+            for (size_t i = 0; i < D; ++i) Vt[j * D + i] = -Vt[j * D + i];
+        }
+    }
+}
+
+// Truncated SVD X ~= U diag(S) Vt of a row-major (N, D) matrix.
+// Returns (U (N, k), S (k,), Vt (k, D)).
+template <typename T>
+SvdResult<T> randomized_svd(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> X,
+                            size_t k, size_t n_iter, size_t oversample, uint64_t seed) {
+    const size_t N = X.shape(0), D = X.shape(1);
+    if (k == 0 || k > std::min(N, D))
+        throw std::runtime_error("randomized_svd: k must be in [1, min(N, D)]");
+
+    T* U = static_cast<T*>(aligned_alloc64(N * k * sizeof(T)));
+    T* S = static_cast<T*>(aligned_alloc64(k * sizeof(T)));
+    T* Vt = static_cast<T*>(aligned_alloc64(k * D * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule u_owner(U, [](void* p) noexcept { _aligned_free(p); });
+    nb::capsule s_owner(S, [](void* p) noexcept { _aligned_free(p); });
+    nb::capsule v_owner(Vt, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule u_owner(U, [](void* p) noexcept { free(p); });
+    nb::capsule s_owner(S, [](void* p) noexcept { free(p); });
+    nb::capsule v_owner(Vt, [](void* p) noexcept { free(p); });
+#endif
+
+    {
+        nb::gil_scoped_release release;
+        randomized_svd_impl<T>(X.data(), N, D, nullptr, k, n_iter, oversample, seed, U, S, Vt);
+    }
+
+    return { nb::ndarray<nb::numpy, T, nb::ndim<2>>(U, { N, k }, u_owner),
+             nb::ndarray<nb::numpy, T, nb::ndim<1>>(S, { k }, s_owner),
+             nb::ndarray<nb::numpy, T, nb::ndim<2>>(Vt, { k, D }, v_owner) };
+}
+
+// PCA of a row-major (N, D) matrix via randomized SVD of the implicitly
+// centred data (X is never copied). Returns (scores (N, k), components
+// (k, D), explained_variance (k,), mean (D,)).
+template <typename T>
+std::tuple<nb::ndarray<nb::numpy, T, nb::ndim<2>>,
+           nb::ndarray<nb::numpy, T, nb::ndim<2>>,
+           nb::ndarray<nb::numpy, T, nb::ndim<1>>,
+           nb::ndarray<nb::numpy, T, nb::ndim<1>>>
+pca(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> X, size_t n_components,
+    size_t n_iter, uint64_t seed) {
+    const size_t N = X.shape(0), D = X.shape(1), k = n_components;
+    if (N < 2) throw std::runtime_error("pca: need at least two samples");
+    if (k == 0 || k > std::min(N, D))
+        throw std::runtime_error("pca: n_components must be in [1, min(N, D)]");
+    const T* A = X.data();
+
+    T* scores = static_cast<T*>(aligned_alloc64(N * k * sizeof(T)));
+    T* comps = static_cast<T*>(aligned_alloc64(k * D * sizeof(T)));
+    T* var = static_cast<T*>(aligned_alloc64(k * sizeof(T)));
+    T* mu = static_cast<T*>(aligned_alloc64(D * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule sc_owner(scores, [](void* p) noexcept { _aligned_free(p); });
+    nb::capsule c_owner(comps, [](void* p) noexcept { _aligned_free(p); });
+    nb::capsule v_owner(var, [](void* p) noexcept { _aligned_free(p); });
+    nb::capsule m_owner(mu, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule sc_owner(scores, [](void* p) noexcept { free(p); });
+    nb::capsule c_owner(comps, [](void* p) noexcept { free(p); });
+    nb::capsule v_owner(var, [](void* p) noexcept { free(p); });
+    nb::capsule m_owner(mu, [](void* p) noexcept { free(p); });
+#endif
+
+    {
+        nb::gil_scoped_release release;
+        // column means from per-thread partial sums
+        const size_t nt = parallel_threads(N, kTallSkinnyGrain);
+        std::vector<double> sums(nt * D, 0.0);
+        parallel_chunks(N, nt, [&](size_t t, size_t b, size_t e) {
+            double* s = sums.data() + t * D;
+            for (size_t r = b; r < e; ++r)
+                for (size_t j = 0; j < D; ++j) s[j] += A[r * D + j];
+        });
+        for (size_t j = 0; j < D; ++j) {
+            double s = 0.0;
+            for (size_t t = 0; t < nt; ++t) s += sums[t * D + j];
+            mu[j] = static_cast<T>(s / double(N));
+        }
+
+        randomized_svd_impl<T>(A, N, D, mu, k, n_iter, 10, seed, scores, var, comps);
+
+        // scores = U diag(S), explained variance = S^2 / (N - 1)
+        for (size_t r = 0; r < N; ++r)
+            for (size_t j = 0; j < k; ++j) scores[r * k + j] *= var[j];
+        for (size_t j = 0; j < k; ++j) var[j] = var[j] * var[j] / T(N - 1);
+    }
+
+    return { nb::ndarray<nb::numpy, T, nb::ndim<2>>(scores, { N, k }, sc_owner),
+             nb::ndarray<nb::numpy, T, nb::ndim<2>>(comps, { k, D }, c_owner),
+             nb::ndarray<nb::numpy, T, nb::ndim<1>>(var, { k }, v_owner),
+             nb::ndarray<nb::numpy, T, nb::ndim<1>>(mu, { D }, m_owner) };
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
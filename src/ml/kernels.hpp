@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+#include <hwy/contrib/math/math-inl.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+#include "../simd/approx.hpp"
+#include "../simd/linalg.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+enum class KernelKind { Linear, RBF, Polynomial, Periodic };
+
+template <typename T>
+struct KernelParams {
+    T gamma;         // rbf width / polynomial scale
+    int degree;      // polynomial degree
+    T coef0;         // polynomial offset
+    T period;        // periodic kernel period
+    T length_scale;  // periodic kernel length scale
+};
+
+// rows x cols of each output tile; the epilogue runs while the tile written
+// by gemm is still in L2
+constexpr size_t kKernelTileRows = 64;
+constexpr size_t kKernelTileCols = 1024;
+
+// Applies the kernel's nonlinearity in place to one tile row holding
+// g[j] = x.y_j, where xn = ||x||^2 and yn[j] = ||y_j||^2. The rbf and
+// periodic exp and cos use the kernels of precision tier P.
+template <KernelKind K, Mode P, typename T>
+void kernel_epilogue(T* g, size_t n, T xn, const T* yn, const KernelParams<T>& p) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    const auto zero = Zero(d);
+    const auto vx = Set(d, xn);
+    const auto neg2 = Set(d, T(-2));
+    const T pi = T(3.14159265358979323846);
+    size_t j = 0;
+
+    if constexpr (K == KernelKind::Linear) {
+        return;
+    } else if constexpr (K == KernelKind::RBF) {
+        // exp(-gamma ||x - y||^2)
+        const auto ng = Set(d, -p.gamma);
+        for (; j + L <= n; j += L) {
+            auto d2 = Max(zero, MulAdd(neg2, LoadU(d, g + j), Add(vx, LoadU(d, yn + j))));
+            StoreU(exp_p<P>(d, Mul(ng, d2)), d, g + j);
+        }
+        for (; j < n; ++j)
+            g[j] = std::exp(-p.gamma * std::max(T(0), xn + yn[j] - T(2) * g[j]));
+    } else if constexpr (K == KernelKind::Polynomial) {
+        // (gamma x.y + coef0)^degree by repeated multiplication
+        const auto vg = Set(d, p.gamma);
+        const auto vc = Set(d, p.coef0);
+        for (; j + L <= n; j += L) {
+            const auto base = MulAdd(vg, LoadU(d, g + j), vc);
+            auto acc = Set(d, T(1));
+            for (int e = 0; e < p.degree; ++e) acc = Mul(acc, base);
+            StoreU(acc, d, g + j);
+        }
+        for (; j < n; ++j) {
+            const T base = p.gamma * g[j] + p.coef0;
+            T acc = T(1);
+            for (int e = 0; e < p.degree; ++e) acc *= base;
+            g[j] = acc;
+        }
+    } else {
+        // exp(-2 sin^2(pi ||x - y|| / period) / l^2)
+        //   = exp((cos(2 pi ||x - y|| / period) - 1) / l^2)
+        const T w = T(2) * pi / p.period;
+        const T inv_l2 = T(1) / (p.length_scale * p.length_scale);
+        const auto vw = Set(d, w);
+        const auto vl = Set(d, inv_l2);
+        const auto one = Set(d, T(1));
+        for (; j + L <= n; j += L) {
+            auto d2 = Max(zero, MulAdd(neg2, LoadU(d, g + j), Add(vx, LoadU(d, yn + j))));
+            auto c = cos_p<P>(d, Mul(vw, Sqrt(d2)));
+            StoreU(exp_p<P>(d, Mul(Sub(c, one), vl)), d, g + j);
+        }
+        for (; j < n; ++j) {
+            const T dist = std::sqrt(std::max(T(0), xn + yn[j] - T(2) * g[j]));
+            g[j] = std::exp((std::cos(w * dist) - T(1)) * inv_l2);
+        }
+    }
+}
+
+// Fills the (N, M) Gram matrix tile by tile: gemm writes X_i Y_j^T into
+// the output and the epilogue transforms it in place. With `symmetric`
+// (X is Y) only tiles on or above the diagonal are computed and the lower
+// triangle is mirrored afterwards.
+template <KernelKind K, Mode P, typename T>
+void kernel_tiles(const T* X, size_t N, const T* Y, size_t M, size_t D,
+                  bool symmetric, const KernelParams<T>& p, T* C) {
+    std::vector<T> xn(N), yn(M);
+    if (K != KernelKind::Linear && K != KernelKind::Polynomial) {
+        row_sq_norms(X, N, D, xn.data());
+        if (symmetric) yn = xn;
+        else row_sq_norms(Y, M, D, yn.data());
+    }
+
+    const size_t row_blocks = (N + kKernelTileRows - 1) / kKernelTileRows;
+    const size_t col_blocks = (M + kKernelTileCols - 1) / kKernelTileCols;
+    std::vector<std::pair<size_t, size_t>> tiles;
+    for (size_t bi = 0; bi < row_blocks; ++bi) {
+        for (size_t bj = 0; bj < col_blocks; ++bj) {
+            // skip tiles lying entirely below the diagonal
+            if (symmetric && (bj + 1) * kKernelTileCols <= bi * kKernelTileRows) continue;
+            tiles.emplace_back(bi, bj);
+        }
+    }
+
+    parallel_for(tiles.size(), 1, [&](size_t, size_t tb, size_t te) {
+        for (size_t t = tb; t < te; ++t) {
+            const size_t r0 = tiles[t].first * kKernelTileRows;
+            const size_t c0 = tiles[t].second * kKernelTileCols;
+            const size_t rows = std::min(kKernelTileRows, N - r0);
+            const size_t cols = std::min(kKernelTileCols, M - c0);
+            T* Ct = C + r0 * M + c0;
+            gemm<T>(false, true, rows, cols, D, T(1), X + r0 * D, D,
+                    Y + c0 * D, D, T(0), Ct, M);
+            for (size_t r = 0; r < rows; ++r)
+                kernel_epilogue<K, P>(Ct + r * M, cols, xn[r0 + r], yn.data() + c0, p);
+        }
+    });
+
+    if (symmetric) mirror_upper(C, N);
+}
+
+inline KernelKind parse_kernel(const std::string& kind, int& degree) {
+    if (kind == "linear") return KernelKind::Linear;
+    if (kind == "rbf") return KernelKind::RBF;
+    if (kind == "polynomial") return KernelKind::Polynomial;
+    if (kind == "quadratic") { degree = 2; return KernelKind::Polynomial; }
+    if (kind == "periodic") return KernelKind::Periodic;
+    throw std::runtime_error(
+        "kernel_matrix: kind must be 'linear', 'rbf', 'polynomial', 'quadratic' or 'periodic'");
+}
+
+// Gram matrix K[i, j] = k(X[i], Y[j]). Y defaults to X, which selects the
+// symmetric path; gamma <= 0 means 1 / D.
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<2>>
+kernel_matrix(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> X,
+              std::optional<nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>> Y,
+              const std::string& kind, T gamma, int degree, T coef0,
+              T period, T length_scale) {
+    const size_t N = X.shape(0), D = X.shape(1);
+    const bool symmetric = !Y || (Y->data() == X.data() && Y->shape(0) == N && Y->shape(1) == D);
+    const T* B = symmetric ? X.data() : Y->data();
+    const size_t M = symmetric ? N : Y->shape(0);
+    if (!symmetric && Y->shape(1) != D)
+        throw std::runtime_error("kernel_matrix: feature dims must match");
+
+    KernelParams<T> p{ gamma > T(0) ? gamma : T(1) / T(std::max<size_t>(D, 1)),
+                       degree, coef0, period, length_scale };
+    const KernelKind k = parse_kernel(kind, p.degree);
+    if (p.degree < 0) throw std::runtime_error("kernel_matrix: degree must be non-negative");
+    if (k == KernelKind::Periodic && (period <= T(0) || length_scale <= T(0)))
+        throw std::runtime_error("kernel_matrix: period and length_scale must be positive");
+
+    T* C = static_cast<T*>(aligned_alloc64(N * M * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+
+    {
+        nb::gil_scoped_release release;
+        constexpr Mode kAccurate = Mode::Accurate;
+        switch (k) {
+            case KernelKind::Linear:
+                kernel_tiles<KernelKind::Linear, kAccurate>(X.data(), N, B, M, D, symmetric, p, C); break;
+            case KernelKind::RBF:
+                precision::dispatch(precision::mode(), [&](auto m) {
+                    kernel_tiles<KernelKind::RBF, decltype(m)::value>(X.data(), N, B, M, D, symmetric, p, C);
+                });
+                break;
+            case KernelKind::Polynomial:
+                kernel_tiles<KernelKind::Polynomial, kAccurate>(X.data(), N, B, M, D, symmetric, p, C); break;
+            case KernelKind::Periodic:
+                precision::dispatch(precision::mode(), [&](auto m) {
+                    kernel_tiles<KernelKind::Periodic, decltype(m)::value>(X.data(), N, B, M, D, symmetric, p, C);
+                });
+                break;
+        }
+    }
+
+    return { C, { N, M }, deleter };
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
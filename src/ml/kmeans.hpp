@@ -0,0 +1,327 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+#include "../simd/linalg.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// index of the closest centroid given g[j] = x.c_j and cn[j] = ||c_j||^2.
+// ||x||^2 is constant per row so it is left out of the comparison; the
+// partial distance cn[j] - 2 g[j] of the winner is written to `best`.
+template <typename T>
+size_t argmin_partial_dist(const T* g, const T* cn, size_t k, T& best) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    size_t idx = 0;
+    best = std::numeric_limits<T>::infinity();
+    size_t j = 0;
+
+    if (k >= L) {
+        const auto neg2 = Set(d, T(-2));
+        const auto step = Set(d, T(L));
+        auto vbest = Set(d, std::numeric_limits<T>::infinity());
+        auto vidx = Zero(d);
+        auto lane = Iota(d, 0);
+        for (; j + L <= k; j += L) {
+            auto v = MulAdd(neg2, LoadU(d, g + j), LoadU(d, cn + j));
+            auto m = Lt(v, vbest);
+            vbest = IfThenElse(m, v, vbest);
+            vidx = IfThenElse(m, lane, vidx);
+            lane = Add(lane, step);
+        }
+        T bv[HWY_MAX_BYTES / sizeof(T)];
+        T bi[HWY_MAX_BYTES / sizeof(T)];
+        StoreU(vbest, d, bv);
+        StoreU(vidx, d, bi);
+        for (size_t l = 0; l < L; ++l) {
+            size_t c = static_cast<size_t>(bi[l]);
+            if (bv[l] < best || (bv[l] == best && c < idx)) {
+                best = bv[l];
+                idx = c;
+            }
+        }
+    }
+    for (; j < k; ++j) {
+        T v = cn[j] - T(2) * g[j];
+        if (v < best) { best = v; idx = j; }
+    }
+    return idx;
+}
+
+// acc[0:D] += x[0:D], widening float rows into a double accumulator
+template <typename A, typename T>
+void accumulate_row(A* acc, const T* x, size_t D) {
+    if constexpr (std::is_same_v<A, T>) {
+        const ScalableTag<T> d;
+        const size_t L = Lanes(d);
+        size_t i = 0;
+        for (; i + L <= D; i += L)
+            StoreU(Add(LoadU(d, acc + i), LoadU(d, x + i)), d, acc + i);
+        for (; i < D; ++i) acc[i] += x[i];
+    } else {
+        for (size_t i = 0; i < D; ++i) acc[i] += A(x[i]);
+    }
+}
+
+// rows per GEMM block so the (rows, k) distance tile stays in L2
+template <typename T>
+size_t kmeans_block_rows(size_t k) {
+    const size_t tile_elems = (256 * 1024) / sizeof(T);
+    return std::clamp<size_t>(tile_elems / std::max<size_t>(1, k), 16, 4096);
+}
+
+// workers for assigning N rows to k centroids; read once per fit and passed
+// to kmeans_assign, since the accumulators are sized by it
+template <typename T>
+size_t kmeans_threads(size_t N, size_t k) {
+    return parallel_threads(N, kmeans_block_rows<T>(k));
+}
+
+// Assigns every row of X (N, D) to its nearest centroid of C (k, D).
+// Distances are ||x||^2 - 2 x.c + ||c||^2 with the cross term computed per
+// block by GEMM. The rows are split over nt workers, from kmeans_threads.
+// When `sums`/`counts` are given, each worker accumulates its members into
+// its own (k, D)/(k) slice at offset tid, which the caller merges. They are
+// double, as are the inertia partials: per-cluster sums over millions of
+// float32 rows would otherwise round every update the same way, and float
+// counts stop increasing at 2^24.
+// Returns the inertia (sum of squared distances to the assigned centroid).
+template <typename T>
+T kmeans_assign(const T* X, size_t N, size_t D, const T* C, const T* cnorm,
+                size_t k, int64_t* labels, double* sums, double* counts, size_t nt) {
+    const size_t bs = kmeans_block_rows<T>(k);
+    std::vector<double> partial(nt, 0.0);
+
+    parallel_chunks(N, nt, [&](size_t t, size_t begin, size_t end) {
+        std::vector<T> G(bs * k);
+        double* S = sums ? sums + t * k * D : nullptr;
+        double* Cnt = counts ? counts + t * k : nullptr;
+        double inertia = 0.0;
+        for (size_t b = begin; b < end; b += bs) {
+            const size_t rows = std::min(bs, end - b);
+            const T* Xb = X + b * D;
+            gemm<T>(false, true, rows, k, D, T(1), Xb, D, C, D, T(0), G.data(), k);
+            for (size_t r = 0; r < rows; ++r) {
+                const T* x = Xb + r * D;
+                T best;
+                size_t c = argmin_partial_dist(G.data() + r * k, cnorm, k, best);
+                labels[b + r] = static_cast<int64_t>(c);
+                inertia += double(std::max(T(0), dot_n(x, x, D) + best));
+                if (S) {
+                    accumulate_row(S + c * D, x, D);
+                    Cnt[c] += 1.0;
+                }
+            }
+        }
+        partial[t] = inertia;
+    });
+
+    double total = 0.0;
+    for (double p : partial) total += p;
+    return T(total);
+}
+
+// k-means++ seeding: each new centroid is drawn with probability
+// proportional to its squared distance from the nearest chosen centroid
+template <typename T>
+void kmeans_plusplus(const T* X, size_t N, size_t D, size_t k,
+                     std::mt19937_64& rng, T* C) {
+    const size_t block = 4096;
+    const size_t nblocks = (N + block - 1) / block;
+    std::vector<T> mind2(N);
+    std::vector<double> block_sum(nblocks);
+
+    size_t first = std::uniform_int_distribution<size_t>(0, N - 1)(rng);
+    std::memcpy(C, X + first * D, D * sizeof(T));
+
+    for (size_t c = 0; c < k; ++c) {
+        const T* cent = C + c * D;
+        parallel_for(nblocks, 1, [&](size_t, size_t bb, size_t be) {
+            for (size_t blk = bb; blk < be; ++blk) {
+                const size_t i0 = blk * block, i1 = std::min(N, i0 + block);
+                double s = 0.0;
+                for (size_t i = i0; i < i1; ++i) {
+                    T dist = sq_dist_n(X + i * D, cent, D);
+                    mind2[i] = c == 0 ? dist : std::min(mind2[i], dist);
+                    s += mind2[i];
+                }
+                block_sum[blk] = s;
+            }
+        });
+        if (c + 1 == k) break;
+
+        double total = 0.0;
+        for (double s : block_sum) total += s;
+        size_t pick;
+        if (total <= 0.0) {
+            // every point coincides with a centroid already
+            pick = std::uniform_int_distribution<size_t>(0, N - 1)(rng);
+        } else {
+            double r = std::uniform_real_distribution<double>(0.0, total)(rng);
+            size_t blk = 0;
+            while (blk + 1 < nblocks && r >= block_sum[blk]) r -= block_sum[blk++];
+            const size_t i0 = blk * block, i1 = std::min(N, i0 + block);
+            pick = i1 - 1;
+            for (size_t i = i0; i < i1; ++i) {
+                r -= mind2[i];
+                if (r < 0.0) { pick = i; break; }
+            }
+        }
+        std::memcpy(C + (c + 1) * D, X + pick * D, D * sizeof(T));
+    }
+}
+
+// picks k distinct rows uniformly (Floyd's sampling)
+template <typename T>
+void kmeans_random_init(const T* X, size_t N, size_t D, size_t k,
+                        std::mt19937_64& rng, T* C) {
+    std::unordered_set<size_t> chosen;
+    size_t c = 0;
+    for (size_t j = N - k; j < N; ++j) {
+        size_t r = std::uniform_int_distribution<size_t>(0, j)(rng);
+        if (!chosen.insert(r).second) { chosen.insert(j); r = j; }
+        std::memcpy(C + (c++) * D, X + r * D, D * sizeof(T));
+    }
+}
+
+// Lloyd's k-means on a row-major (N, D) matrix. With batch_size > 0 each of
+// the `iters` steps instead updates the centroids from a random mini-batch
+// (Sculley, 2010), which keeps the working set in cache for large N.
+// Returns (centroids (k, D), labels (N,), inertia).
+template <typename T>
+std::tuple<nb::ndarray<nb::numpy, T, nb::ndim<2>>,
+           nb::ndarray<nb::numpy, int64_t, nb::ndim<1>>, T>
+kmeans(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> X, size_t k, size_t iters,
+       const std::string& init, size_t batch_size, T tol, uint64_t seed) {
+    const size_t N = X.shape(0), D = X.shape(1);
+    if (k == 0) throw std::runtime_error("kmeans: k must be positive");
+    if (k > N) throw std::runtime_error("kmeans: k exceeds number of samples");
+    if (init != "k-means++" && init != "random")
+        throw std::runtime_error("kmeans: init must be 'k-means++' or 'random'");
+    const T* A = X.data();
+
+    T* C = static_cast<T*>(aligned_alloc64(k * D * sizeof(T)));
+    int64_t* labels = static_cast<int64_t*>(aligned_alloc64(N * sizeof(int64_t)));
+#if defined(_MSC_VER)
+    nb::capsule c_owner(C, [](void* p) noexcept { _aligned_free(p); });
+    nb::capsule l_owner(labels, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule c_owner(C, [](void* p) noexcept { free(p); });
+    nb::capsule l_owner(labels, [](void* p) noexcept { free(p); });
+#endif
+
+    T inertia;
+    {
+        nb::gil_scoped_release release;
+        std::mt19937_64 rng(seed);
+        if (init == "k-means++") kmeans_plusplus(A, N, D, k, rng, C);
+        else kmeans_random_init(A, N, D, k, rng, C);
+
+        std::vector<T> cnorm(k);
+        std::vector<T> prev(k * D);
+
+        if (batch_size == 0) {
+            const size_t nt = kmeans_threads<T>(N, k);
+            std::vector<double> sums(nt * k * D), counts(nt * k);
+            for (size_t it = 0; it < iters; ++it) {
+                row_sq_norms(C, k, D, cnorm.data());
+                std::fill(sums.begin(), sums.end(), 0.0);
+                std::fill(counts.begin(), counts.end(), 0.0);
+                kmeans_assign(A, N, D, C, cnorm.data(), k, labels,
+                              sums.data(), counts.data(), nt);
+
+                // merge the thread-local accumulators into slice 0
+                for (size_t t = 1; t < nt; ++t) {
+                    for (size_t c = 0; c < k; ++c) {
+                        accumulate_row(sums.data() + c * D, sums.data() + (t * k + c) * D, D);
+                        counts[c] += counts[t * k + c];
+                    }
+                }
+                std::memcpy(prev.data(), C, k * D * sizeof(T));
+                T shift = T(0), scale = T(0);
+                for (size_t c = 0; c < k; ++c) {
+                    // empty clusters keep their previous centroid
+                    if (counts[c] > 0.0) {
+                        const double inv = 1.0 / counts[c];
+                        for (size_t j = 0; j < D; ++j) C[c * D + j] = T(sums[c * D + j] * inv);
+                    }
+                    shift += sq_dist_n(C + c * D, prev.data() + c * D, D);
+                    scale += dot_n(C + c * D, C + c * D, D);
+                }
+                if (shift <= tol * std::max(scale, std::numeric_limits<T>::min())) break;
+            }
+        } else {
+            const size_t B = std::min(batch_size, N);
+            const size_t nt = kmeans_threads<T>(B, k);
+            std::vector<T> batch(B * D);
+            std::vector<double> sums(nt * k * D), counts(nt * k), seen(k, 0.0);
+            std::vector<int64_t> batch_labels(B);
+            std::uniform_int_distribution<size_t> pick(0, N - 1);
+            for (size_t it = 0; it < iters; ++it) {
+                for (size_t r = 0; r < B; ++r)
+                    std::memcpy(batch.data() + r * D, A + pick(rng) * D, D * sizeof(T));
+                row_sq_norms(C, k, D, cnorm.data());
+                std::fill(sums.begin(), sums.end(), 0.0);
+                std::fill(counts.begin(), counts.end(), 0.0);
+                kmeans_assign(batch.data(), B, D, C, cnorm.data(), k,
+                              batch_labels.data(), sums.data(), counts.data(), nt);
+
+                for (size_t t = 1; t < nt; ++t) {
+                    for (size_t c = 0; c < k; ++c) {
+                        accumulate_row(sums.data() + c * D, sums.data() + (t * k + c) * D, D);
+                        counts[c] += counts[t * k + c];
+                    }
+                }
+                // per-centre learning rate 1 / (points seen so far):
+                // c += (sum_batch - n_batch * c) / seen
+                for (size_t c = 0; c < k; ++c) {
+                    if (counts[c] == 0.0) continue;
+                    seen[c] += counts[c];
+                    const double eta = 1.0 / seen[c];
+                    for (size_t j = 0; j < D; ++j) {
+                        T& cj = C[c * D + j];
+                        cj = T(double(cj) + eta * (sums[c * D + j] - counts[c] * double(cj)));
+                    }
+                }
+            }
+        }
+
+        row_sq_norms(C, k, D, cnorm.data());
+        inertia = kmeans_assign<T>(A, N, D, C, cnorm.data(), k, labels, nullptr, nullptr,
+                                   kmeans_threads<T>(N, k));
+    }
+
+    return { nb::ndarray<nb::numpy, T, nb::ndim<2>>(C, { k, D }, c_owner),
+             nb::ndarray<nb::numpy, int64_t, nb::ndim<1>>(labels, { N }, l_owner),
+             inertia };
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
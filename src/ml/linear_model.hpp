@@ -0,0 +1,476 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+#include <hwy/contrib/math/math-inl.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+#include "../simd/approx.hpp"
+#include "../simd/linalg.hpp"
+#include "../stats/covariance.hpp"
+#include "decomposition.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+template <typename T>
+using LinearFit = std::tuple<nb::ndarray<nb::numpy, T, nb::ndim<1>>, T>;
+
+template <typename T>
+using LinearFitBatch = std::tuple<nb::ndarray<nb::numpy, T, nb::ndim<2>>,
+                                  nb::ndarray<nb::numpy, T, nb::ndim<1>>>;
+
+// Solves A x = b in place for a small symmetric positive definite (n, n)
+// matrix via an unblocked Cholesky factorisation; A is overwritten by L.
+inline void spd_solve(std::vector<double>& A, size_t n, double* b, const char* fn) {
+    for (size_t j = 0; j < n; ++j) {
+        double djj = A[j * n + j];
+        for (size_t k = 0; k < j; ++k) djj -= A[j * n + k] * A[j * n + k];
+        if (!(djj > 0.0))
+            throw std::runtime_error(std::string(fn) + ": system is not positive definite");
+        const double ljj = std::sqrt(djj);
+        A[j * n + j] = ljj;
+        for (size_t i = j + 1; i < n; ++i) {
+            double s = A[i * n + j];
+            for (size_t k = 0; k < j; ++k) s -= A[i * n + k] * A[j * n + k];
+            A[i * n + j] = s / ljj;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        double s = b[i];
+        for (size_t k = 0; k < i; ++k) s -= A[i * n + k] * b[k];
+        b[i] = s / A[i * n + i];
+    }
+    for (size_t i = n; i-- > 0;) {
+        double s = b[i];
+        for (size_t k = i + 1; k < n; ++k) s -= A[k * n + i] * b[k];
+        b[i] = s / A[i * n + i];
+    }
+}
+
+// Upper triangle of the (D + 1, D + 1) co-moment of the rows
+// [x_r - mu, y_r - ybar] of a row-major (N, D) problem. As in centred_syrk,
+// each chunk of rows is centred into scratch and fed to syrk, so neither
+// block is the difference of two large uncentred sums.
+template <typename T>
+void centred_xy_syrk(const T* X, const T* y, size_t N, size_t D, const T* mu, T ybar, T* C) {
+    const size_t W = D + 1;
+    const size_t chunk = std::min(N, std::max<size_t>(64, kCovChunkElems / W));
+    std::vector<T> buf(chunk * W);
+    for (size_t c0 = 0; c0 < N; c0 += chunk) {
+        const size_t k = std::min(chunk, N - c0);
+        parallel_for(k, 256, [&](size_t, size_t b, size_t e) {
+            for (size_t i = b; i < e; ++i) {
+                sub_n(X + (c0 + i) * D, mu, D, buf.data() + i * W);
+                buf[i * W + D] = y[c0 + i] - ybar;
+            }
+        });
+        syrk<T>(true, W, k, T(1), buf.data(), W, c0 == 0 ? T(0) : T(1), C, W);
+    }
+}
+
+// Centred normal equations of a row-major (N, D) problem: G = Xc^T Xc and
+// q = Xc^T yc, where Xc, yc subtract the column/target means when
+// fit_intercept is set (X is centred a chunk at a time, never copied
+// whole). Means are returned in mu, ybar.
+template <typename T>
+void normal_equations(const T* X, const T* y, size_t N, size_t D, bool fit_intercept,
+                      std::vector<T>& G, std::vector<T>& q,
+                      std::vector<T>& mu, T& ybar) {
+    mu.assign(D, T(0));
+    ybar = T(0);
+    if (fit_intercept) {
+        std::vector<double> s(D, 0.0);
+        double sy = 0.0;
+        for (size_t r = 0; r < N; ++r) {
+            for (size_t j = 0; j < D; ++j) s[j] += X[r * D + j];
+            sy += y[r];
+        }
+        for (size_t j = 0; j < D; ++j) mu[j] = static_cast<T>(s[j] / double(N));
+        ybar = static_cast<T>(sy / double(N));
+    }
+    const size_t W = D + 1;
+    std::vector<T> C(W * W);
+    centred_xy_syrk(X, y, N, D, mu.data(), ybar, C.data());
+    G.resize(D * D);
+    q.resize(D);
+    for (size_t i = 0; i < D; ++i) {
+        for (size_t j = i; j < D; ++j) G[i * D + j] = G[j * D + i] = C[i * W + j];
+        q[i] = C[i * W + D];
+    }
+}
+
+// min ||y - X w - b||^2 + alpha ||w||^2 via the regularised normal equations
+template <typename T>
+void ridge_fit(const T* X, const T* y, size_t N, size_t D, T alpha,
+               bool fit_intercept, T* coef, T& intercept) {
+    std::vector<T> G, q, mu;
+    T ybar;
+    normal_equations(X, y, N, D, fit_intercept, G, q, mu, ybar);
+    std::vector<double> A(G.begin(), G.end()), b(q.begin(), q.end());
+    for (size_t i = 0; i < D; ++i) A[i * D + i] += alpha;
+    spd_solve(A, D, b.data(), "ridge");
+    double b0 = ybar;
+    for (size_t j = 0; j < D; ++j) {
+        coef[j] = static_cast<T>(b[j]);
+        b0 -= b[j] * mu[j];
+    }
+    intercept = fit_intercept ? static_cast<T>(b0) : T(0);
+}
+
+// soft-thresholding operator S(x, t) = sign(x) max(|x| - t, 0)
+template <typename T>
+T soft_threshold(T x, T t) {
+    return x > t ? x - t : (x < -t ? x + t : T(0));
+}
+
+// min 1/(2N) ||y - X w - b||^2 + alpha ||w||_1 by cyclic coordinate
+// descent on the Gram matrix (covariance updates): each coordinate step is
+// O(D) and independent of N, with G w kept current by a SIMD axpy.
+template <typename T>
+void lasso_fit(const T* X, const T* y, size_t N, size_t D, T alpha,
+               size_t max_iter, T tol, bool fit_intercept, T* coef, T& intercept) {
+    std::vector<T> G, q, mu;
+    T ybar;
+    normal_equations(X, y, N, D, fit_intercept, G, q, mu, ybar);
+    std::vector<T> Gw(D, T(0));
+    std::fill(coef, coef + D, T(0));
+
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    const T nalpha = alpha * T(N);
+    for (size_t it = 0; it < max_iter; ++it) {
+        T max_delta = T(0), max_w = T(0);
+        for (size_t j = 0; j < D; ++j) {
+            const T gjj = G[j * D + j];
+            if (gjj <= T(0)) continue;
+            const T wj = coef[j];
+            const T rho = q[j] - Gw[j] + gjj * wj;
+            const T wn = soft_threshold(rho, nalpha) / gjj;
+            const T delta = wn - wj;
+            if (delta == T(0)) continue;
+            coef[j] = wn;
+            // Gw += delta * G[:, j]  (G is symmetric, so row j)
+            const T* gj = G.data() + j * D;
+            const auto vd = Set(d, delta);
+            size_t i = 0;
+            for (; i + L <= D; i += L)
+                StoreU(MulAdd(vd, LoadU(d, gj + i), LoadU(d, Gw.data() + i)), d, Gw.data() + i);
+            for (; i < D; ++i) Gw[i] += delta * gj[i];
+            max_delta = std::max(max_delta, std::abs(delta));
+            max_w = std::max(max_w, std::abs(wn));
+        }
+        if (max_delta <= tol * std::max(max_w, T(1e-12))) break;
+    }
+
+    double b0 = ybar;
+    for (size_t j = 0; j < D; ++j) b0 -= double(coef[j]) * mu[j];
+    intercept = fit_intercept ? static_cast<T>(b0) : T(0);
+}
+
+// Fused logistic epilogue over n logits z with 0/1 targets y: writes the
+// residual r = sigmoid(z) - y and returns sum log(1 + e^z) - y z, both
+// evaluated in the overflow-safe form through e^-|z|, with the exp and
+// log kernels of precision tier P.
+template <Mode P, typename T>
+double logistic_residual(const T* z, const T* y, size_t n, T* r) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    const auto zero = Zero(d);
+    const auto one = Set(d, T(1));
+    auto acc = Zero(d);
+    size_t i = 0;
+    for (; i + L <= n; i += L) {
+        const auto vz = LoadU(d, z + i);
+        const auto vy = LoadU(d, y + i);
+        const auto e = exp_p<P>(d, Neg(Abs(vz)));
+        const auto loss = Sub(Add(Max(vz, zero), log1p_p<P>(d, e)), Mul(vy, vz));
+        const auto inv = Div(one, Add(one, e));
+        const auto p = IfThenElse(Ge(vz, zero), inv, Mul(e, inv));
+        acc = Add(acc, loss);
+        StoreU(Sub(p, vy), d, r + i);
+    }
+    double total = GetLane(SumOfLanes(d, acc));
+    for (; i < n; ++i) {
+        const T e = std::exp(-std::abs(z[i]));
+        total += std::max(z[i], T(0)) + std::log1p(e) - y[i] * z[i];
+        const T p = z[i] >= T(0) ? T(1) / (T(1) + e) : e / (T(1) + e);
+        r[i] = p - y[i];
+    }
+    return total;
+}
+
+// rows per fused gemv -> sigmoid -> gemv^T block, sized so the block of X
+// is still in cache for the transposed product
+constexpr size_t kLogisticBlock = 256;
+
+// Loss and gradient of sum log(1 + e^z) - y z + alpha/2 ||w||^2 with
+// z = X w + b. params is [w (D), b]; grad has the same layout.
+template <typename T>
+double logistic_loss_grad(const T* X, const T* y, size_t N, size_t D, T alpha,
+                          bool fit_intercept, const T* params, T* grad) {
+    const size_t nt = parallel_threads(N, kTallSkinnyGrain);
+    std::vector<T> partial(nt * (D + 1), T(0));
+    std::vector<double> losses(nt, 0.0);
+    const T b = fit_intercept ? params[D] : T(0);
+    const Mode mode = precision::mode();
+
+    parallel_chunks(N, nt, [&](size_t t, size_t begin, size_t end) {
+        T z[kLogisticBlock], r[kLogisticBlock];
+        T* g = partial.data() + t * (D + 1);
+        double loss = 0.0;
+        for (size_t r0 = begin; r0 < end; r0 += kLogisticBlock) {
+            const size_t rows = std::min(kLogisticBlock, end - r0);
+            const T* Xb = X + r0 * D;
+            std::fill(z, z + rows, b);
+            gemv<T>(false, rows, D, T(1), Xb, D, params, T(1), z);
+            precision::dispatch(mode, [&](auto m) {
+                loss += logistic_residual<decltype(m)::value>(z, y + r0, rows, r);
+            });
+            gemv<T>(true, rows, D, T(1), Xb, D, r, T(1), g);
+            for (size_t i = 0; i < rows; ++i) g[D] += r[i];
+        }
+        losses[t] = loss;
+    });
+
+    double loss = 0.0;
+    std::fill(grad, grad + D + 1, T(0));
+    for (size_t t = 0; t < nt; ++t) {
+        loss += losses[t];
+        for (size_t j = 0; j <= D; ++j) grad[j] += partial[t * (D + 1) + j];
+    }
+    double reg = 0.0;
+    for (size_t j = 0; j < D; ++j) {
+        reg += double(params[j]) * params[j];
+        grad[j] += alpha * params[j];
+    }
+    if (!fit_intercept) grad[D] = T(0);
+    return loss + 0.5 * alpha * reg;
+}
+
+// L2-regularised logistic regression by L-BFGS (history 10) with a
+// backtracking Armijo line search.
+template <typename T>
+void logistic_fit(const T* X, const T* y, size_t N, size_t D, T alpha,
+                  size_t max_iter, T tol, bool fit_intercept, T* coef, T& intercept) {
+    const size_t P = D + 1, history = 10;
+    std::vector<T> w(P, T(0)), g(P), wn(P), gn(P), dir(P);
+    std::deque<std::vector<T>> S, Y;
+    std::deque<double> rho;
+    auto dotp = [P](const T* a, const T* b) {
+        double s = 0.0;
+        for (size_t i = 0; i < P; ++i) s += double(a[i]) * b[i];
+        return s;
+    };
+
+    double f = logistic_loss_grad(X, y, N, D, alpha, fit_intercept, w.data(), g.data());
+    const double g0 = std::sqrt(dotp(g.data(), g.data()));
+    for (size_t it = 0; it < max_iter; ++it) {
+        const double gnorm = std::sqrt(dotp(g.data(), g.data()));
+        if (gnorm <= tol * std::max(1.0, g0)) break;
+
+        // two-loop recursion: dir = -H g
+        for (size_t i = 0; i < P; ++i) dir[i] = -g[i];
+        std::vector<double> a(S.size());
+        for (size_t k = S.size(); k-- > 0;) {
+            a[k] = rho[k] * dotp(S[k].data(), dir.data());
+            for (size_t i = 0; i < P; ++i) dir[i] -= static_cast<T>(a[k]) * Y[k][i];
+        }
+        if (!S.empty()) {
+            const double gamma = dotp(S.back().data(), Y.back().data()) /
+                                 dotp(Y.back().data(), Y.back().data());
+            for (size_t i = 0; i < P; ++i) dir[i] *= static_cast<T>(gamma);
+        } else {
+            for (size_t i = 0; i < P; ++i) dir[i] /= static_cast<T>(gnorm);
+        }
+        for (size_t k = 0; k < S.size(); ++k) {
+            const double bk = rho[k] * dotp(Y[k].data(), dir.data());
+            for (size_t i = 0; i < P; ++i) dir[i] += static_cast<T>(a[k] - bk) * S[k][i];
+        }
+
+        double slope = dotp(g.data(), dir.data());
+        if (slope >= 0.0) {
+            // not a descent direction, restart from steepest descent
+            S.clear(); Y.clear(); rho.clear();
+            for (size_t i = 0; i < P; ++i) dir[i] = -g[i] / static_cast<T>(gnorm);
+            slope = -gnorm;
+        }
+        double step = 1.0, fn = f;
+        bool accepted = false;
+        for (int ls = 0; ls < 40; ++ls) {
+            for (size_t i = 0; i < P; ++i) wn[i] = w[i] + static_cast<T>(step) * dir[i];
+            fn = logistic_loss_grad(X, y, N, D, alpha, fit_intercept, wn.data(), gn.data());
+            if (fn <= f + 1e-4 * step * slope) { accepted = true; break; }
+            step *= 0.5;
+        }
+        if (!accepted) break;
+
+        std::vector<T> s(P), yk(P);
+        for (size_t i = 0; i < P; ++i) { s[i] = wn[i] - w[i]; yk[i] = gn[i] - g[i]; }
+        const double sy = dotp(s.data(), yk.data());
+        if (sy > 1e-12) {
+            if (S.size() == history) { S.pop_front(); Y.pop_front(); rho.pop_front(); }
+            S.push_back(std::move(s));
+            Y.push_back(std::move(yk));
+            rho.push_back(1.0 / sy);
+        }
+        const double rel = std::abs(f - fn) / std::max({ std::abs(f), std::abs(fn), 1.0 });
+        w.swap(wn);
+        g.swap(gn);
+        f = fn;
+        if (rel <= double(std::numeric_limits<T>::epsilon())) break;
+    }
+
+    std::copy(w.begin(), w.begin() + D, coef);
+    intercept = fit_intercept ? w[D] : T(0);
+}
+
+// Fits B independent models on Xs (B, N, D), ys (B, N): models are spread
+// across threads and each one runs its single-threaded path.
+template <typename T, typename Fit>
+LinearFitBatch<T> fit_batch(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<3>> Xs,
+                            nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> ys,
+                            const char* fn, Fit fit) {
+    const size_t B = Xs.shape(0), N = Xs.shape(1), D = Xs.shape(2);
+    if (ys.shape(0) != B || ys.shape(1) != N)
+        throw std::runtime_error(std::string(fn) + ": X and y batch shapes must match");
+    T* coef = static_cast<T*>(aligned_alloc64(B * D * sizeof(T)));
+    T* icpt = static_cast<T*>(aligned_alloc64(B * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule c_owner(coef, [](void* p) noexcept { _aligned_free(p); });
+    nb::capsule i_owner(icpt, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule c_owner(coef, [](void* p) noexcept { free(p); });
+    nb::capsule i_owner(icpt, [](void* p) noexcept { free(p); });
+#endif
+    const T* X = Xs.data();
+    const T* y = ys.data();
+    {
+        nb::gil_scoped_release release;
+        parallel_for(B, 1, [&](size_t, size_t b, size_t e) {
+            for (size_t m = b; m < e; ++m)
+                fit(X + m * N * D, y + m * N, N, D, coef + m * D, icpt[m]);
+        });
+    }
+    return { nb::ndarray<nb::numpy, T, nb::ndim<2>>(coef, { B, D }, c_owner),
+             nb::ndarray<nb::numpy, T, nb::ndim<1>>(icpt, { B }, i_owner) };
+}
+
+inline void check_xy(size_t n_x, size_t n_y, const char* fn) {
+    if (n_x != n_y) throw std::runtime_error(std::string(fn) + ": X and y must have the same number of rows");
+    if (n_x == 0) throw std::runtime_error(std::string(fn) + ": zero-length input");
+}
+
+template <typename T>
+LinearFit<T> ridge(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> X,
+                   nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>> y,
+                   T alpha, bool fit_intercept) {
+    const size_t N = X.shape(0), D = X.shape(1);
+    check_xy(N, y.shape(0), "ridge");
+    T* coef = static_cast<T*>(aligned_alloc64(D * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(coef, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(coef, [](void* p) noexcept { free(p); });
+#endif
+    T intercept;
+    {
+        nb::gil_scoped_release release;
+        ridge_fit(X.data(), y.data(), N, D, alpha, fit_intercept, coef, intercept);
+    }
+    return { nb::ndarray<nb::numpy, T, nb::ndim<1>>(coef, { D }, deleter), intercept };
+}
+
+template <typename T>
+LinearFitBatch<T> ridge(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<3>> Xs,
+                        nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> ys,
+                        T alpha, bool fit_intercept) {
+    return fit_batch<T>(Xs, ys, "ridge",
+        [=](const T* X, const T* y, size_t N, size_t D, T* coef, T& b) {
+            ridge_fit(X, y, N, D, alpha, fit_intercept, coef, b);
+        });
+}
+
+template <typename T>
+LinearFit<T> lasso(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> X,
+                   nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>> y,
+                   T alpha, size_t max_iter, T tol, bool fit_intercept) {
+    const size_t N = X.shape(0), D = X.shape(1);
+    check_xy(N, y.shape(0), "lasso");
+    T* coef = static_cast<T*>(aligned_alloc64(D * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(coef, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(coef, [](void* p) noexcept { free(p); });
+#endif
+    T intercept;
+    {
+        nb::gil_scoped_release release;
+        lasso_fit(X.data(), y.data(), N, D, alpha, max_iter, tol, fit_intercept, coef, intercept);
+    }
+    return { nb::ndarray<nb::numpy, T, nb::ndim<1>>(coef, { D }, deleter), intercept };
+}
+
+template <typename T>
+LinearFitBatch<T> lasso(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<3>> Xs,
+                        nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> ys,
+                        T alpha, size_t max_iter, T tol, bool fit_intercept) {
+    return fit_batch<T>(Xs, ys, "lasso",
+        [=](const T* X, const T* y, size_t N, size_t D, T* coef, T& b) {
+            lasso_fit(X, y, N, D, alpha, max_iter, tol, fit_intercept, coef, b);
+        });
+}
+
+template <typename T>
+LinearFit<T> logistic_regression(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> X,
+                                 nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>> y,
+                                 T alpha, size_t max_iter, T tol, bool fit_intercept) {
+    const size_t N = X.shape(0), D = X.shape(1);
+    check_xy(N, y.shape(0), "logistic_regression");
+    T* coef = static_cast<T*>(aligned_alloc64(D * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(coef, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(coef, [](void* p) noexcept { free(p); });
+#endif
+    T intercept;
+    {
+        nb::gil_scoped_release release;
+        logistic_fit(X.data(), y.data(), N, D, alpha, max_iter, tol, fit_intercept, coef, intercept);
+    }
+    return { nb::ndarray<nb::numpy, T, nb::ndim<1>>(coef, { D }, deleter), intercept };
+}
+
+template <typename T>
+LinearFitBatch<T> logistic_regression(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<3>> Xs,
+                                      nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> ys,
+                                      T alpha, size_t max_iter, T tol, bool fit_intercept) {
+    return fit_batch<T>(Xs, ys, "logistic_regression",
+        [=](const T* X, const T* y, size_t N, size_t D, T* coef, T& b) {
+            logistic_fit(X, y, N, D, alpha, max_iter, tol, fit_intercept, coef, b);
+        });
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+#include "../simd/linalg.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+enum class Metric { SqEuclidean, Euclidean, Cosine };
+
+inline Metric parse_metric(const std::string& name, const char* fn) {
+    if (name == "sqeuclidean") return Metric::SqEuclidean;
+    if (name == "euclidean") return Metric::Euclidean;
+    if (name == "cosine") return Metric::Cosine;
+    throw std::runtime_error(std::string(fn) +
+        ": metric must be 'sqeuclidean', 'euclidean' or 'cosine'");
+}
+
+// query rows and reference columns per tile; a (64, 1024) tile of
+// cross products stays resident in L2 while the epilogue runs over it
+constexpr size_t kQueryBlock = 64;
+constexpr size_t kRefBlock = 1024;
+
+// Per-row norms used by the epilogue: squared norms for the euclidean
+// metrics, reciprocal norms (0 for zero rows) for cosine.
+template <typename T>
+std::vector<T> metric_norms(const T* X, size_t N, size_t D, Metric metric) {
+    std::vector<T> out(N);
+    parallel_for(N, 4096, [&](size_t, size_t b, size_t e) {
+        row_sq_norms(X + b * D, e - b, D, out.data() + b);
+        if (metric == Metric::Cosine) {
+            for (size_t i = b; i < e; ++i)
+                out[i] = out[i] > T(0) ? T(1) / std::sqrt(out[i]) : T(0);
+        }
+    });
+    return out;
+}
+
+// Rewrites g[0:n] = x.y_j in place as a rank-preserving partial distance:
+// ||y_j||^2 - 2 x.y_j for the euclidean metrics (||x||^2 is added later)
+// and -x.y_j / ||y_j|| for cosine (1 / ||x|| is applied later).
+template <typename T>
+void partial_distances(T* g, const T* yn, size_t n, Metric metric) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    size_t j = 0;
+    if (metric == Metric::Cosine) {
+        for (; j + L <= n; j += L)
+            StoreU(Neg(Mul(LoadU(d, g + j), LoadU(d, yn + j))), d, g + j);
+        for (; j < n; ++j) g[j] = -g[j] * yn[j];
+    } else {
+        const auto neg2 = Set(d, T(-2));
+        for (; j + L <= n; j += L)
+            StoreU(MulAdd(neg2, LoadU(d, g + j), LoadU(d, yn + j)), d, g + j);
+        for (; j < n; ++j) g[j] = yn[j] - T(2) * g[j];
+    }
+}
+
+// maps a partial distance back to the metric's value for a query with
+// norm term xn (||x||^2, or 1 / ||x|| for cosine)
+template <typename T>
+T finish_distance(T partial, T xn, Metric metric) {
+    switch (metric) {
+        case Metric::SqEuclidean: return std::max(T(0), partial + xn);
+        case Metric::Euclidean: return std::sqrt(std::max(T(0), partial + xn));
+        case Metric::Cosine: default: return T(1) + partial * xn;
+    }
+}
+
+// finish_distance over a whole row of partial distances
+template <typename T>
+void finish_row(T* row, size_t n, T xn, Metric metric) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    const auto vx = Set(d, xn);
+    const auto zero = Zero(d);
+    size_t j = 0;
+    for (; j + L <= n; j += L) {
+        auto v = LoadU(d, row + j);
+        switch (metric) {
+            case Metric::SqEuclidean: v = Max(zero, Add(v, vx)); break;
+            case Metric::Euclidean: v = Sqrt(Max(zero, Add(v, vx))); break;
+            case Metric::Cosine: v = MulAdd(v, vx, Set(d, T(1))); break;
+        }
+        StoreU(v, d, row + j);
+    }
+    for (; j < n; ++j) row[j] = finish_distance(row[j], xn, metric);
+}
+
+// Full (N, M) distance matrix. Each query block is filled by one GEMM into
+// the output rows and finished in place by the SIMD epilogue.
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<2>>
+cdist(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> X,
+      nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> Y,
+      const std::string& metric_name) {
+    const size_t N = X.shape(0), D = X.shape(1), M = Y.shape(0);
+    if (Y.shape(1) != D) throw std::runtime_error("cdist: feature dims must match");
+    const Metric metric = parse_metric(metric_name, "cdist");
+    const T* A = X.data();
+    const T* B = Y.data();
+
+    T* C = static_cast<T*>(aligned_alloc64(N * M * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+
+    {
+        nb::gil_scoped_release release;
+        const std::vector<T> xn = metric_norms(A, N, D, metric);
+        const std::vector<T> yn = metric_norms(B, M, D, metric);
+        const size_t nblocks = (N + kQueryBlock - 1) / kQueryBlock;
+
+        parallel_for(nblocks, 1, [&](size_t, size_t bb, size_t be) {
+            for (size_t blk = bb; blk < be; ++blk) {
+                const size_t r0 = blk * kQueryBlock;
+                const size_t rows = std::min(kQueryBlock, N - r0);
+                T* Cb = C + r0 * M;
+                gemm<T>(false, true, rows, M, D, T(1), A + r0 * D, D, B, D, T(0), Cb, M);
+                for (size_t r = 0; r < rows; ++r) {
+                    T* row = Cb + r * M;
+                    partial_distances(row, yn.data(), M, metric);
+                    finish_row(row, M, xn[r0 + r], metric);
+                }
+            }
+        });
+    }
+
+    return { C, { N, M }, deleter };
+}
+
+// k nearest rows of Y for every row of X, sorted by increasing distance.
+// Tiles of X.Y^T are produced by GEMM into a per-thread buffer and each
+// query keeps a bounded max-heap of its best k candidates, so only the
+// (N, k) results are ever materialised.
+template <typename T>
+std::tuple<nb::ndarray<nb::numpy, T, nb::ndim<2>>,
+           nb::ndarray<nb::numpy, int64_t, nb::ndim<2>>>
+knn(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> X,
+    nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> Y,
+    size_t k, const std::string& metric_name) {
+    const size_t N = X.shape(0), D = X.shape(1), M = Y.shape(0);
+    if (Y.shape(1) != D) throw std::runtime_error("knn: feature dims must match");
+    if (k == 0 || k > M) throw std::runtime_error("knn: k must be in [1, len(Y)]");
+    const Metric metric = parse_metric(metric_name, "knn");
+    const T* A = X.data();
+    const T* B = Y.data();
+
+    T* dist = static_cast<T*>(aligned_alloc64(N * k * sizeof(T)));
+    int64_t* idx = static_cast<int64_t*>(aligned_alloc64(N * k * sizeof(int64_t)));
+#if defined(_MSC_VER)
+    nb::capsule d_owner(dist, [](void* p) noexcept { _aligned_free(p); });
+    nb::capsule i_owner(idx, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule d_owner(dist, [](void* p) noexcept { free(p); });
+    nb::capsule i_owner(idx, [](void* p) noexcept { free(p); });
+#endif
+
+    {
+        nb::gil_scoped_release release;
+        const std::vector<T> xn = metric_norms(A, N, D, metric);
+        const std::vector<T> yn = metric_norms(B, M, D, metric);
+        const size_t nblocks = (N + kQueryBlock - 1) / kQueryBlock;
+
+        parallel_for(nblocks, 1, [&](size_t, size_t bb, size_t be) {
+            using Entry = std::pair<T, int64_t>;  // (partial distance, index)
+            const ScalableTag<T> d;
+            const size_t L = Lanes(d);
+            std::vector<T> G(kQueryBlock * kRefBlock);
+            std::vector<std::vector<Entry>> heaps(kQueryBlock);
+            for (auto& h : heaps) h.reserve(k);
+            auto offer = [k](std::vector<Entry>& h, const Entry& e) {
+                if (h.size() < k) {
+                    h.push_back(e);
+                    std::push_heap(h.begin(), h.end());
+                } else if (e < h.front()) {
+                    std::pop_heap(h.begin(), h.end());
+                    h.back() = e;
+                    std::push_heap(h.begin(), h.end());
+                }
+            };
+
+            for (size_t blk = bb; blk < be; ++blk) {
+                const size_t r0 = blk * kQueryBlock;
+                const size_t rows = std::min(kQueryBlock, N - r0);
+                for (size_t r = 0; r < rows; ++r) heaps[r].clear();
+
+                for (size_t c0 = 0; c0 < M; c0 += kRefBlock) {
+                    const size_t cols = std::min(kRefBlock, M - c0);
+                    gemm<T>(false, true, rows, cols, D, T(1), A + r0 * D, D,
+                            B + c0 * D, D, T(0), G.data(), cols);
+                    for (size_t r = 0; r < rows; ++r) {
+                        T* g = G.data() + r * cols;
+                        auto& h = heaps[r];
+                        partial_distances(g, yn.data() + c0, cols, metric);
+                        size_t j = 0;
+                        // once the heap is full, skip whole vectors that cannot
+                        // beat the current k-th best
+                        for (; j + L <= cols; j += L) {
+                            if (h.size() == k &&
+                                AllFalse(d, Lt(LoadU(d, g + j), Set(d, h.front().first))))
+                                continue;
+                            for (size_t l = j; l < j + L; ++l)
+                                offer(h, Entry{ g[l], static_cast<int64_t>(c0 + l) });
+                        }
+                        for (; j < cols; ++j)
+                            offer(h, Entry{ g[j], static_cast<int64_t>(c0 + j) });
+                    }
+                }
+
+                for (size_t r = 0; r < rows; ++r) {
+                    auto& h = heaps[r];
+                    std::sort_heap(h.begin(), h.end());
+                    const size_t q = r0 + r;
+                    for (size_t j = 0; j < k; ++j) {
+                        dist[q * k + j] = finish_distance(h[j].first, xn[q], metric);
+                        idx[q * k + j] = h[j].second;
+                    }
+                }
+            }
+        });
+    }
+
+    return { nb::ndarray<nb::numpy, T, nb::ndim<2>>(dist, { N, k }, d_owner),
+             nb::ndarray<nb::numpy, int64_t, nb::ndim<2>>(idx, { N, k }, i_owner) };
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
@@ -29,15 +29,15 @@ struct Symbol##Op {                                                  \
     }                                                                \
 };                                                                   \
 inline nb::ndarray<nb::numpy, float, nb::ndim<1>>                    \
-Symbol(nb::ndarray<float, nb::c_contig> a,                           \
-    nb::ndarray<float, nb::c_contig> b) {                            \
+Symbol(nb::ndarray<float, nb::c_contig, nb::device::cpu> a,                           \
+    nb::ndarray<float, nb::c_contig, nb::device::cpu> b) {                            \
     return binary<Symbol##Op>(a, b);                                 \
 }
 
 template <typename Op>
 nb::ndarray<nb::numpy, float, nb::ndim<1>>
-binary(nb::ndarray<float, nb::c_contig> a,
-    nb::ndarray<float, nb::c_contig> b)
+binary(nb::ndarray<float, nb::c_contig, nb::device::cpu> a,
+    nb::ndarray<float, nb::c_contig, nb::device::cpu> b)
 {
     const size_t N = a.shape(0);
     if (b.shape(0) != N) throw std::runtime_error("shape mismatch");
@@ -78,7 +78,7 @@ DEFINE_SIMD_BINARY_OP(Sub, a - b, Sub(A,B));
 DEFINE_SIMD_BINARY_OP(Mul, a * b, Mul(A,B));
 DEFINE_SIMD_BINARY_OP(Div, a / b, Div(A,B));
 
-inline float reduce_sum(nb::ndarray<float, nb::c_contig> a) {
+inline float reduce_sum(nb::ndarray<float, nb::c_contig, nb::device::cpu> a) {
     float* A = a.data();
     const size_t N = a.shape(0);
     const ScalableTag<float> d;
@@ -91,7 +91,7 @@ inline float reduce_sum(nb::ndarray<float, nb::c_contig> a) {
     return total;
 }
 
-inline float reduce_max(nb::ndarray<float, nb::c_contig> a) {
+inline float reduce_max(nb::ndarray<float, nb::c_contig, nb::device::cpu> a) {
     float* A = a.data();
     const size_t N = a.shape(0);
     const ScalableTag<float> d;
@@ -105,8 +105,8 @@ inline float reduce_max(nb::ndarray<float, nb::c_contig> a) {
     return m;
 }
 
-inline float dot(nb::ndarray<float, nb::c_contig> a,
-                 nb::ndarray<float, nb::c_contig> b) {
+inline float dot(nb::ndarray<float, nb::c_contig, nb::device::cpu> a,
+                 nb::ndarray<float, nb::c_contig, nb::device::cpu> b) {
     float* A = a.data(); float* B = b.data();
     const size_t N = a.shape(0);
     if (b.shape(0) != N) throw std::runtime_error("shape mismatch");
@@ -130,8 +130,8 @@ static float _dot(const float* A, const float* B, size_t N) {
 }
 
 inline nb::ndarray<nb::numpy, float, nb::ndim<2>>
-matmul(nb::ndarray<float, nb::c_contig, nb::ndim<2>> A,
-       nb::ndarray<float, nb::c_contig, nb::ndim<2>> B) {
+matmul(nb::ndarray<float, nb::c_contig, nb::device::cpu, nb::ndim<2>> A,
+       nb::ndarray<float, nb::c_contig, nb::device::cpu, nb::ndim<2>> B) {
     size_t M = A.shape(0), K = A.shape(1);
     if (B.shape(0) != K)
         throw std::runtime_error("matmul: inner dims must match");
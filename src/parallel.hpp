@@ -0,0 +1,244 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+// set while a thread is executing a parallel_for body; nested loops then
+// run inline instead of spawning another set of workers
+inline thread_local bool in_parallel_region = false;
+
+// Threading runtime shared by every parallel loop and by BLAS. One pool of
+// num_threads() - 1 persistent workers (the calling thread is the last
+// one) serves one parallel_for at a time; a loop that finds the pool taken
+// by another Python thread runs its chunks in order on its own thread
+// rather than oversubscribing the cores. BLAS calls claim the same pool
+// (see BlasThreads in simd/linalg.hpp), so BLAS only gets more than one
+// thread when nothing else holds the cores.
+namespace runtime {
+
+inline size_t hardware_threads() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// CAPNHOOK_NUM_THREADS, or every hardware thread
+inline size_t env_threads() {
+    const char* v = std::getenv("CAPNHOOK_NUM_THREADS");
+    const size_t n = v && *v ? size_t(std::strtoull(v, nullptr, 10)) : 0;
+    return n ? n : hardware_threads();
+}
+
+// CAPNHOOK_PIN_THREADS set to anything but 0
+inline bool env_pinning() {
+    const char* v = std::getenv("CAPNHOOK_PIN_THREADS");
+    return v && *v && std::string(v) != "0";
+}
+
+inline std::atomic<size_t> g_num_threads{ env_threads() };
+inline std::atomic<bool> g_pinning{ env_pinning() };
+
+inline size_t num_threads() { return g_num_threads.load(std::memory_order_relaxed); }
+inline bool pinning() { return g_pinning.load(std::memory_order_relaxed); }
+
+// pins the calling thread to one core (Linux only; elsewhere a no-op)
+inline void pin_to_core(size_t core) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(int(core % hardware_threads()), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+
+class Pool {
+public:
+    ~Pool() { stop(); }
+
+    // held for the duration of a parallel loop or a multi-threaded BLAS call
+    std::mutex busy;
+
+    // runs task(t) for t in [0, nt), t = 0 on the calling thread; the
+    // caller holds `busy`
+    void run(size_t nt, const std::function<void(size_t)>& task) {
+        start(nt - 1);
+        {
+            std::lock_guard<std::mutex> g(m_);
+            task_ = &task;
+            ntasks_ = nt;
+            pending_ = nt - 1;
+            ++gen_;
+        }
+        cv_.notify_all();
+        task(0);
+        std::unique_lock<std::mutex> g(m_);
+        done_.wait(g, [&] { return pending_ == 0; });
+        task_ = nullptr;
+    }
+
+    // joins the workers; the next run() starts a fresh set (used when the
+    // thread count or pinning changes), with `busy` held by the caller
+    void stop() {
+        {
+            std::lock_guard<std::mutex> g(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& w : workers_) w.join();
+        workers_.clear();
+        stop_ = false;
+    }
+
+    // in a forked child, where only the forking thread exists: the worker
+    // handles are abandoned (joining them would wait forever) and the locks
+    // re-created in case another thread held them at the fork, so the next
+    // run() starts a fresh set of workers
+    void after_fork() {
+        new (&busy) std::mutex;
+        new (&m_) std::mutex;
+        new (&cv_) std::condition_variable;
+        new (&done_) std::condition_variable;
+        new std::vector<std::thread>(std::move(workers_));  // leaked, never joined
+        workers_.clear();
+        task_ = nullptr;
+        ntasks_ = pending_ = 0;
+        stop_ = false;
+    }
+
+private:
+    // grows the pool to at least n workers
+    void start(size_t n) {
+        while (workers_.size() < n) {
+            const size_t w = workers_.size();
+            const uint64_t gen = gen_;
+            workers_.emplace_back([this, w, gen] { work(w, gen); });
+        }
+    }
+
+    void work(size_t w, uint64_t seen) {
+        in_parallel_region = true;
+        if (pinning()) pin_to_core(w + 1);
+        for (;;) {
+            std::unique_lock<std::mutex> g(m_);
+            cv_.wait(g, [&] { return stop_ || gen_ != seen; });
+            if (stop_) return;
+            seen = gen_;
+            const auto* task = task_;
+            const size_t t = w + 1;
+            if (t >= ntasks_) continue;  // not needed for this loop
+            g.unlock();
+            (*task)(t);
+            g.lock();
+            if (--pending_ == 0) done_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex m_;
+    std::condition_variable cv_, done_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t ntasks_ = 0, pending_ = 0;
+    uint64_t gen_ = 0;
+    bool stop_ = false;
+};
+
+inline Pool& pool() {
+    static Pool p;
+#if !defined(_WIN32)
+    // multiprocessing and DataLoader workers fork with the pool running
+    static const int at_fork = pthread_atfork(nullptr, nullptr, [] { pool().after_fork(); });
+    (void)at_fork;
+#endif
+    return p;
+}
+
+// sets the thread budget (0 restores the default) and returns the previous
+// one; waits for a running loop to finish
+inline size_t set_num_threads(size_t n) {
+    std::lock_guard<std::mutex> g(pool().busy);
+    const size_t prev = g_num_threads.exchange(n ? n : env_threads());
+    pool().stop();
+    return prev;
+}
+
+// pins worker t to core t (the calling thread is left alone); returns the
+// previous setting
+inline bool set_pinning(bool enabled) {
+    std::lock_guard<std::mutex> g(pool().busy);
+    const bool prev = g_pinning.exchange(enabled);
+    pool().stop();
+    return prev;
+}
+
+} // runtime
+
+// number of workers used for a loop over n items, with at least `grain`
+// items per worker
+inline size_t parallel_threads(size_t n, size_t grain) {
+    if (in_parallel_region) return 1;
+    size_t by_work = std::max<size_t>(1, n / std::max<size_t>(1, grain));
+    return std::min(runtime::num_threads(), by_work);
+}
+
+// splits [0, n) into nt contiguous chunks and calls fn(tid, begin, end)
+// once per chunk, tid < nt. Callers that size per-thread state take nt from
+// parallel_threads once and pass the same value here, so a concurrent
+// set_num_threads cannot hand out a tid past their buffers.
+template <typename F>
+void parallel_chunks(size_t n, size_t nt, F&& fn) {
+    if (nt <= 1) {
+        fn(size_t(0), size_t(0), n);
+        return;
+    }
+    const size_t chunk = (n + nt - 1) / nt;
+    auto& pool = runtime::pool();
+    std::unique_lock<std::mutex> lock;
+    if (!in_parallel_region) lock = std::unique_lock<std::mutex>(pool.busy, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        // the workers belong to another thread's loop (or to the loop this
+        // one is nested in): same chunks, in order
+        const bool outer = !in_parallel_region;
+        in_parallel_region = true;
+        struct Region {
+            bool outer;
+            ~Region() { if (outer) in_parallel_region = false; }
+        } region{ outer };
+        for (size_t t = 0; t < nt; ++t)
+            fn(t, std::min(n, t * chunk), std::min(n, (t + 1) * chunk));
+        return;
+    }
+    std::vector<std::exception_ptr> errors(nt);
+    pool.run(nt, [&](size_t t) {
+        const bool outer = !in_parallel_region;
+        in_parallel_region = true;
+        try { fn(t, std::min(n, t * chunk), std::min(n, (t + 1) * chunk)); }
+        catch (...) { errors[t] = std::current_exception(); }
+        if (outer) in_parallel_region = false;
+    });
+    for (auto& e : errors) if (e) std::rethrow_exception(e);
+}
+
+// splits [0, n) into parallel_threads(n, grain) contiguous chunks and calls
+// fn(tid, begin, end) once per chunk; loops with thread-local state use
+// parallel_chunks with the nt they sized it for
+template <typename F>
+void parallel_for(size_t n, size_t grain, F&& fn) {
+    parallel_chunks(n, parallel_threads(n, grain), std::forward<F>(fn));
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+// Per-op profiling counters. Every function registered through
+// binding::module is wrapped so that, while profiling is on, each call
+// records its wall time, the bytes of its array arguments and results, and
+// the aligned_alloc64 calls made while it ran. When profiling is off the
+// wrapper costs one relaxed load and a branch; building with
+// CAPNHOOK_ENABLE_PROFILING=0 removes the wrappers altogether.
+#ifndef CAPNHOOK_ENABLE_PROFILING
+#define CAPNHOOK_ENABLE_PROFILING 1
+#endif
+
+namespace nb = nanobind;
+
+namespace profile {
+
+// starts enabled when the CAPNHOOK_PROFILE environment variable is set to
+// anything but 0
+inline bool env_enabled() {
+    const char* v = std::getenv("CAPNHOOK_PROFILE");
+    return v && *v && std::string(v) != "0";
+}
+
+inline std::atomic<bool> g_enabled{ env_enabled() };
+inline std::atomic<uint64_t> g_allocs{ 0 };
+inline std::atomic<uint64_t> g_alloc_bytes{ 0 };
+
+inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+inline void set_enabled(bool on) { g_enabled.store(on, std::memory_order_relaxed); }
+
+// called by aligned_alloc64
+inline void on_alloc(size_t bytes) {
+    if (!enabled()) return;
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+struct OpStats {
+    std::atomic<uint64_t> calls{ 0 };
+    std::atomic<uint64_t> total_ns{ 0 };
+    std::atomic<uint64_t> max_ns{ 0 };
+    std::atomic<uint64_t> bytes_read{ 0 };
+    std::atomic<uint64_t> bytes_written{ 0 };
+    std::atomic<uint64_t> allocs{ 0 };
+    std::atomic<uint64_t> alloc_bytes{ 0 };
+};
+
+// one slot per op name, shared by its float and double overloads; map
+// nodes never move, so wrappers keep a pointer to their slot
+inline std::map<std::string, OpStats>& table() {
+    static std::map<std::string, OpStats> t;
+    return t;
+}
+
+inline OpStats* slot(const std::string& name) {
+    static std::mutex mu;
+    std::lock_guard<std::mutex> lock(mu);
+    return &table()[name];
+}
+
+inline void reset() {
+    for (auto& [name, s] : table()) {
+        s.calls = 0; s.total_ns = 0; s.max_ns = 0;
+        s.bytes_read = 0; s.bytes_written = 0;
+        s.allocs = 0; s.alloc_bytes = 0;
+    }
+}
+
+// bytes held by the arrays in an argument or result
+template <typename X> uint64_t nbytes_of(const X&);
+template <typename... Ts> uint64_t nbytes_of(const nb::ndarray<Ts...>& a);
+template <typename X> uint64_t nbytes_of(const std::optional<X>& o);
+template <typename A, typename B> uint64_t nbytes_of(const std::pair<A, B>& p);
+template <typename... Ts> uint64_t nbytes_of(const std::tuple<Ts...>& t);
+
+template <typename X> uint64_t nbytes_of(const X&) { return 0; }
+template <typename... Ts> uint64_t nbytes_of(const nb::ndarray<Ts...>& a) { return a.nbytes(); }
+template <typename X> uint64_t nbytes_of(const std::optional<X>& o) { return o ? nbytes_of(*o) : 0; }
+template <typename A, typename B> uint64_t nbytes_of(const std::pair<A, B>& p) {
+    return nbytes_of(p.first) + nbytes_of(p.second);
+}
+template <typename... Ts> uint64_t nbytes_of(const std::tuple<Ts...>& t) {
+    return std::apply([](const auto&... x) { return (uint64_t(0) + ... + nbytes_of(x)); }, t);
+}
+
+// records one call into its slot when it leaves scope, including on throw;
+// allocations are the change in the global counters, so ops running
+// concurrently on other threads are attributed together
+class Scope {
+public:
+    Scope(OpStats& s, uint64_t read)
+        : s_(s), read_(read), allocs0_(g_allocs.load(std::memory_order_relaxed)),
+          alloc_bytes0_(g_alloc_bytes.load(std::memory_order_relaxed)),
+          t0_(std::chrono::steady_clock::now()) {}
+
+    ~Scope() {
+        if (!counted) return;
+        const uint64_t ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0_).count());
+        s_.calls.fetch_add(1, std::memory_order_relaxed);
+        s_.total_ns.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t prev = s_.max_ns.load(std::memory_order_relaxed);
+        while (prev < ns && !s_.max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+        s_.bytes_read.fetch_add(read_, std::memory_order_relaxed);
+        s_.bytes_written.fetch_add(written, std::memory_order_relaxed);
+        s_.allocs.fetch_add(g_allocs.load(std::memory_order_relaxed) - allocs0_, std::memory_order_relaxed);
+        s_.alloc_bytes.fetch_add(g_alloc_bytes.load(std::memory_order_relaxed) - alloc_bytes0_,
+                                 std::memory_order_relaxed);
+    }
+
+    uint64_t written = 0;
+    bool counted = true;
+
+private:
+    OpStats& s_;
+    uint64_t read_;
+    uint64_t allocs0_, alloc_bytes0_;
+    std::chrono::steady_clock::time_point t0_;
+};
+
+// wraps f : R(Args...) with the profiling check. Functions returning void
+// fill their array arguments in place, so those count as written.
+template <typename R, typename... Args, typename F>
+auto instrument(OpStats* s, F f, R (*)(Args...)) {
+    return [s, f](Args... args) -> R {
+        if (!enabled()) return f(std::forward<Args>(args)...);
+        const uint64_t in = (uint64_t(0) + ... + nbytes_of(args));
+        Scope scope(*s, std::is_void_v<R> ? 0 : in);
+        try {
+            if constexpr (std::is_void_v<R>) {
+                scope.written = in;
+                f(std::forward<Args>(args)...);
+            } else {
+                R r = f(std::forward<Args>(args)...);
+                scope.written = nbytes_of(r);
+                return r;
+            }
+        } catch (const nb::next_overload&) {
+            // not a call: nanobind moves on to the next overload
+            scope.counted = false;
+            throw;
+        }
+    };
+}
+
+// {op: {calls, total_s, max_s, mean_s, bytes_read, bytes_written, allocs,
+// alloc_bytes, target}} for every op called since the last reset
+inline nb::dict stats() {
+    nb::dict out;
+    const char* target = hwy::TargetName(HWY_TARGET);
+    for (const auto& [name, s] : table()) {
+        const uint64_t calls = s.calls.load(std::memory_order_relaxed);
+        if (calls == 0) continue;
+        nb::dict d;
+        d["calls"] = calls;
+        d["total_s"] = double(s.total_ns.load(std::memory_order_relaxed)) * 1e-9;
+        d["max_s"] = double(s.max_ns.load(std::memory_order_relaxed)) * 1e-9;
+        d["mean_s"] = double(s.total_ns.load(std::memory_order_relaxed)) * 1e-9 / double(calls);
+        d["bytes_read"] = s.bytes_read.load(std::memory_order_relaxed);
+        d["bytes_written"] = s.bytes_written.load(std::memory_order_relaxed);
+        d["allocs"] = s.allocs.load(std::memory_order_relaxed);
+        d["alloc_bytes"] = s.alloc_bytes.load(std::memory_order_relaxed);
+        d["target"] = target;
+        out[name.c_str()] = d;
+    }
+    return out;
+}
+
+} // profile
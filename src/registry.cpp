@@ -4,6 +4,8 @@
 namespace nb = nanobind;
 
 NB_MODULE(capnhook_ml, m) {
+  registry::register_fast(m);
   registry::register_ops<float>(m);
   registry::register_ops<double>(m);
+  registry::register_common(m);
 }
\ No newline at end of file
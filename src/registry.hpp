@@ -1,84 +1,384 @@
 #pragma once
 
 #include <nanobind/nanobind.h>
+#include <nanobind/stl/optional.h>
+#include <nanobind/stl/pair.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/tuple.h>
+#include <nanobind/stl/variant.h>
+#include <nanobind/stl/vector.h>
+#include "binding.hpp"
+#include "parallel.hpp"
+#include "fastpath.hpp"
+#include "tasks.hpp"
 #include "simd/binary.hpp"
 #include "simd/unary.hpp"
+#include "simd/ternary.hpp"
 #include "simd/reduce.hpp"
 #include "simd/linalg.hpp"
+#include "simd/cholesky.hpp"
+#include "simd/random.hpp"
+#include "ml/kmeans.hpp"
+#include "ml/neighbors.hpp"
+#include "ml/decomposition.hpp"
+#include "ml/linear_model.hpp"
+#include "ml/kernels.hpp"
+#include "stats/quantile.hpp"
+#include "stats/covariance.hpp"
+#include "stats/histogram.hpp"
+#include "stats/stream.hpp"
+#include "stats/running.hpp"
 
 namespace registry {
 
 template <typename T>
-void register_ops(nanobind::module_& m) {
+void register_ops(nanobind::module_& module) {
     using namespace capnhook;
+    binding::module m(module);
     
     // binary operations
-    m.def("add", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>, nb::ndarray<T, nb::c_contig>)>(&add),
+    m.def("add", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&add),
           "Element-wise addition");
-    m.def("sub", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>, nb::ndarray<T, nb::c_contig>)>(&sub),
+    m.def("sub", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&sub),
           "Element-wise subtraction");
-    m.def("mul", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>, nb::ndarray<T, nb::c_contig>)>(&mul),
+    m.def("mul", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&mul),
           "Element-wise multiplication");
-    m.def("div", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>, nb::ndarray<T, nb::c_contig>)>(&div),
+    m.def("div", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&div),
           "Element-wise division");
     
     // unary operations
-    m.def("exp", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>)>(&exp),
+    m.def("exp", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&exp),
           "Element-wise exponential");
-    m.def("log", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>)>(&log),
+    m.def("log", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&log),
           "Element-wise natural logarithm");
-    m.def("sqrt", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>)>(&sqrt),
+    m.def("sqrt", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&sqrt),
           "Element-wise square root");
-    m.def("sin", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>)>(&sin),
+    m.def("sin", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&sin),
           "Element-wise sine");
-    m.def("cos", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>)>(&cos),
+    m.def("cos", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&cos),
           "Element-wise cosine");
-    m.def("asin", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>)>(&asin),
+    m.def("asin", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&asin),
           "Element-wise arcsine");
-    m.def("acos", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>)>(&acos),
+    m.def("acos", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&acos),
           "Element-wise arccosine");
     
+    // ternary and selection operations; any operand but where's mask may be a scalar
+    m.def("fma", &capnhook::fma<T>, nb::arg("a"), nb::arg("b"), nb::arg("c"),
+          "Fused multiply-add a * b + c with a single rounding");
+    m.def("clip", &clip<T>, nb::arg("x"), nb::arg("lo"), nb::arg("hi"),
+          "Limit values to [lo, hi]");
+    m.def("where", &where<T>, nb::arg("mask"), nb::arg("a"), nb::arg("b"),
+          "a where the boolean mask is set, else b");
+    m.def("lerp", &lerp<T>, nb::arg("a"), nb::arg("b"), nb::arg("t"),
+          "Linear interpolation a + t * (b - a)");
+    m.def("maximum", &maximum<T>, nb::arg("a"), nb::arg("b"),
+          "Element-wise maximum, propagating NaN");
+    m.def("minimum", &minimum<T>, nb::arg("a"), nb::arg("b"),
+          "Element-wise minimum, propagating NaN");
+
     // reduction operations 
-    m.def("reduce_sum", static_cast<T (*)(nb::ndarray<T, nb::c_contig>)>(&reduce_sum),
+    m.def("reduce_sum", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&reduce_sum),
           "Sum reduction");
-    m.def("reduce_prod", static_cast<T (*)(nb::ndarray<T, nb::c_contig>)>(&reduce_prod),
+    m.def("reduce_prod", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&reduce_prod),
           "Product reduction");
-    m.def("reduce_min", static_cast<T (*)(nb::ndarray<T, nb::c_contig>)>(&reduce_min),
+    m.def("reduce_min", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&reduce_min),
           "Minimum value");
-    m.def("reduce_max", static_cast<T (*)(nb::ndarray<T, nb::c_contig>)>(&reduce_max),
+    m.def("reduce_max", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&reduce_max),
           "Maximum value");
-    m.def("reduce_mean", static_cast<T (*)(nb::ndarray<T, nb::c_contig>)>(&reduce_mean),
+    m.def("reduce_mean", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&reduce_mean),
           "Mean value");
-    m.def("reduce_var", static_cast<T (*)(nb::ndarray<T, nb::c_contig>)>(&reduce_var),
+    m.def("reduce_var", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&reduce_var),
           "Variance");
-    m.def("reduce_std", static_cast<T (*)(nb::ndarray<T, nb::c_contig>)>(&reduce_std),
+    m.def("reduce_std", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&reduce_std),
           "Standard deviation");
-    m.def("reduce_any", static_cast<bool (*)(nb::ndarray<T, nb::c_contig>)>(&reduce_any),
+    m.def("reduce_any", static_cast<bool (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&reduce_any),
           "Returns true if any element is non-zero");
-    m.def("reduce_all", static_cast<bool (*)(nb::ndarray<T, nb::c_contig>)>(&reduce_all),
+    m.def("reduce_all", static_cast<bool (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&reduce_all),
           "Returns true if all elements are non-zero");
     
     // index operations
-    m.def("argmax", static_cast<size_t (*)(nb::ndarray<T, nb::c_contig>)>(&argmax),
+    m.def("argmax", static_cast<size_t (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&argmax),
           "Index of maximum value");
-    m.def("argmin", static_cast<size_t (*)(nb::ndarray<T, nb::c_contig>)>(&argmin),
+    m.def("argmin", static_cast<size_t (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&argmin),
           "Index of minimum value");
     
     // cumulative operations
-    m.def("cumsum", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>)>(&cumsum),
+    m.def("cumsum", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&cumsum),
           "Cumulative sum");
-    m.def("cumprod", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig>)>(&cumprod),
+    m.def("cumprod", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&cumprod),
           "Cumulative product");
     
     // linear algebra operations
-    m.def("matmul", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(nb::ndarray<T, nb::c_contig, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::ndim<2>>)>(&matmul),
-          "Matrix multiplication using BLAS");
-    m.def("trace", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::ndim<2>>)>(&trace),
+    m.def("matmul", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(nb::ndarray<T, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::device::cpu, nb::ndim<2>>)>(&matmul),
+          "Matrix multiplication using BLAS; transposed and F-ordered operands are used in place");
+    m.def("transpose", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(nb::ndarray<T, nb::device::cpu, nb::ndim<2>>)>(&capnhook::transpose),
+          "C-ordered copy of the transpose of a 2-D array (cache-blocked)");
+    m.def("gemv", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>>)>(&matvec),
+          nb::arg("A"), nb::arg("x"),
+          "Matrix-vector product A @ x using BLAS gemv; transposed and F-ordered A are used in place");
+    m.def("outer", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&outer),
+          nb::arg("a"), nb::arg("b"),
+          "Outer product of the flattened a and b");
+    m.def("row_dot", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>)>(&row_dot),
+          nb::arg("A"), nb::arg("B"),
+          "Dot product of each row of A with the same row of B");
+    m.def("row_norm", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>)>(&row_norm),
+          nb::arg("A"),
+          "Euclidean norm of each row of A");
+    m.def("trace", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>)>(&trace),
           "Matrix trace (sum of diagonal elements)");
-    m.def("norm", static_cast<T (*)(nb::ndarray<T, nb::c_contig>)>(&norm),
-          "Vector norm (Euclidean/L2)");
-    m.def("dot", static_cast<T (*)(nb::ndarray<T, nb::c_contig>, nb::ndarray<T, nb::c_contig>)>(&dot),
+    m.def("norm", static_cast<nb::object (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, nb::handle, std::optional<int>)>(&norm),
+          nb::arg("x"), nb::arg("ord") = 2, nb::arg("axis") = nb::none(),
+          "Vector norm for ord 1, 2 or inf, of the whole array or along an axis; the L2 norm is overflow-safe");
+    m.def("dot", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&dot),
           "Dot product of two vectors");
+    m.def("cholesky", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(nb::ndarray<T, nb::device::cpu, nb::ndim<2>>, bool)>(&cholesky),
+          nb::arg("A"), nb::arg("lower") = true,
+          "Cholesky factor of a symmetric positive definite A: L with A = L @ L.T, or U with A = U.T @ U when "
+          "lower is False; only the upper triangle of A is read. Blocked on BLAS trsm/syrk");
+    m.def("solve_triangular", static_cast<nb::ndarray<nb::numpy, T> (*)(nb::ndarray<T, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::device::cpu>, bool, bool)>(&solve_triangular),
+          nb::arg("A"), nb::arg("b"), nb::arg("lower") = true, nb::arg("trans") = false,
+          "Solve A @ x = b (A.T @ x = b with trans) for a triangular A and b of shape (n,) or (n, k)");
+    m.def("cho_solve", static_cast<nb::ndarray<nb::numpy, T> (*)(nb::ndarray<T, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::device::cpu>, bool)>(&cho_solve),
+          nb::arg("F"), nb::arg("b"), nb::arg("lower") = true,
+          "Solve A @ x = b given the Cholesky factor F of A from ch.cholesky (same lower flag)");
+    m.def("logdet", static_cast<T (*)(nb::ndarray<T, nb::device::cpu, nb::ndim<2>>)>(&logdet),
+          nb::arg("A"),
+          "Log-determinant of a symmetric positive definite A via its Cholesky factor");
+
+    // clustering
+    m.def("kmeans", static_cast<std::tuple<nb::ndarray<nb::numpy, T, nb::ndim<2>>, nb::ndarray<nb::numpy, int64_t, nb::ndim<1>>, T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, size_t, size_t, const std::string&, size_t, T, uint64_t)>(&kmeans),
+          nb::arg("X"), nb::arg("k"), nb::arg("iters") = 100, nb::arg("init") = "k-means++",
+          nb::arg("batch_size") = 0, nb::arg("tol") = T(1e-4), nb::arg("seed") = 0,
+          "K-means clustering, returns (centroids, labels, inertia); batch_size > 0 selects mini-batch mode");
+
+    // neighbours
+    m.def("cdist", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, const std::string&)>(&cdist),
+          nb::arg("X"), nb::arg("Y"), nb::arg("metric") = "euclidean",
+          "Pairwise distances between rows of X and Y (sqeuclidean, euclidean or cosine)");
+    m.def("knn", static_cast<std::tuple<nb::ndarray<nb::numpy, T, nb::ndim<2>>, nb::ndarray<nb::numpy, int64_t, nb::ndim<2>>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, size_t, const std::string&)>(&knn),
+          nb::arg("X"), nb::arg("Y"), nb::arg("k"), nb::arg("metric") = "euclidean",
+          "k nearest rows of Y for each row of X, returns (distances, indices)");
+
+    // decomposition
+    m.def("randomized_svd", static_cast<SvdResult<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, size_t, size_t, size_t, uint64_t)>(&randomized_svd),
+          nb::arg("X"), nb::arg("k"), nb::arg("n_iter") = 4, nb::arg("oversample") = 10, nb::arg("seed") = 0,
+          "Truncated randomized SVD, returns (U, S, Vt)");
+    m.def("pca", static_cast<std::tuple<nb::ndarray<nb::numpy, T, nb::ndim<2>>, nb::ndarray<nb::numpy, T, nb::ndim<2>>, nb::ndarray<nb::numpy, T, nb::ndim<1>>, nb::ndarray<nb::numpy, T, nb::ndim<1>>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, size_t, size_t, uint64_t)>(&pca),
+          nb::arg("X"), nb::arg("n_components"), nb::arg("n_iter") = 4, nb::arg("seed") = 0,
+          "Principal component analysis, returns (scores, components, explained_variance, mean)");
+
+    // linear models; 3-D X / 2-D y fit one model per leading index across threads
+    m.def("ridge", static_cast<LinearFit<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>>, T, bool)>(&ridge),
+          nb::arg("X"), nb::arg("y"), nb::arg("alpha") = T(1), nb::arg("fit_intercept") = true,
+          "Ridge (L2) regression, returns (coef, intercept)");
+    m.def("ridge", static_cast<LinearFitBatch<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<3>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, T, bool)>(&ridge),
+          nb::arg("X"), nb::arg("y"), nb::arg("alpha") = T(1), nb::arg("fit_intercept") = true,
+          "Batched ridge regression, returns (coefs, intercepts)");
+    m.def("lasso", static_cast<LinearFit<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>>, T, size_t, T, bool)>(&lasso),
+          nb::arg("X"), nb::arg("y"), nb::arg("alpha") = T(1), nb::arg("max_iter") = 1000, nb::arg("tol") = T(1e-4), nb::arg("fit_intercept") = true,
+          "Lasso (L1) regression by coordinate descent, returns (coef, intercept)");
+    m.def("lasso", static_cast<LinearFitBatch<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<3>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, T, size_t, T, bool)>(&lasso),
+          nb::arg("X"), nb::arg("y"), nb::arg("alpha") = T(1), nb::arg("max_iter") = 1000, nb::arg("tol") = T(1e-4), nb::arg("fit_intercept") = true,
+          "Batched lasso regression, returns (coefs, intercepts)");
+    m.def("logistic_regression", static_cast<LinearFit<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>>, T, size_t, T, bool)>(&logistic_regression),
+          nb::arg("X"), nb::arg("y"), nb::arg("alpha") = T(1), nb::arg("max_iter") = 100, nb::arg("tol") = T(1e-5), nb::arg("fit_intercept") = true,
+          "L2-regularised logistic regression by L-BFGS, returns (coef, intercept)");
+    m.def("logistic_regression", static_cast<LinearFitBatch<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<3>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, T, size_t, T, bool)>(&logistic_regression),
+          nb::arg("X"), nb::arg("y"), nb::arg("alpha") = T(1), nb::arg("max_iter") = 100, nb::arg("tol") = T(1e-5), nb::arg("fit_intercept") = true,
+          "Batched logistic regression, returns (coefs, intercepts)");
+
+    // kernels
+    m.def("kernel_matrix", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, std::optional<nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>>, const std::string&, T, int, T, T, T)>(&kernel_matrix),
+          nb::arg("X"), nb::arg("Y") = nb::none(), nb::arg("kind") = "rbf", nb::arg("gamma") = T(0),
+          nb::arg("degree") = 3, nb::arg("coef0") = T(1), nb::arg("period") = T(1), nb::arg("length_scale") = T(1),
+          "Gram matrix of a linear, rbf, polynomial, quadratic or periodic kernel; symmetric when Y is omitted or is X");
+
+    // order statistics
+    m.def("median", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&median),
+          nb::arg("x"), "Median of all elements");
+    m.def("median", static_cast<nb::ndarray<nb::numpy, T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, int)>(&median),
+          nb::arg("x"), nb::arg("axis"), "Median along an axis");
+    m.def("quantile", static_cast<nb::ndarray<nb::numpy, T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, const std::vector<double>&, std::optional<int>, const std::string&)>(&quantile),
+          nb::arg("x"), nb::arg("qs"), nb::arg("axis") = nb::none(), nb::arg("method") = "exact",
+          "Quantiles qs in [0, 1] from one selection pass, shape (len(qs), ...); method 'approx' uses histograms for large inputs");
+    m.def("quantile", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, double, const std::string&)>(&quantile),
+          nb::arg("x"), nb::arg("q"), nb::arg("method") = "exact",
+          "Single quantile q in [0, 1] of all elements");
+    m.def("percentile", static_cast<nb::ndarray<nb::numpy, T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, const std::vector<double>&, std::optional<int>, const std::string&)>(&percentile),
+          nb::arg("x"), nb::arg("ps"), nb::arg("axis") = nb::none(), nb::arg("method") = "exact",
+          "Percentiles ps in [0, 100] from one selection pass, shape (len(ps), ...)");
+    m.def("percentile", static_cast<T (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, double, const std::string&)>(&percentile),
+          nb::arg("x"), nb::arg("p"), nb::arg("method") = "exact",
+          "Single percentile p in [0, 100] of all elements");
+
+    // covariance
+    m.def("cov", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, bool, size_t)>(&cov),
+          nb::arg("X"), nb::arg("rowvar") = true, nb::arg("ddof") = 1,
+          "Covariance matrix via syrk on centred chunks; rows are variables when rowvar");
+    m.def("corrcoef", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, bool)>(&corrcoef),
+          nb::arg("X"), nb::arg("rowvar") = true,
+          "Pearson correlation matrix");
+    m.def("cov_accumulate", static_cast<CovState<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>, std::optional<CovStateIn<T>>)>(&cov_accumulate),
+          nb::arg("X"), nb::arg("state") = nb::none(),
+          "Fold a chunk of observations (rows) into a (count, mean, comoment) state");
+    m.def("cov_finalize", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<2>> (*)(CovStateIn<T>, size_t)>(&cov_finalize),
+          nb::arg("state"), nb::arg("ddof") = 1,
+          "Covariance matrix from an accumulated state");
+
+    // histograms
+    m.def("histogram", static_cast<Histogram<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, size_t, std::optional<std::pair<double, double>>)>(&histogram),
+          nb::arg("x"), nb::arg("bins") = 10, nb::arg("range") = nb::none(),
+          "Equal-width histogram, returns (counts, edges)");
+    m.def("histogram", static_cast<Histogram<T> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>>)>(&histogram),
+          nb::arg("x"), nb::arg("bins"),
+          "Histogram over explicit bin edges, returns (counts, edges)");
+    m.def("bincount", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<int64_t, nb::c_contig, nb::device::cpu, nb::ndim<1>>, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>>, size_t)>(&bincount),
+          nb::arg("x"), nb::arg("weights"), nb::arg("minlength") = 0,
+          "Sum of weights for each value of a non-negative int64 array");
+    m.def("mode", static_cast<std::tuple<T, int64_t> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>)>(&mode),
+          nb::arg("x"), "Most frequent value and its count; ties go to the smallest value");
+
+    // random numbers; counter-based, so a (seed, offset) pair always gives
+    // the same values whatever the thread count
+    auto rnd = m.def_submodule("random", "Counter-based (Threefry-2x32) random number generation");
+    rnd.def("uniform", static_cast<void (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, T, T, uint64_t, uint64_t)>(&random_uniform),
+            nb::arg("out"), nb::arg("low") = T(0), nb::arg("high") = T(1), nb::arg("seed") = 0, nb::arg("offset") = 0,
+            "Fill out in place with uniform samples in [low, high)");
+    rnd.def("normal", static_cast<void (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, T, T, uint64_t, uint64_t)>(&random_normal),
+            nb::arg("out"), nb::arg("mean") = T(0), nb::arg("std") = T(1), nb::arg("seed") = 0, nb::arg("offset") = 0,
+            "Fill out in place with normal samples (Box-Muller)");
+    rnd.def("bernoulli", static_cast<void (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu>, T, uint64_t, uint64_t)>(&random_bernoulli),
+            nb::arg("out"), nb::arg("p") = T(0.5), nb::arg("seed") = 0, nb::arg("offset") = 0,
+            "Fill out in place with 1 with probability p, else 0");
+    m.def("dropout", static_cast<nb::ndarray<nb::numpy, T, nb::ndim<1>> (*)(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>>, T, uint64_t, uint64_t)>(&dropout),
+          nb::arg("x"), nb::arg("p") = T(0.5), nb::arg("seed") = 0, nb::arg("offset") = 0,
+          "Inverted dropout: zero each element with probability p and scale the rest by 1 / (1 - p)");
+}
+
+// dtype-dispatching fast paths; registered before register_ops so they
+// are tried ahead of the typed overloads
+inline void register_fast(nanobind::module_& module) {
+    using fastpath::Array;
+    using fastpath::Kind;
+    binding::module m(module);
+
+    for (const auto& [name, op] : fastpath::table()) {
+        const fastpath::FastOp* p = &op;
+        switch (op.kind) {
+        case Kind::Binary:
+            m.def(name.c_str(), [p](Array a, Array b) { return fastpath::binary(*p, a, b); }, nb::arg("a"), nb::arg("b"));
+            break;
+        case Kind::Unary:
+        case Kind::Scan:
+            m.def(name.c_str(), [p](Array a) { return fastpath::unary(*p, a); }, nb::arg("a"));
+            break;
+        case Kind::Reduce:
+            m.def(name.c_str(), [p](Array a) { return fastpath::reduce(*p, a); }, nb::arg("a"));
+            break;
+        case Kind::Predicate:
+            m.def(name.c_str(), [p](Array a) { return fastpath::predicate(*p, a); }, nb::arg("a"));
+            break;
+        case Kind::Index:
+            m.def(name.c_str(), [p](Array a) { return fastpath::index(*p, a); }, nb::arg("a"));
+            break;
+        case Kind::Dot:
+            m.def(name.c_str(), [p](Array a, Array b) { return fastpath::dot(*p, a, b); }, nb::arg("a"), nb::arg("b"));
+            break;
+        }
+    }
+
+    m.def("batch", [module](nb::iterable calls) { return fastpath::batch(module, calls); },
+          nb::arg("calls"),
+          "Run [(op, args), ...] in one call and return the list of results; op is a name or any callable");
+
+    // asynchronous submission, registered unwrapped since the call only
+    // queues work; the executor is drained before the interpreter exits
+    module.def("submit", [module](nb::object op, nb::args args, nb::kwargs kwargs) {
+        return tasks::submit(module, op, args, kwargs);
+    }, "Queue op(*args, **kwargs) on the background executor and return a concurrent.futures.Future; "
+       "fast-path kernels run with the GIL released and the inputs are kept alive until it resolves");
+    module.def("asubmit", [module](nb::object op, nb::args args, nb::kwargs kwargs) {
+        return nb::module_::import_("asyncio").attr("wrap_future")(tasks::submit(module, op, args, kwargs));
+    }, "submit() wrapped as an asyncio future to await from the running event loop");
+    nb::module_::import_("atexit").attr("register")(
+        nb::cpp_function(&tasks::stop, nb::call_guard<nb::gil_scoped_release>()));
+}
+
+// operations whose signatures do not depend on the float type; registered
+// once rather than per dtype
+inline void register_common(nanobind::module_& module) {
+    using namespace capnhook;
+    binding::module m(module);
+
+    m.def("bincount", static_cast<nb::ndarray<nb::numpy, int64_t, nb::ndim<1>> (*)(nb::ndarray<int64_t, nb::c_contig, nb::device::cpu, nb::ndim<1>>, size_t)>(&bincount),
+          nb::arg("x"), nb::arg("minlength") = 0,
+          "Occurrences of each value of a non-negative int64 array");
+
+    // out-of-core reductions
+    auto stream = m.def_submodule("stream", "Chunked reductions over files and memory-mapped arrays");
+    stream.def("reduce", &stream_reduce,
+               nb::arg("source"), nb::arg("ops") = std::vector<std::string>{ "sum", "mean", "min", "max" },
+               nb::arg("dtype") = nb::none(), nb::arg("chunk_bytes") = kStreamChunkBytes, nb::arg("offset") = 0,
+               "Reduce a float32/float64 file, np.memmap or array in parallel chunks with read-ahead, returning {op: value} "
+               "for ops among sum, mean, var, std, min, max, argmin, argmax and count");
+
+    // online accumulators
+    nb::class_<RunningStats>(module, "RunningStats",
+                             "Per-feature running count, mean, variance, min, max and sum over batches")
+        .def(nb::init<size_t>(), nb::arg("dim"))
+        .def("update", &RunningStats::update<float>, nb::arg("batch"),
+             "Fold in a (N, dim) batch or a single (dim,) sample")
+        .def("update", &RunningStats::update<double>, nb::arg("batch"))
+        .def("merge", &RunningStats::merge, nb::arg("other"),
+             "Combine another accumulator into this one (Chan's parallel update)")
+        .def("result", &RunningStats::result, nb::arg("ddof") = 0,
+             "Dict of count, mean, var, std, min, max and sum; var divides by count - ddof")
+        .def_prop_ro("dim", &RunningStats::dim)
+        .def_prop_ro("count", &RunningStats::count)
+        .def("state", &RunningStats::state, "Checkpoint state (dim, count, mean, m2, min, max)")
+        .def_static("from_state", &RunningStats::from_state, nb::arg("state"),
+                    "Rebuild an accumulator from state()")
+        .def("__getstate__", &RunningStats::state)
+        .def("__setstate__", [](RunningStats& r, const RunningStats::State& s) {
+            new (&r) RunningStats(RunningStats::from_state(s));
+        });
+
+    // output framework, registered unwrapped like the profiling controls
+    module.def("set_framework", &interop::set_framework, nb::arg("name"),
+               "Framework for returned arrays: auto (default; the framework of the call's first array "
+               "argument, numpy if none), numpy, torch, jax, tensorflow or dlpack to force one; "
+               "results share the output buffer without copying. Returns the previous setting");
+    module.def("get_framework", [] { return std::string(interop::framework_name(interop::framework())); },
+               "Framework setting for returned arrays (auto unless overridden)");
+
+    // accuracy tier of the exp, log, sin and cos kernels
+    module.def("set_precision", &precision::set_mode, nb::arg("mode"),
+               "Kernels used by exp, log, sin, cos and the fused activations: accurate (default; also "
+               "CAPNHOOK_PRECISION), fast (within 4 ulp) or fastest (about 1e-4 relative in float32); "
+               "returns the previous mode");
+    module.def("get_precision", [] { return std::string(precision::mode_name(precision::mode())); },
+               "Current precision mode");
+
+    // threading runtime shared by the kernels and BLAS
+    module.def("set_num_threads", &runtime::set_num_threads, nb::arg("n"),
+               nb::call_guard<nb::gil_scoped_release>(),
+               "Threads used by parallel kernels and BLAS (0 restores the default: CAPNHOOK_NUM_THREADS "
+               "or every core); waits for running work and returns the previous count");
+    module.def("get_num_threads", &runtime::num_threads, "Threads used by parallel kernels and BLAS");
+    module.def("set_thread_pinning", &runtime::set_pinning, nb::arg("enabled"),
+               nb::call_guard<nb::gil_scoped_release>(),
+               "Pin pool worker i to core i (Linux only; also CAPNHOOK_PIN_THREADS=1); returns the previous setting");
+
+    // profiling controls, registered unwrapped so they do not profile themselves
+    module.def("profile", [](std::optional<bool> enabled) {
+        if (enabled) profile::set_enabled(*enabled);
+        return profile::enabled();
+    }, nb::arg("enabled") = nb::none(),
+       "Turn per-op profiling on or off (also set by CAPNHOOK_PROFILE=1); returns whether it is on");
+    module.def("profile_stats", &profile::stats,
+               "Per-op calls, total/max/mean seconds, bytes read/written, allocations and SIMD target since the last reset");
+    module.def("profile_reset", &profile::reset, "Zero all profiling counters");
 }
 
 } // registry
\ No newline at end of file
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <hwy/highway.h>
+#include <hwy/contrib/math/math-inl.h>
+
+// Precision tiers for the transcendental kernels (exp, log, sin, cos).
+// Accurate is Highway's contrib/math. Fast and Fastest reduce the argument
+// the same way but evaluate shorter minimax polynomials and skip the
+// special-case handling, which moves to a rarely taken branch: lanes that
+// are out of the fast range (overflow, underflow, zero, negative or
+// subnormal log arguments, |x| too large to reduce, inf, NaN) are
+// recomputed with the accurate kernel, so every tier returns the same
+// special values. Bounds measured against long double std:: (sin and cos
+// over |x| <= 8000):
+//
+//                 float32                      float64
+//   accurate  Highway's contrib/math       Highway's contrib/math
+//   fast      exp <= 4 ulp, log <= 6 ulp   exp, log <= 4 ulp
+//             sin, cos <= 2e-7 abs         sin, cos <= 3e-16 abs
+//   fastest   exp <= 1e-4 rel              exp, log <= 2e-7 rel
+//             log <= 5e-5 rel
+//             sin, cos <= 2e-5 abs         sin, cos <= 5e-8 abs
+//
+// sin and cos are bounded in absolute error: near their roots every
+// kernel's relative error is set by the argument reduction. asin and acos
+// have no reduced tiers and stay accurate in every mode.
+namespace precision {
+
+enum class Mode { Accurate, Fast, Fastest };
+
+// CAPNHOOK_PRECISION, or accurate when unset or unknown
+inline Mode env_mode() {
+    const char* v = std::getenv("CAPNHOOK_PRECISION");
+    const std::string name = v ? v : "";
+    if (name == "fast") return Mode::Fast;
+    if (name == "fastest") return Mode::Fastest;
+    return Mode::Accurate;
+}
+
+inline std::atomic<Mode> g_mode{ env_mode() };
+
+inline Mode mode() { return g_mode.load(std::memory_order_relaxed); }
+
+inline const char* mode_name(Mode m) {
+    switch (m) {
+    case Mode::Accurate: return "accurate";
+    case Mode::Fast: return "fast";
+    case Mode::Fastest: return "fastest";
+    }
+    return "accurate";
+}
+
+// selects the mode by name and returns the previous one
+inline std::string set_mode(const std::string& name) {
+    Mode m;
+    if (name == "accurate") m = Mode::Accurate;
+    else if (name == "fast") m = Mode::Fast;
+    else if (name == "fastest") m = Mode::Fastest;
+    else throw std::runtime_error("set_precision: unknown mode '" + name + "' (accurate, fast or fastest)");
+    return mode_name(g_mode.exchange(m, std::memory_order_relaxed));
+}
+
+// calls f(std::integral_constant<Mode, m>) for the run-time mode m, so a
+// loop is compiled once per tier and the mode is read once per call
+template <class F>
+decltype(auto) dispatch(Mode m, F&& f) {
+    switch (m) {
+    case Mode::Fast: return f(std::integral_constant<Mode, Mode::Fast>());
+    case Mode::Fastest: return f(std::integral_constant<Mode, Mode::Fastest>());
+    case Mode::Accurate: break;
+    }
+    return f(std::integral_constant<Mode, Mode::Accurate>());
+}
+
+} // precision
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+using precision::Mode;
+
+// Minimax coefficients, lowest order first. exp: e^r for |r| <= ln2 / 2.
+// log: atanh(s) / s as a polynomial in z = s^2 for s = (m - 1) / (m + 1),
+// m in [sqrt(1/2), sqrt(2)). sin: sin(r) / r and cos: cos(r), both in
+// z = r^2 for |r| <= pi / 4. The float fast and double fastest tiers share
+// one set per function.
+inline constexpr double kExp3[] = { 0.99992807323739519, 1.0001641839179813, 0.50496326863524554,
+                                    0.16566844068027653 };
+inline constexpr double kExp5[] = { 1.0000000716530213, 0.99999969199456074, 0.49998894853003267,
+                                    0.16667574684300576, 0.041915382117989154, 0.008297658723799067 };
+inline constexpr double kExp10[] = { 1.0, 1.0000000000000064, 0.49999999999997291, 0.16666666666557753,
+                                     0.041666666668424293, 0.0083333333846618736, 0.0013888888499571463,
+                                     0.00019841171388766825, 2.4801917248222667e-05, 2.7639766530702089e-06,
+                                     2.7488597573880046e-07 };
+inline constexpr double kLog1[] = { 0.99997774468200762, 0.33933992879498032 };
+inline constexpr double kLog2[] = { 1.0000001186857037, 0.33326111859141344, 0.2064818642785427 };
+inline constexpr double kLog7[] = { 1.0, 0.33333333333333826, 0.19999999999649445, 0.14285714380672493,
+                                    0.11111098494201758, 0.090918175433088985, 0.076562219728252182,
+                                    0.074052639866685657 };
+inline constexpr double kSin2[] = { 1.0, -0.16663390379854617, 0.0081632819560729149 };
+inline constexpr double kSin3[] = { 1.0, -0.16666654609553619, 0.008332160762196731, -0.00019515283230293385 };
+inline constexpr double kSin6[] = { 1.0, -0.16666666666666644, 0.0083333333333236725, -0.00019841269830153272,
+                                    2.7557313655187267e-06, -2.505073511868829e-08, 1.5894743283863398e-10 };
+inline constexpr double kCos2[] = { 1.0, -0.49977630659279948, 0.040488934957784335 };
+inline constexpr double kCos3[] = { 1.0, -0.49999894781389903, 0.041656294578711867, -0.0013597823110025593 };
+inline constexpr double kCos7[] = { 1.0, -0.5, 0.041666666666666491, -0.0013888888888863914,
+                                    2.4801587285010968e-05, -2.7557313339519519e-07, 2.0875608663713743e-09,
+                                    -1.1354521163953256e-11 };
+
+// c[0] + c[1] x + ... by Horner's rule
+template <class D, class V, size_t K>
+HWY_INLINE V horner(D d, V x, const double (&c)[K]) {
+    using T = TFromD<D>;
+    auto r = Set(d, T(c[K - 1]));
+    for (size_t k = K - 1; k-- > 0;) r = MulAdd(r, x, Set(d, T(c[k])));
+    return r;
+}
+
+// the polynomial for a tier: float fastest, float fast = double fastest,
+// double fast
+template <Mode P, class D, class V, size_t K1, size_t K2, size_t K3>
+HWY_INLINE V tier_poly(D d, V x, const double (&low)[K1], const double (&mid)[K2], const double (&high)[K3]) {
+    constexpr bool f32 = sizeof(TFromD<D>) == 4;
+    if constexpr (f32 && P == Mode::Fastest) return horner(d, x, low);
+    else if constexpr (f32 || P == Mode::Fastest) return horner(d, x, mid);
+    else return horner(d, x, high);
+}
+
+template <Mode P, class D, class V>
+HWY_INLINE V exp_p(D d, V x) {
+    if constexpr (P == Mode::Accurate) {
+        return hwy::HWY_NAMESPACE::Exp(d, x);
+    } else {
+        using T = TFromD<D>;
+        const RebindToSigned<D> di;
+        constexpr bool f32 = sizeof(T) == 4;
+        // beyond these 2^n leaves the normal range
+        const auto ok = And(Ge(x, Set(d, f32 ? T(-87) : T(-708))), Le(x, Set(d, f32 ? T(88) : T(709))));
+        const auto xs = IfThenElseZero(ok, x);
+        // x = n ln2 + r with ln2 split so n * ln2_hi is exact
+        const auto n = Round(Mul(xs, Set(d, T(1.4426950408889634))));
+        auto r = NegMulAdd(n, Set(d, f32 ? T(0.693359375f) : T(6.93147180369123816490e-01)), xs);
+        r = NegMulAdd(n, Set(d, f32 ? T(-2.12194440e-4f) : T(1.90821492927058770002e-10)), r);
+        const auto p = tier_poly<P>(d, r, kExp3, kExp5, kExp10);
+        // 2^n assembled in the exponent field
+        const auto ni = Add(ConvertTo(di, n), Set(di, f32 ? 127 : 1023));
+        const auto scale = BitCast(d, ShiftLeft<f32 ? 23 : 52>(ni));
+        const auto y = Mul(p, scale);
+        if (HWY_LIKELY(AllTrue(d, ok))) return y;
+        return IfThenElse(ok, y, hwy::HWY_NAMESPACE::Exp(d, x));
+    }
+}
+
+template <Mode P, class D, class V>
+HWY_INLINE V log_p(D d, V x) {
+    if constexpr (P == Mode::Accurate) {
+        return hwy::HWY_NAMESPACE::Log(d, x);
+    } else {
+        using T = TFromD<D>;
+        using TI = std::conditional_t<sizeof(T) == 4, int32_t, int64_t>;
+        const RebindToSigned<D> di;
+        constexpr bool f32 = sizeof(T) == 4;
+        // positive, normal and finite
+        const auto ok = And(Ge(x, Set(d, std::numeric_limits<T>::min())),
+                            Le(x, Set(d, std::numeric_limits<T>::max())));
+        const auto xs = IfThenElse(ok, x, Set(d, T(1)));
+        // x = 2^e m with m in [sqrt(1/2), sqrt(2)): offsetting the bits by
+        // those of sqrt(1/2) puts the exponent boundary there
+        const TI off = f32 ? TI(0x3f3504f3) : TI(0x3fe6a09e667f3bcdLL);
+        const TI exp_mask = f32 ? TI(int32_t(0xff800000u)) : TI(int64_t(0xfff0000000000000ull));
+        const auto bits = BitCast(di, xs);
+        const auto t = Sub(bits, Set(di, off));
+        const auto e = ConvertTo(d, ShiftRight<f32 ? 23 : 52>(t));
+        const auto m = BitCast(d, Sub(bits, And(t, Set(di, exp_mask))));
+        // log m = 2 atanh(s)
+        const auto one = Set(d, T(1));
+        const auto s = Div(Sub(m, one), Add(m, one));
+        const auto lm = Mul(Add(s, s), tier_poly<P>(d, Mul(s, s), kLog1, kLog2, kLog7));
+        const auto y = MulAdd(e, Set(d, f32 ? T(0.693359375f) : T(6.93147180369123816490e-01)),
+                              MulAdd(e, Set(d, f32 ? T(-2.12194440e-4f) : T(1.90821492927058770002e-10)), lm));
+        if (HWY_LIKELY(AllTrue(d, ok))) return y;
+        return IfThenElse(ok, y, hwy::HWY_NAMESPACE::Log(d, x));
+    }
+}
+
+// sin (kCos false) or cos of x: x = n pi/2 + r, then sin r or cos r by
+// the quadrant n mod 4 (cos(x) = sin(x + pi/2) adds one to it)
+template <Mode P, bool kCos, class D, class V>
+HWY_INLINE V sincos_p(D d, V x) {
+    if constexpr (P == Mode::Accurate) {
+        if constexpr (kCos) return hwy::HWY_NAMESPACE::Cos(d, x);
+        else return hwy::HWY_NAMESPACE::Sin(d, x);
+    } else {
+        using T = TFromD<D>;
+        const RebindToSigned<D> di;
+        constexpr bool f32 = sizeof(T) == 4;
+        // the three-part pi/2 keeps n * part exact up to this |x|
+        const auto ok = Le(Abs(x), Set(d, f32 ? T(8192) : T(524288)));
+        const auto xs = IfThenElseZero(ok, x);
+        const auto n = Round(Mul(xs, Set(d, T(0.63661977236758134308))));
+        auto r = NegMulAdd(n, Set(d, f32 ? T(1.5703125f) : T(1.57079632673412561417e+00)), xs);
+        r = NegMulAdd(n, Set(d, f32 ? T(4.837512969970703125e-4f) : T(6.07710050630396597660e-11)), r);
+        r = NegMulAdd(n, Set(d, f32 ? T(7.54978995489188216e-8f) : T(2.02226624879595063154e-21)), r);
+        const auto z = Mul(r, r);
+        const auto sin_r = Mul(r, tier_poly<P>(d, z, kSin2, kSin3, kSin6));
+        const auto cos_r = tier_poly<P>(d, z, kCos2, kCos3, kCos7);
+        auto q = ConvertTo(di, n);
+        if constexpr (kCos) q = Add(q, Set(di, 1));
+        const auto swap = RebindMask(d, Ne(And(q, Set(di, 1)), Zero(di)));
+        const auto neg = RebindMask(d, Ne(And(q, Set(di, 2)), Zero(di)));
+        auto y = IfThenElse(swap, cos_r, sin_r);
+        y = IfThenElse(neg, Neg(y), y);
+        if (HWY_LIKELY(AllTrue(d, ok))) return y;
+        if constexpr (kCos) return IfThenElse(ok, y, hwy::HWY_NAMESPACE::Cos(d, x));
+        else return IfThenElse(ok, y, hwy::HWY_NAMESPACE::Sin(d, x));
+    }
+}
+
+template <Mode P, class D, class V>
+HWY_INLINE V sin_p(D d, V x) { return sincos_p<P, false>(d, x); }
+
+template <Mode P, class D, class V>
+HWY_INLINE V cos_p(D d, V x) { return sincos_p<P, true>(d, x); }
+
+// log(1 + x); the reduced tiers take log of the rounded sum, which is
+// within one rounding of 1 absolute
+template <Mode P, class D, class V>
+HWY_INLINE V log1p_p(D d, V x) {
+    if constexpr (P == Mode::Accurate) return hwy::HWY_NAMESPACE::Log1p(d, x);
+    else return log_p<P>(d, Add(Set(d, TFromD<D>(1)), x));
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
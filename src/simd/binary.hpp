@@ -8,6 +8,7 @@
 #include <hwy/highway.h>
 
 #include "../alloc.hpp"
+#include "driver.hpp"
 
 namespace nb = nanobind;
 
@@ -16,9 +17,16 @@ namespace hwy {
 namespace HWY_NAMESPACE {
 namespace capnhook {
 
+// C[i] = op(A[i], B[i]) on raw buffers; A and B may have any alignment
+template <typename T, typename Op, Stores S = Stores::Auto>
+void binary_n(const T* A, const T* B, T* C, size_t N) {
+    Op op;
+    elementwise_n<T, S>(C, N, [&](auto, auto a, auto b) { return op(a, b); }, A, B);
+}
+
 template <typename T, typename Op>
-nb::ndarray<nb::numpy, T, nb::ndim<1>> binary(nb::ndarray<T, nb::c_contig> a,
-                     nb::ndarray<T, nb::c_contig> b) {
+nb::ndarray<nb::numpy, T, nb::ndim<1>> binary(nb::ndarray<T, nb::c_contig, nb::device::cpu> a,
+                     nb::ndarray<T, nb::c_contig, nb::device::cpu> b) {
     const size_t N = a.shape(0);
     if (b.shape(0) != N) throw std::runtime_error("shape mismatch");
     const T* A = a.data();
@@ -34,20 +42,7 @@ nb::ndarray<nb::numpy, T, nb::ndim<1>> binary(nb::ndarray<T, nb::c_contig> a,
     nb::capsule deleter(C, [](void* p) noexcept { free(p); });
 #endif
 
-    const ScalableTag<T> d;
-    const size_t L = Lanes(d);
-    Op op;
-    size_t i = 0;
-
-    for (; i + L <= N; i += L) {
-        auto va = Load(d, A + i);
-        auto vb = Load(d, B + i);
-        auto vc = op(va, vb);
-        Store(vc, d, C + i);
-    }
-    for (; i < N; ++i) {
-        C[i] = op(A[i], B[i]);
-    }
+    binary_n<T, Op>(A, B, C, N);
 
     return nb::ndarray<nb::numpy, T, nb::ndim<1>>(C, { N }, deleter);
 }
@@ -61,13 +56,13 @@ struct Symbol##Op {
     HWY_INLINE double operator()(double a, double b) const { return (expr_scalar); }  \
 };                                                                                   \
 inline nb::ndarray<nb::numpy, float, nb::ndim<1>>                                    \
-Symbol(nb::ndarray<float,  nb::c_contig> a,                                          \
-       nb::ndarray<float,  nb::c_contig> b) {                                        \
+Symbol(nb::ndarray<float,  nb::c_contig, nb::device::cpu> a,                                          \
+       nb::ndarray<float,  nb::c_contig, nb::device::cpu> b) {                                        \
     return binary<float,  Symbol##Op>(a, b);                                          \
 }                                                                                    \
 inline nb::ndarray<nb::numpy, double, nb::ndim<1>>                                   \
-Symbol(nb::ndarray<double, nb::c_contig> a,                                          \
-       nb::ndarray<double, nb::c_contig> b) {                                        \
+Symbol(nb::ndarray<double, nb::c_contig, nb::device::cpu> a,                                          \
+       nb::ndarray<double, nb::c_contig, nb::device::cpu> b) {                                        \
     return binary<double, Symbol##Op>(a, b);                                          \
 }
 
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+#include "linalg.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// Cholesky factorisation and triangular solves on top of BLAS trsm/syrk,
+// without LAPACK. Factors are computed as A = U^T U in the upper triangle
+// of a row-major buffer, which is the column-major lower factor LAPACK
+// would produce; a lower L = U^T is returned by mirroring the triangle.
+
+// order at which the recursion stops; a 128 x 128 double block (128 KiB)
+// is factored in L2 by the unblocked loop
+constexpr size_t kCholeskyBlock = 128;
+
+// Unblocked right-looking U^T U factorisation of the upper triangle of a
+// row-major (n, n) block: row k is scaled by 1 / u_kk and its outer
+// product subtracted from the trailing rows, so every update runs along
+// contiguous rows. offset is the block's row in the full matrix.
+template <typename T>
+void cholesky_unblocked(T* A, size_t n, size_t lda, size_t offset, const char* fn) {
+    for (size_t k = 0; k < n; ++k) {
+        T* rk = A + k * lda;
+        const T d = rk[k];
+        if (!(d > T(0)))
+            throw std::runtime_error(std::string(fn) + ": matrix is not positive definite (leading minor " +
+                                     std::to_string(offset + k + 1) + ")");
+        const T u = std::sqrt(d);
+        const T inv = T(1) / u;
+        rk[k] = u;
+        for (size_t j = k + 1; j < n; ++j) rk[j] *= inv;
+        for (size_t i = k + 1; i < n; ++i) {
+            const T s = rk[i];
+            T* ri = A + i * lda;
+            for (size_t j = i; j < n; ++j) ri[j] -= s * rk[j];
+        }
+    }
+}
+
+// Recursive U^T U factorisation of the upper triangle of a row-major
+// (n, n) buffer, in place: the leading block is factored, the block to its
+// right solved with trsm and the trailing block downdated with syrk before
+// recursing, so all but O(n * kCholeskyBlock^2) flops run in large,
+// multi-threaded level-3 BLAS calls. The lower triangle is not touched.
+template <typename T>
+void cholesky_upper(T* A, size_t n, size_t lda, const char* fn, size_t offset = 0) {
+    if (n <= kCholeskyBlock) {
+        cholesky_unblocked(A, n, lda, offset, fn);
+        return;
+    }
+    // split on a multiple of the block so the base cases stay full size
+    const size_t n1 = std::max(kCholeskyBlock, n / 2 / kCholeskyBlock * kCholeskyBlock);
+    const size_t n2 = n - n1;
+    T* A12 = A + n1;
+    T* A22 = A + n1 * lda + n1;
+    cholesky_upper(A, n1, lda, fn, offset);
+    trsm<T>(true, true, n1, n2, T(1), A, lda, A12, lda);   // U12 = U11^-T A12
+    syrk<T>(true, n2, n1, T(-1), A12, lda, T(1), A22, lda);  // A22 -= U12^T U12
+    cholesky_upper(A22, n2, lda, fn, offset + n1);
+}
+
+// C (n, n) = upper triangle of A, read through its strides; the lower
+// triangle of C is left unset
+template <typename T>
+void copy_upper(const Strided2D<T>& A, size_t n, T* C) {
+    const int64_t s0 = A.stride(0), s1 = A.stride(1);
+    const T* a = A.data();
+    parallel_for(n, std::max<size_t>(1, (size_t(1) << 16) / std::max<size_t>(n, 1)), [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            const T* row = a + int64_t(i) * s0;
+            if (s1 == 1) std::memcpy(C + i * n + i, row + i, (n - i) * sizeof(T));
+            else for (size_t j = i; j < n; ++j) C[i * n + j] = row[int64_t(j) * s1];
+        }
+    });
+}
+
+// zeroes the strict lower (upper = true) or strict upper triangle of a
+// row-major (n, n) buffer
+template <typename T>
+void zero_triangle(T* C, size_t n, bool upper) {
+    parallel_for(n, std::max<size_t>(1, (size_t(1) << 16) / std::max<size_t>(n, 1)), [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            if (upper) std::fill(C + i * n, C + i * n + i, T(0));
+            else std::fill(C + i * n + i + 1, C + (i + 1) * n, T(0));
+        }
+    });
+}
+
+// X = op(A)^-1 X in place for a triangular (n, n) A in any layout
+// blas_view accepts and a row-major (n, k) X. An F-ordered A is the
+// row-major buffer of A^T, which holds the other triangle.
+template <typename T>
+void tri_solve(const BlasView<T>& a, bool lower, bool trans, size_t n, size_t k, T* X) {
+    if (n == 0 || k == 0) return;
+    trsm<T>(a.trans ? lower : !lower, a.trans != trans, n, k, T(1), a.data, a.ld, X, k);
+}
+
+// shape checks shared by the solvers; returns the number of right-hand
+// sides of b, which must be (n,) or (n, k)
+template <typename T>
+size_t check_system(const Strided2D<T>& A, const nb::ndarray<T, nb::c_contig, nb::device::cpu>& b, const char* fn) {
+    const size_t n = A.shape(0);
+    if (A.shape(1) != n) throw std::runtime_error(std::string(fn) + ": A must be square");
+    if (b.ndim() != 1 && b.ndim() != 2) throw std::runtime_error(std::string(fn) + ": b must be 1-D or 2-D");
+    if (b.shape(0) != n) throw std::runtime_error(std::string(fn) + ": b must have A.shape[0] rows");
+    return b.ndim() == 2 ? b.shape(1) : 1;
+}
+
+// output array shaped like b holding a copy of it
+template <typename T>
+nb::ndarray<nb::numpy, T> copy_rhs(const nb::ndarray<T, nb::c_contig, nb::device::cpu>& b, T** out) {
+    const size_t count = b.ndim() == 2 ? b.shape(0) * b.shape(1) : b.shape(0);
+    T* X = static_cast<T*>(aligned_alloc64(std::max<size_t>(count, 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(X, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(X, [](void* p) noexcept { free(p); });
+#endif
+    if (count) std::memcpy(X, b.data(), count * sizeof(T));
+    size_t shape[2] = { b.shape(0), b.ndim() == 2 ? b.shape(1) : 1 };
+    *out = X;
+    return nb::ndarray<nb::numpy, T>(X, b.ndim(), shape, deleter);
+}
+
+// Cholesky factor of a symmetric positive definite A: L with A = L L^T
+// (lower) or U with A = U^T U. Only the upper triangle of A is read.
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<2>> cholesky(Strided2D<T> A, bool lower) {
+    const size_t n = A.shape(0);
+    if (A.shape(1) != n) throw std::runtime_error("cholesky: A must be square");
+    T* C = static_cast<T*>(aligned_alloc64(std::max<size_t>(n * n, 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+    {
+        // on failure the capsule frees C
+        nb::gil_scoped_release release;
+        copy_upper(A, n, C);
+        cholesky_upper(C, n, n, "cholesky");
+        if (lower) mirror_upper(C, n);
+        zero_triangle(C, n, !lower);
+    }
+    return { C, { n, n }, deleter };
+}
+
+// x = op(A)^-1 b for a triangular A; b is (n,) or (n, k)
+template <typename T>
+nb::ndarray<nb::numpy, T> solve_triangular(Strided2D<T> A, nb::ndarray<T, nb::c_contig, nb::device::cpu> b,
+                                           bool lower, bool trans) {
+    const size_t k = check_system(A, b, "solve_triangular");
+    const size_t n = A.shape(0);
+    const int64_t diag = A.stride(0) + A.stride(1);
+    for (size_t i = 0; i < n; ++i)
+        if (A.data()[int64_t(i) * diag] == T(0))
+            throw std::runtime_error("solve_triangular: A is singular (zero on the diagonal)");
+    T* X;
+    auto out = copy_rhs(b, &X);
+    {
+        nb::gil_scoped_release release;
+        tri_solve(blas_view(A), lower, trans, n, k, X);
+    }
+    return out;
+}
+
+// x = A^-1 b given the Cholesky factor of A (L with lower, else U), by a
+// forward and a back substitution
+template <typename T>
+nb::ndarray<nb::numpy, T> cho_solve(Strided2D<T> F, nb::ndarray<T, nb::c_contig, nb::device::cpu> b, bool lower) {
+    const size_t k = check_system(F, b, "cho_solve");
+    const size_t n = F.shape(0);
+    T* X;
+    auto out = copy_rhs(b, &X);
+    {
+        nb::gil_scoped_release release;
+        const BlasView<T> f = blas_view(F);
+        tri_solve(f, lower, !lower, n, k, X);  // L y = b or U^T y = b
+        tri_solve(f, lower, lower, n, k, X);   // L^T x = y or U x = y
+    }
+    return out;
+}
+
+// log det A = 2 sum log u_ii for a symmetric positive definite A, through
+// its Cholesky factor; only the upper triangle of A is read
+template <typename T>
+T logdet(Strided2D<T> A) {
+    const size_t n = A.shape(0);
+    if (A.shape(1) != n) throw std::runtime_error("logdet: A must be square");
+    nb::gil_scoped_release release;
+    std::vector<T> C(n * n);
+    copy_upper(A, n, C.data());
+    cholesky_upper(C.data(), n, n, "logdet");
+    double s = 0.0;
+    for (size_t i = 0; i < n; ++i) s += std::log(double(C[i * n + i]));
+    return T(2.0 * s);
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
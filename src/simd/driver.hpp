@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <hwy/highway.h>
+
+#include "../parallel.hpp"
+
+// Shared loops for the elementwise and reduction kernels. A kernel only
+// supplies its per-vector operation; the drivers own the loop structure:
+// unaligned loads (inputs are caller buffers with any alignment), 4x
+// unrolling, masked LoadN/StoreN for heads and tails instead of scalar
+// loops, output alignment and non-temporal stores, and the split across
+// threads for large inputs.
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// vectors per main-loop iteration; four independent accumulators hide the
+// add/mul latency in reductions
+constexpr size_t kUnroll = 4;
+
+// Threading hook: inputs are cut into blocks of kBlock elements (a
+// multiple of every vector width, so an aligned output stays aligned per
+// block) and spread over threads with at least kGrain elements each;
+// below 2 * kGrain everything runs on the calling thread.
+constexpr size_t kBlock = 4096;
+constexpr size_t kGrain = size_t(1) << 18;
+
+// How an elementwise kernel writes its output. Auto streams outputs of at
+// least stream_bytes() and caches the rest; the other two force a choice
+// (the benchmark compares them).
+enum class Stores { Auto, Cached, Stream };
+
+// Outputs this large are written with non-temporal stores. A cached store
+// to a line that is not in cache first reads it (read-for-ownership), so a
+// binary op over arrays past the last-level cache moves 4 bytes per 3
+// useful ones; streaming skips the read. Below the LLC the result is
+// usually read again soon and should stay cached. The default sits above
+// common desktop LLC sizes; CAPNHOOK_STREAM_BYTES overrides it.
+inline size_t env_stream_bytes() {
+    const char* v = std::getenv("CAPNHOOK_STREAM_BYTES");
+    if (v && *v) return size_t(std::strtoull(v, nullptr, 10));
+    return size_t(32) << 20;
+}
+
+inline size_t stream_bytes() {
+    static const size_t bytes = env_stream_bytes();
+    return bytes;
+}
+
+// workers parallel_blocks uses over N elements
+inline size_t block_threads(size_t N) {
+    return parallel_threads((N + kBlock - 1) / kBlock, kGrain / kBlock);
+}
+
+// calls body(tid, begin, end) over [0, N) in kBlock-aligned ranges, one
+// per worker, tid < nt
+template <class Body>
+void parallel_blocks(size_t N, size_t nt, const Body& body) {
+    const size_t nblocks = (N + kBlock - 1) / kBlock;
+    parallel_chunks(nblocks, nt, [&](size_t tid, size_t b, size_t e) {
+        body(tid, b * kBlock, std::min(N, e * kBlock));
+    });
+}
+
+template <class Body>
+void parallel_blocks(size_t N, const Body& body) {
+    parallel_blocks(N, block_threads(N), body);
+}
+
+// Max/Min leave NaN handling to the target (x86 returns the second
+// operand); these propagate a NaN from either side like numpy
+template <class V>
+HWY_INLINE V nan_max(V a, V b) {
+    return IfThenElse(IsNaN(a), a, IfThenElse(IsNaN(b), b, Max(a, b)));
+}
+
+template <class V>
+HWY_INLINE V nan_min(V a, V b) {
+    return IfThenElse(IsNaN(a), a, IfThenElse(IsNaN(b), b, Min(a, b)));
+}
+
+// scalar forms, for tails and merged partials
+inline float nan_max(float a, float b) { return std::isnan(a) ? a : std::isnan(b) ? b : std::max(a, b); }
+inline double nan_max(double a, double b) { return std::isnan(a) ? a : std::isnan(b) ? b : std::max(a, b); }
+inline float nan_min(float a, float b) { return std::isnan(a) ? a : std::isnan(b) ? b : std::min(a, b); }
+inline double nan_min(double a, double b) { return std::isnan(a) ? a : std::isnan(b) ? b : std::min(a, b); }
+
+// Elementwise inputs: a `const T*` array read at index i, a Splat that
+// broadcasts one value to every lane, or a `const bool*` mask that loads
+// as a mask over T lanes. Masked tail loads go through load_n.
+template <typename T>
+struct Splat { T value; };
+
+template <class D>
+HWY_INLINE VFromD<D> load_at(D d, const TFromD<D>* p, size_t i) { return LoadU(d, p + i); }
+template <class D>
+HWY_INLINE VFromD<D> load_n(D d, const TFromD<D>* p, size_t i, size_t n) { return LoadN(d, p + i, n); }
+
+template <class D>
+HWY_INLINE VFromD<D> load_at(D d, const Splat<TFromD<D>>& s, size_t) { return Set(d, s.value); }
+template <class D>
+HWY_INLINE VFromD<D> load_n(D d, const Splat<TFromD<D>>& s, size_t, size_t) { return Set(d, s.value); }
+
+// bytes of a bool array widened to T lanes: u8 -> i32, then to float or
+// double
+template <class D, class V8>
+HWY_INLINE MFromD<D> bool_mask(D d, V8 bytes) {
+    const Rebind<int32_t, D> di;
+    const auto w = PromoteTo(di, bytes);
+    if constexpr (sizeof(TFromD<D>) == 4) return Ne(ConvertTo(d, w), Zero(d));
+    else return Ne(PromoteTo(d, w), Zero(d));
+}
+
+template <class D>
+HWY_INLINE MFromD<D> load_at(D d, const bool* p, size_t i) {
+    const Rebind<uint8_t, D> d8;
+    return bool_mask(d, LoadU(d8, reinterpret_cast<const uint8_t*>(p + i)));
+}
+template <class D>
+HWY_INLINE MFromD<D> load_n(D d, const bool* p, size_t i, size_t n) {
+    const Rebind<uint8_t, D> d8;
+    return bool_mask(d, LoadN(d8, reinterpret_cast<const uint8_t*>(p + i), n));
+}
+
+// C[i] = f(d, in[i]...) for i in [b, e) on one thread. Elements are
+// peeled with a masked store until C + i sits on a vector boundary, so
+// the main loop can use aligned or streaming stores.
+template <typename T, class F, class... P>
+HWY_INLINE void elementwise_range(T* HWY_RESTRICT C, size_t b, size_t e, bool stream,
+                                  const F& f, const P&... in) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    const size_t vbytes = L * sizeof(T);
+    size_t i = b;
+
+    const size_t off = size_t(reinterpret_cast<uintptr_t>(C + i) % vbytes);
+    const bool aligned = off % sizeof(T) == 0;  // else no vector boundary to reach
+    if (aligned && off) {
+        const size_t n = std::min(e - i, (vbytes - off) / sizeof(T));
+        StoreN(f(d, load_n(d, in, i, n)...), d, C + i, n);
+        i += n;
+    }
+
+    auto run = [&](auto put) {
+        for (; i + kUnroll * L <= e; i += kUnroll * L) {
+            const auto v0 = f(d, load_at(d, in, i)...);
+            const auto v1 = f(d, load_at(d, in, i + L)...);
+            const auto v2 = f(d, load_at(d, in, i + 2 * L)...);
+            const auto v3 = f(d, load_at(d, in, i + 3 * L)...);
+            put(v0, C + i);
+            put(v1, C + i + L);
+            put(v2, C + i + 2 * L);
+            put(v3, C + i + 3 * L);
+        }
+        for (; i + L <= e; i += L) put(f(d, load_at(d, in, i)...), C + i);
+    };
+    if (!aligned) {
+        run([&](auto v, T* p) { StoreU(v, d, p); });
+    } else if (stream) {
+        run([&](auto v, T* p) { Stream(v, d, p); });
+        // order the weakly-ordered stores before the result is handed out
+        FlushStream();
+    } else {
+        run([&](auto v, T* p) { Store(v, d, p); });
+    }
+
+    if (i < e) StoreN(f(d, load_n(d, in, i, e - i)...), d, C + i, e - i);
+}
+
+// C[i] = f(d, in[i]...) for i in [0, N). f maps one vector (or mask) per
+// input to the output vector; it also sees the zero-filled lanes of masked
+// loads, whose results are never stored.
+template <typename T, Stores S = Stores::Auto, class F, class... P>
+void elementwise_n(T* C, size_t N, const F& f, const P&... in) {
+    const bool stream = S == Stores::Stream ||
+                        (S == Stores::Auto && N * sizeof(T) >= stream_bytes());
+    parallel_blocks(N, [&](size_t, size_t b, size_t e) {
+        elementwise_range(C, b, e, stream, f, in...);
+    });
+}
+
+// Reduces A[b, e) on one thread with kUnroll accumulators. R supplies
+//   pad(d):      lanes that masked-off tail elements load as (the identity)
+//   init(d):     starting accumulator
+//   step(a, v):  folds a vector of input into an accumulator
+//   merge(a, b): combines two accumulators, as vectors or scalars
+//   fold(d, a):  the accumulator's lanes as one scalar
+template <typename T, class R>
+HWY_INLINE T reduce_range(const T* HWY_RESTRICT A, size_t b, size_t e, const R& r) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    auto a0 = r.init(d), a1 = r.init(d), a2 = r.init(d), a3 = r.init(d);
+    size_t i = b;
+    for (; i + kUnroll * L <= e; i += kUnroll * L) {
+        a0 = r.step(a0, LoadU(d, A + i));
+        a1 = r.step(a1, LoadU(d, A + i + L));
+        a2 = r.step(a2, LoadU(d, A + i + 2 * L));
+        a3 = r.step(a3, LoadU(d, A + i + 3 * L));
+    }
+    for (; i + L <= e; i += L) a0 = r.step(a0, LoadU(d, A + i));
+    if (i < e) a1 = r.step(a1, LoadNOr(r.pad(d), d, A + i, e - i));
+    return r.fold(d, r.merge(r.merge(a0, a1), r.merge(a2, a3)));
+}
+
+// reduction of A[0, N) under R; threads reduce their own ranges and the
+// partials are merged in order
+template <typename T, class R>
+T reduce_n(const T* A, size_t N, const R& r) {
+    const size_t nt = block_threads(N);
+    if (nt <= 1) return reduce_range(A, 0, N, r);
+    std::vector<T> part(nt);
+    parallel_blocks(N, nt, [&](size_t tid, size_t b, size_t e) { part[tid] = reduce_range(A, b, e, r); });
+    T acc = part[0];
+    for (size_t t = 1; t < nt; ++t) acc = r.merge(acc, part[t]);
+    return acc;
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
@@ -1,17 +1,26 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <stdexcept>
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <type_traits>
 #include <nanobind/nanobind.h>
 #include <nanobind/ndarray.h>
+#include <hwy/highway.h>
 
 #include "../alloc.hpp"
+#include "../parallel.hpp"
+#include "driver.hpp"
+#include "reduce.hpp"
+#include "../interop.hpp"
 
 #ifdef USE_ACCELERATE
   #include <Accelerate/Accelerate.h>   
@@ -26,8 +35,150 @@ namespace hwy {
 namespace HWY_NAMESPACE {
 namespace capnhook {
 
+// Scope of one BLAS call under the threading runtime. A call from outside
+// any parallel loop claims the pool and lets BLAS use num_threads()
+// threads; inside a loop, or while another thread's loop holds the pool,
+// BLAS runs on the calling thread. OpenBLAS's thread count is process
+// wide, so it is kept at 1 outside claimed calls. Other BLAS libraries
+// manage their own threads.
+class BlasThreads {
+public:
+    BlasThreads() : lock_(runtime::pool().busy, std::defer_lock) {
+        static const bool init = (set(1), true);
+        (void)init;
+        if (!in_parallel_region && lock_.try_lock()) set(runtime::num_threads());
+    }
+    ~BlasThreads() { if (lock_.owns_lock()) set(1); }
+
+private:
+    static void set(size_t n) {
+#if defined(OPENBLAS_VERSION)
+        openblas_set_num_threads(int(n));
+#else
+        (void)n;
+#endif
+    }
+
+    std::unique_lock<std::mutex> lock_;
+};
+
+// row-major C = alpha * op(A) * op(B) + beta * C on raw buffers, where op
+// transposes when the matching flag is set
+template <typename T>
+void gemm(bool trans_a, bool trans_b, size_t M, size_t N, size_t K,
+          T alpha, const T* A, size_t lda, const T* B, size_t ldb,
+          T beta, T* C, size_t ldc) {
+    BlasThreads threads;
+    const auto ta = trans_a ? CblasTrans : CblasNoTrans;
+    const auto tb = trans_b ? CblasTrans : CblasNoTrans;
+    if constexpr (std::is_same_v<T, float>) {
+        cblas_sgemm(CblasRowMajor, ta, tb, M, N, K, alpha,
+                    A, lda, B, ldb, beta, C, ldc);
+    } else {
+        cblas_dgemm(CblasRowMajor, ta, tb, M, N, K, alpha,
+                    A, lda, B, ldb, beta, C, ldc);
+    }
+}
+
+// row-major y = alpha * op(A) * x + beta * y for an (M, N) buffer A
+template <typename T>
+void gemv(bool trans, size_t M, size_t N, T alpha, const T* A, size_t lda,
+          const T* x, T beta, T* y) {
+    BlasThreads threads;
+    const auto ta = trans ? CblasTrans : CblasNoTrans;
+    if constexpr (std::is_same_v<T, float>) {
+        cblas_sgemv(CblasRowMajor, ta, M, N, alpha, A, lda, x, 1, beta, y, 1);
+    } else {
+        cblas_dgemv(CblasRowMajor, ta, M, N, alpha, A, lda, x, 1, beta, y, 1);
+    }
+}
+
+// row-major upper triangle of C = alpha * op(A) * op(A)^T + beta * C for
+// an (n, n) buffer C; op(A) is (n, k) and transposes A when trans is set
 template <typename T>
-T dot(nb::ndarray<T, nb::c_contig> a, nb::ndarray<T, nb::c_contig> b) {
+void syrk(bool trans, size_t n, size_t k, T alpha, const T* A, size_t lda,
+          T beta, T* C, size_t ldc) {
+    BlasThreads threads;
+    const auto ta = trans ? CblasTrans : CblasNoTrans;
+    if constexpr (std::is_same_v<T, float>) {
+        cblas_ssyrk(CblasRowMajor, CblasUpper, ta, n, k, alpha, A, lda, beta, C, ldc);
+    } else {
+        cblas_dsyrk(CblasRowMajor, CblasUpper, ta, n, k, alpha, A, lda, beta, C, ldc);
+    }
+}
+
+// row-major B = alpha * op(A)^-1 B for a triangular (M, M) buffer A and an
+// (M, N) buffer B, solved in place; upper picks the triangle of A read
+// and op transposes it when trans is set
+template <typename T>
+void trsm(bool upper, bool trans, size_t M, size_t N, T alpha, const T* A, size_t lda, T* B, size_t ldb) {
+    BlasThreads threads;
+    const auto ul = upper ? CblasUpper : CblasLower;
+    const auto ta = trans ? CblasTrans : CblasNoTrans;
+    if constexpr (std::is_same_v<T, float>) {
+        cblas_strsm(CblasRowMajor, CblasLeft, ul, ta, CblasNonUnit, M, N, alpha, A, lda, B, ldb);
+    } else {
+        cblas_dtrsm(CblasRowMajor, CblasLeft, ul, ta, CblasNonUnit, M, N, alpha, A, lda, B, ldb);
+    }
+}
+
+// copies the upper triangle of a row-major (n, n) buffer into the lower one
+// in square blocks so the transposed reads stay within a few cache lines
+template <typename T>
+void mirror_upper(T* C, size_t n) {
+    constexpr size_t blk = 64;
+    const size_t nb_rows = (n + blk - 1) / blk;
+    parallel_for(nb_rows, 1, [&](size_t, size_t bb, size_t be) {
+        for (size_t bi = bb; bi < be; ++bi) {
+            const size_t i0 = bi * blk, i1 = std::min(n, i0 + blk);
+            for (size_t j0 = 0; j0 < i1; j0 += blk) {
+                const size_t j1 = std::min(i1, j0 + blk);
+                for (size_t i = i0; i < i1; ++i)
+                    for (size_t j = j0; j < std::min(j1, i); ++j) C[i * n + j] = C[j * n + i];
+            }
+        }
+    });
+}
+
+// SIMD dot product of two raw buffers of length n (no alignment required)
+template <typename T>
+T dot_n(const T* A, const T* B, size_t n) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    auto acc = Zero(d);
+    size_t i = 0;
+    for (; i + L <= n; i += L)
+        acc = MulAdd(LoadU(d, A + i), LoadU(d, B + i), acc);
+    T sum = GetLane(SumOfLanes(d, acc));
+    for (; i < n; ++i) sum += A[i] * B[i];
+    return sum;
+}
+
+// SIMD squared euclidean distance of two raw buffers of length n
+template <typename T>
+T sq_dist_n(const T* A, const T* B, size_t n) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    auto acc = Zero(d);
+    size_t i = 0;
+    for (; i + L <= n; i += L) {
+        auto diff = Sub(LoadU(d, A + i), LoadU(d, B + i));
+        acc = MulAdd(diff, diff, acc);
+    }
+    T sum = GetLane(SumOfLanes(d, acc));
+    for (; i < n; ++i) sum += (A[i] - B[i]) * (A[i] - B[i]);
+    return sum;
+}
+
+// out[i] = ||X[i, :]||^2 for a row-major (N, D) buffer
+template <typename T>
+void row_sq_norms(const T* X, size_t N, size_t D, T* out) {
+    for (size_t i = 0; i < N; ++i)
+        out[i] = dot_n(X + i * D, X + i * D, D);
+}
+
+template <typename T>
+T dot(nb::ndarray<T, nb::c_contig, nb::device::cpu> a, nb::ndarray<T, nb::c_contig, nb::device::cpu> b) {
     const size_t N = a.shape(0);
     
     if (b.shape(0) != N) {
@@ -38,7 +189,7 @@ T dot(nb::ndarray<T, nb::c_contig> a, nb::ndarray<T, nb::c_contig> b) {
     const T* B = b.data();
     
     T result = 0;
-    
+    BlasThreads threads;
     if constexpr (std::is_same_v<T, float>) {
         result = cblas_sdot(N, A, 1, B, 1);
     } else if constexpr (std::is_same_v<T, double>) {
@@ -48,45 +199,240 @@ T dot(nb::ndarray<T, nb::c_contig> a, nb::ndarray<T, nb::c_contig> b) {
     return result;
 }
 
+// 2-D operand with any strides, so transposed views and F-ordered arrays
+// arrive without nanobind making a C-ordered copy
+template <typename T>
+using Strided2D = nb::ndarray<T, nb::device::cpu, nb::ndim<2>>;
+
+// A 2-D operand as a row-major BLAS buffer. C-ordered rows map directly
+// (trans = false); an F-ordered array, such as the .T of a C-ordered one,
+// is the row-major buffer of its transpose (trans = true). ld is the
+// stride between buffer rows; strides of length-1 dimensions are ignored.
+// Other layouts (strided slices, negative strides) are packed into copy.
+template <typename T>
+struct BlasView {
+    const T* data = nullptr;
+    bool trans = false;
+    size_t ld = 1;
+    std::vector<T> copy;
+};
+
+template <typename T>
+BlasView<T> blas_view(const Strided2D<T>& a) {
+    const size_t r = a.shape(0), c = a.shape(1);
+    const int64_t s0 = a.stride(0), s1 = a.stride(1);
+    BlasView<T> v;
+    v.data = a.data();
+    if ((c <= 1 || s1 == 1) && (r <= 1 || s0 >= int64_t(c))) {
+        v.ld = std::max<size_t>(r <= 1 ? 0 : size_t(s0), std::max<size_t>(c, 1));
+    } else if ((r <= 1 || s0 == 1) && (c <= 1 || s1 >= int64_t(r))) {
+        v.trans = true;
+        v.ld = std::max<size_t>(c <= 1 ? 0 : size_t(s1), std::max<size_t>(r, 1));
+    } else {
+        v.copy.resize(r * c);
+        for (size_t i = 0; i < r; ++i)
+            for (size_t j = 0; j < c; ++j) v.copy[i * c + j] = a.data()[int64_t(i) * s0 + int64_t(j) * s1];
+        v.data = v.copy.data();
+        v.ld = std::max<size_t>(c, 1);
+    }
+    return v;
+}
+
 template <typename T>
-nb::ndarray<nb::numpy, T, nb::ndim<2>> matmul(nb::ndarray<T, nb::c_contig, nb::ndim<2>> A,
-                      nb::ndarray<T, nb::c_contig, nb::ndim<2>> B) {
+nb::ndarray<nb::numpy, T, nb::ndim<2>> matmul(Strided2D<T> A, Strided2D<T> B) {
     size_t M = A.shape(0), K = A.shape(1),
            K2 = B.shape(0), N = B.shape(1);
     if (K2 != K) throw std::runtime_error("matmul: inner dims must match");
 
-    size_t bytes = M * N * sizeof(T);
+    size_t bytes = std::max<size_t>(M * N, 1) * sizeof(T);
     void* raw = aligned_alloc64(bytes);
     T* C   = static_cast<T*>(raw);
 
-    T alpha = T(1), beta = T(0);
-    // row‑major
-    if constexpr (std::is_same_v<T, float>) {
-        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans,
-                    M, N, K, alpha,
-                    A.data(), K,
-                    B.data(), N,
-                    beta,
-                    C, N);
+    {
+        nb::gil_scoped_release release;
+        const BlasView<T> a = blas_view(A), b = blas_view(B);
+        gemm<T>(a.trans, b.trans, M, N, K, T(1), a.data, a.ld, b.data, b.ld, T(0), C, std::max<size_t>(N, 1));
+    }
+
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+    return { C, { M, N }, deleter };
+}
+
+// edge of the square tiles transpose_n works through; two 64x64 double
+// tiles (source and destination) fit in L1
+constexpr size_t kTransposeTile = 64;
+
+// B[j, i] = A[i, j] for the 128-bit square block at A (rows lda apart)
+// into B (rows ldb apart): 4x4 floats or 2x2 doubles, in registers
+template <typename T>
+HWY_INLINE void transpose_micro(const T* HWY_RESTRICT A, size_t lda, T* HWY_RESTRICT B, size_t ldb) {
+    const Full128<T> d;
+    if constexpr (sizeof(T) == 4) {
+        const auto r0 = LoadU(d, A), r1 = LoadU(d, A + lda);
+        const auto r2 = LoadU(d, A + 2 * lda), r3 = LoadU(d, A + 3 * lda);
+        const auto t0 = InterleaveLower(d, r0, r1), t1 = InterleaveLower(d, r2, r3);
+        const auto t2 = InterleaveUpper(d, r0, r1), t3 = InterleaveUpper(d, r2, r3);
+        StoreU(ConcatLowerLower(d, t1, t0), d, B);
+        StoreU(ConcatUpperUpper(d, t1, t0), d, B + ldb);
+        StoreU(ConcatLowerLower(d, t3, t2), d, B + 2 * ldb);
+        StoreU(ConcatUpperUpper(d, t3, t2), d, B + 3 * ldb);
     } else {
-        cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans,
-                    M, N, K, alpha,
-                    A.data(), K,
-                    B.data(), N,
-                    beta,
-                    C, N);
+        const auto r0 = LoadU(d, A), r1 = LoadU(d, A + lda);
+        StoreU(InterleaveLower(d, r0, r1), d, B);
+        StoreU(InterleaveUpper(d, r0, r1), d, B + ldb);
+    }
+}
+
+// B = A^T for a row-major (M, N) buffer A with rows lda apart, into a
+// C-ordered (N, M) buffer B. Tiles keep both the rows read and the
+// columns written in cache; rows of tiles are spread over threads.
+template <typename T>
+void transpose_n(const T* A, size_t lda, size_t M, size_t N, T* B) {
+    constexpr size_t u = 16 / sizeof(T);
+    const size_t ntiles = (M + kTransposeTile - 1) / kTransposeTile;
+    const size_t grain = std::max<size_t>(1, (size_t(1) << 16) / (kTransposeTile * std::max<size_t>(N, 1)));
+    parallel_for(ntiles, grain, [&](size_t, size_t tb, size_t te) {
+        for (size_t i0 = tb * kTransposeTile; i0 < std::min(M, te * kTransposeTile); i0 += kTransposeTile) {
+            const size_t i1 = std::min(M, i0 + kTransposeTile);
+            for (size_t j0 = 0; j0 < N; j0 += kTransposeTile) {
+                const size_t j1 = std::min(N, j0 + kTransposeTile);
+                size_t i = i0;
+#if HWY_TARGET != HWY_SCALAR
+                for (; i + u <= i1; i += u) {
+                    size_t j = j0;
+                    for (; j + u <= j1; j += u) transpose_micro(A + i * lda + j, lda, B + j * M + i, M);
+                    for (; j < j1; ++j)
+                        for (size_t k = i; k < i + u; ++k) B[j * M + k] = A[k * lda + j];
+                }
+#endif
+                for (; i < i1; ++i)
+                    for (size_t j = j0; j < j1; ++j) B[j * M + i] = A[i * lda + j];
+            }
+        }
+    });
+}
+
+// C-ordered copy of A^T; an F-ordered A already holds the result's rows
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<2>> transpose(Strided2D<T> A) {
+    const size_t M = A.shape(0), N = A.shape(1);
+    T* B = static_cast<T*>(aligned_alloc64(std::max<size_t>(M * N, 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(B, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(B, [](void* p) noexcept { free(p); });
+#endif
+    {
+        nb::gil_scoped_release release;
+        const BlasView<T> a = blas_view(A);
+        if (a.trans) {
+            for (size_t j = 0; j < N; ++j) std::memcpy(B + j * M, a.data + j * a.ld, M * sizeof(T));
+        } else {
+            transpose_n(a.data, a.ld, M, N, B);
+        }
     }
+    return { B, { N, M }, deleter };
+}
 
+// y = A @ x with A in any layout blas_view accepts
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<1>> matvec(Strided2D<T> A, nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>> x) {
+    const size_t M = A.shape(0), N = A.shape(1);
+    if (x.shape(0) != N) throw std::runtime_error("gemv: x must have A.shape[1] elements");
+    T* y = static_cast<T*>(aligned_alloc64(std::max<size_t>(M, 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(y, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(y, [](void* p) noexcept { free(p); });
+#endif
+    {
+        nb::gil_scoped_release release;
+        // BLAS returns early on an empty product without writing y
+        if (N == 0) std::fill(y, y + M, T(0));
+        else if (M > 0) {
+            const BlasView<T> a = blas_view(A);
+            if (a.trans) gemv<T>(true, N, M, T(1), a.data, a.ld, x.data(), T(0), y);
+            else gemv<T>(false, M, N, T(1), a.data, a.ld, x.data(), T(0), y);
+        }
+    }
+    return { y, { M }, deleter };
+}
+
+// C[i, j] = a[i] * b[j]; each row is a scaled copy of b, written by the
+// elementwise driver (streaming when the result exceeds the LLC)
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<2>> outer(nb::ndarray<T, nb::c_contig, nb::device::cpu> a,
+                                            nb::ndarray<T, nb::c_contig, nb::device::cpu> b) {
+    const size_t M = a.size(), N = b.size();
+    T* C = static_cast<T*>(aligned_alloc64(std::max<size_t>(M * N, 1) * sizeof(T)));
 #if defined(_MSC_VER)
     nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
 #else
     nb::capsule deleter(C, [](void* p) noexcept { free(p); });
 #endif
+    const T* A = a.data();
+    const T* B = b.data();
+    const bool stream = M * N * sizeof(T) >= stream_bytes();
+    {
+        nb::gil_scoped_release release;
+        parallel_for(M, std::max<size_t>(1, kGrain / std::max<size_t>(N, 1)), [&](size_t, size_t rb, size_t re) {
+            for (size_t i = rb; i < re; ++i)
+                elementwise_range(C + i * N, 0, N, stream, [](auto, auto s, auto v) { return Mul(s, v); },
+                                  Splat<T>{ A[i] }, B);
+        });
+    }
     return { C, { M, N }, deleter };
 }
 
+// out[i] = A[i, :] . B[i, :] over threaded blocks of rows
 template <typename T>
-T trace(nb::ndarray<T, nb::c_contig, nb::ndim<2>> A) {
+nb::ndarray<nb::numpy, T, nb::ndim<1>> row_dot(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> A,
+                                              nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> B) {
+    const size_t N = A.shape(0), D = A.shape(1);
+    if (B.shape(0) != N || B.shape(1) != D) throw std::runtime_error("row_dot: A and B must have the same shape");
+    T* out = static_cast<T*>(aligned_alloc64(std::max<size_t>(N, 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(out, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(out, [](void* p) noexcept { free(p); });
+#endif
+    const T* X = A.data();
+    const T* Y = B.data();
+    {
+        nb::gil_scoped_release release;
+        parallel_for(N, std::max<size_t>(1, kGrain / std::max<size_t>(D, 1)), [&](size_t, size_t b, size_t e) {
+            for (size_t i = b; i < e; ++i) out[i] = dot_n(X + i * D, Y + i * D, D);
+        });
+    }
+    return { out, { N }, deleter };
+}
+
+// out[i] = ||A[i, :]||_2 over threaded blocks of rows
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<1>> row_norm(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> A) {
+    const size_t N = A.shape(0), D = A.shape(1);
+    T* out = static_cast<T*>(aligned_alloc64(std::max<size_t>(N, 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(out, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(out, [](void* p) noexcept { free(p); });
+#endif
+    const T* X = A.data();
+    {
+        nb::gil_scoped_release release;
+        parallel_for(N, std::max<size_t>(1, kGrain / std::max<size_t>(D, 1)), [&](size_t, size_t b, size_t e) {
+            for (size_t i = b; i < e; ++i) out[i] = norm_range(X + i * D, D, 2.0);
+        });
+    }
+    return { out, { N }, deleter };
+}
+
+template <typename T>
+T trace(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> A) {
     size_t M = A.shape(0), N = A.shape(1);
     size_t n = std::min(M, N);
     const T* data = A.data();
@@ -96,9 +442,100 @@ T trace(nb::ndarray<T, nb::c_contig, nb::ndim<2>> A) {
     return sum;
 }
 
+// out[c] = ord-norm of column c of a row-major (rows, cols) slab, for the
+// columns [c0, c1): every row updates the whole range of accumulators, so
+// the slab is read in order. Euclidean columns whose sum of squares
+// overflowed or underflowed are redone with the scaled l2_norm.
+template <typename T>
+void column_norms(const T* X, size_t rows, size_t cols, size_t c0, size_t c1, double ord, T* out) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    auto accumulate = [&](const auto& r) {
+        std::fill(out + c0, out + c1, T(0));
+        for (size_t i = 0; i < rows; ++i) {
+            const T* row = X + i * cols;
+            size_t j = c0;
+            for (; j + L <= c1; j += L) StoreU(r.step(LoadU(d, out + j), LoadU(d, row + j)), d, out + j);
+            if (j < c1) StoreN(r.step(LoadN(d, out + j, c1 - j), LoadN(d, row + j, c1 - j)), d, out + j, c1 - j);
+        }
+    };
+    if (ord == 1) {
+        accumulate(AbsSumReduce<T>{});
+    } else if (std::isinf(ord) && ord > 0) {
+        accumulate(AbsMaxReduce<T>{});
+    } else if (ord == 2) {
+        accumulate(SqSumReduce<T>{});
+        const T tiny = std::numeric_limits<T>::min() / std::numeric_limits<T>::epsilon();
+        for (size_t j = c0; j < c1; ++j) {
+            const T s = out[j];
+            if (std::isnan(s) || (std::isfinite(s) && s >= tiny)) {
+                out[j] = std::sqrt(s);
+                continue;
+            }
+            out[j] = l2_norm<T>([&](const auto& r) {
+                auto a = r.init(CappedTag<T, 1>());
+                for (size_t i = 0; i < rows; ++i) a = r.step(a, Set(CappedTag<T, 1>(), X[i * cols + j]));
+                return GetLane(a);
+            });
+        }
+    } else {
+        throw std::runtime_error("norm: ord must be 1, 2 or inf");
+    }
+}
+
+// ord-norm of x (1, 2 or inf). Without an axis the whole array is one
+// vector and the result a scalar; with one, the norms run along that axis
+// and the result drops it. The Euclidean norm never overflows (l2_norm).
+// ord is taken as any Python number: a double parameter would reject an
+// int in nanobind's exact first pass, and the converting pass would then
+// reach the float32 overload first and downcast float64 input.
 template <typename T>
-T norm(nb::ndarray<T, nb::c_contig> a) {
-    return std::sqrt(dot(a, a));
+nb::object norm(nb::ndarray<T, nb::c_contig, nb::device::cpu> a, nb::handle ord_, std::optional<int> axis) {
+    const double ord = nb::cast<double>(ord_);
+    if (!(ord == 1 || ord == 2 || (std::isinf(ord) && ord > 0)))
+        throw std::runtime_error("norm: ord must be 1, 2 or inf");
+    if (!axis) return nb::cast(norm_n<T>(a.data(), a.size(), ord));
+
+    const int nd = int(a.ndim());
+    const int ax = *axis < 0 ? *axis + nd : *axis;
+    if (ax < 0 || ax >= nd) throw std::runtime_error("norm: axis out of range");
+    // x viewed as (outer, len, inner) with the norm taken over len
+    size_t outer = 1, inner = 1;
+    std::vector<size_t> shape;
+    for (int i = 0; i < nd; ++i) {
+        if (i < ax) outer *= a.shape(i);
+        if (i > ax) inner *= a.shape(i);
+        if (i != ax) shape.push_back(a.shape(i));
+    }
+    const size_t len = a.shape(ax);
+
+    T* out = static_cast<T*>(aligned_alloc64(std::max<size_t>(outer * inner, 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(out, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(out, [](void* p) noexcept { free(p); });
+#endif
+    {
+        nb::gil_scoped_release release;
+        const T* X = a.data();
+        if (inner == 1) {
+            parallel_for(outer, std::max<size_t>(1, kGrain / std::max<size_t>(len, 1)), [&](size_t, size_t b, size_t e) {
+                for (size_t o = b; o < e; ++o) out[o] = norm_range(X + o * len, len, ord);
+            });
+        } else {
+            // tiles of kBlock columns in one slab, spread over threads
+            const size_t per = (inner + kBlock - 1) / kBlock;
+            const size_t grain = std::max<size_t>(1, kGrain / std::max<size_t>(len * std::min(inner, kBlock), 1));
+            parallel_for(outer * per, grain, [&](size_t, size_t b, size_t e) {
+                for (size_t t = b; t < e; ++t) {
+                    const size_t o = t / per, c0 = (t % per) * kBlock;
+                    column_norms(X + o * len * inner, len, inner, c0, std::min(inner, c0 + kBlock), ord,
+                                 out + o * inner);
+                }
+            });
+        }
+    }
+    return interop::export_value(nb::ndarray<nb::numpy, T>(out, shape.size(), shape.data(), deleter));
 }
 
 } // capnhook
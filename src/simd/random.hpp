@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+#include <hwy/contrib/math/math-inl.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// Threefry-2x32-20 (Salmon et al., "Parallel random numbers: as easy as
+// 1, 2, 3", SC11). The output for block b is a pure function of (seed, b),
+// so any element of the stream can be produced independently: results do
+// not depend on thread count or vector width.
+constexpr uint32_t kThreefryParity = 0x1BD11BDA;
+
+inline uint32_t rotl32(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+inline void threefry2x32(uint32_t c0, uint32_t c1, uint32_t k0, uint32_t k1,
+                         uint32_t& o0, uint32_t& o1) {
+    static constexpr int R[8] = { 13, 15, 26, 6, 17, 29, 16, 24 };
+    const uint32_t ks[3] = { k0, k1, k0 ^ k1 ^ kThreefryParity };
+    uint32_t x0 = c0 + ks[0], x1 = c1 + ks[1];
+    for (int r = 0; r < 20; ++r) {
+        x0 += x1;
+        x1 = rotl32(x1, R[r % 8]) ^ x0;
+        if (r % 4 == 3) {
+            const uint32_t s = uint32_t(r / 4 + 1);
+            x0 += ks[s % 3];
+            x1 += ks[(s + 1) % 3] + s;
+        }
+    }
+    o0 = x0;
+    o1 = x1;
+}
+
+template <int R, class V>
+HWY_INLINE V rotl32(V v) {
+    return Or(ShiftLeft<R>(v), ShiftRight<32 - R>(v));
+}
+
+// Writes the 2 * nb words of blocks [b0, b0 + nb) to out, interleaved as
+// x0, x1 of each block in turn.
+inline void threefry_blocks(uint64_t seed, uint64_t b0, size_t nb, uint32_t* out) {
+    const ScalableTag<uint32_t> du;
+    const size_t L = Lanes(du);
+    const uint32_t k0 = uint32_t(seed), k1 = uint32_t(seed >> 32);
+    const uint32_t k2 = k0 ^ k1 ^ kThreefryParity;
+    const auto ks0 = Set(du, k0), ks1 = Set(du, k1), ks2 = Set(du, k2);
+    size_t i = 0;
+
+    for (; i + L <= nb; i += L) {
+        const uint64_t b = b0 + i;
+        const uint32_t lo = uint32_t(b), hi = uint32_t(b >> 32);
+        auto c0 = Iota(du, lo);
+        // carry into the high word for lanes whose low word wrapped
+        auto c1 = Add(Set(du, hi), IfThenElseZero(Lt(c0, Set(du, lo)), Set(du, 1u)));
+        auto x0 = Add(c0, ks0);
+        auto x1 = Add(c1, ks1);
+#define CAPNHOOK_TF_ROUND(R) x0 = Add(x0, x1); x1 = Xor(rotl32<R>(x1), x0);
+#define CAPNHOOK_TF_INJECT(S, KA, KB) \
+        x0 = Add(x0, KA); x1 = Add(x1, Add(KB, Set(du, uint32_t(S))));
+        CAPNHOOK_TF_ROUND(13) CAPNHOOK_TF_ROUND(15) CAPNHOOK_TF_ROUND(26) CAPNHOOK_TF_ROUND(6)
+        CAPNHOOK_TF_INJECT(1, ks1, ks2)
+        CAPNHOOK_TF_ROUND(17) CAPNHOOK_TF_ROUND(29) CAPNHOOK_TF_ROUND(16) CAPNHOOK_TF_ROUND(24)
+        CAPNHOOK_TF_INJECT(2, ks2, ks0)
+        CAPNHOOK_TF_ROUND(13) CAPNHOOK_TF_ROUND(15) CAPNHOOK_TF_ROUND(26) CAPNHOOK_TF_ROUND(6)
+        CAPNHOOK_TF_INJECT(3, ks0, ks1)
+        CAPNHOOK_TF_ROUND(17) CAPNHOOK_TF_ROUND(29) CAPNHOOK_TF_ROUND(16) CAPNHOOK_TF_ROUND(24)
+        CAPNHOOK_TF_INJECT(4, ks1, ks2)
+        CAPNHOOK_TF_ROUND(13) CAPNHOOK_TF_ROUND(15) CAPNHOOK_TF_ROUND(26) CAPNHOOK_TF_ROUND(6)
+        CAPNHOOK_TF_INJECT(5, ks2, ks0)
+#undef CAPNHOOK_TF_ROUND
+#undef CAPNHOOK_TF_INJECT
+        StoreInterleaved2(x0, x1, du, out + 2 * i);
+    }
+    for (; i < nb; ++i)
+        threefry2x32(uint32_t(b0 + i), uint32_t((b0 + i) >> 32), k0, k1,
+                     out[2 * i], out[2 * i + 1]);
+}
+
+// Stream elements are produced in fixed chunks of the global index so that
+// paired draws (Box-Muller) are reproducible for any offset and split.
+constexpr size_t kRandomChunk = 1024;
+
+enum class Dist { Uniform, Normal, Bernoulli };
+
+// Uniforms for chunk c of the stream. float uses one 32-bit word per
+// element (24 significant bits), double one 64-bit block (53 bits). With
+// open_low the values lie in (0, 1] instead of [0, 1).
+template <typename T>
+void uniform_chunk(uint64_t seed, uint64_t c, bool open_low, T* out) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    HWY_ALIGN uint32_t words[2 * kRandomChunk];
+    if constexpr (sizeof(T) == 4) {
+        threefry_blocks(seed, c * (kRandomChunk / 2), kRandomChunk / 2, words);
+        const RebindToSigned<ScalableTag<T>> di;
+        const RebindToUnsigned<ScalableTag<T>> du;
+        const auto scale = Set(d, T(1.0 / 16777216.0));
+        const auto bias = Set(di, open_low ? 1 : 0);
+        for (size_t i = 0; i < kRandomChunk; i += L) {
+            auto m = BitCast(di, ShiftRight<8>(Load(du, words + i)));
+            Store(Mul(ConvertTo(d, Add(m, bias)), scale), d, out + i);
+        }
+    } else {
+        threefry_blocks(seed, c * kRandomChunk, kRandomChunk, words);
+        const RebindToSigned<ScalableTag<T>> di;
+        const RebindToUnsigned<ScalableTag<T>> du;
+        const auto scale = Set(d, T(1.0 / 9007199254740992.0));
+        const auto bias = Set(di, open_low ? 1 : 0);
+        const uint64_t* blocks = reinterpret_cast<const uint64_t*>(words);
+        for (size_t i = 0; i < kRandomChunk; i += L) {
+            auto m = BitCast(di, ShiftRight<11>(Load(du, blocks + i)));
+            Store(Mul(ConvertTo(d, Add(m, bias)), scale), d, out + i);
+        }
+    }
+}
+
+// One chunk of the requested distribution. Normals use vectorised
+// Box-Muller: element i of the first half and element i of the second half
+// share the pair (u1[i], u2[i]) = (U[i], U[i + half]).
+template <typename T>
+void dist_chunk(Dist dist, T a, T b, uint64_t seed, uint64_t c, T* out) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    if (dist == Dist::Uniform) {
+        uniform_chunk<T>(seed, c, false, out);
+        const auto lo = Set(d, a), span = Set(d, b - a);
+        for (size_t i = 0; i < kRandomChunk; i += L)
+            Store(MulAdd(Load(d, out + i), span, lo), d, out + i);
+    } else if (dist == Dist::Bernoulli) {
+        uniform_chunk<T>(seed, c, false, out);
+        const auto p = Set(d, a), one = Set(d, T(1));
+        for (size_t i = 0; i < kRandomChunk; i += L)
+            Store(IfThenElseZero(Lt(Load(d, out + i), p), one), d, out + i);
+    } else {
+        uniform_chunk<T>(seed, c, true, out);
+        const size_t half = kRandomChunk / 2;
+        const auto mean = Set(d, a), stddev = Set(d, b);
+        const auto neg2 = Set(d, T(-2));
+        const auto two_pi = Set(d, T(6.283185307179586));
+        for (size_t i = 0; i < half; i += L) {
+            const auto u1 = Load(d, out + i);
+            const auto u2 = Load(d, out + half + i);
+            const auto r = Mul(stddev, Sqrt(Mul(neg2, hwy::HWY_NAMESPACE::Log(d, u1))));
+            const auto theta = Mul(two_pi, u2);
+            Store(MulAdd(r, hwy::HWY_NAMESPACE::Cos(d, theta), mean), d, out + i);
+            Store(MulAdd(r, hwy::HWY_NAMESPACE::Sin(d, theta), mean), d, out + half + i);
+        }
+    }
+}
+
+// Fills out[0:n] with elements [offset, offset + n) of the stream, one
+// chunk per task across threads. Partially covered chunks at either end
+// go through a scratch buffer.
+template <typename T>
+void fill_random(T* out, size_t n, Dist dist, T a, T b, uint64_t seed, uint64_t offset) {
+    if (n == 0) return;
+    const uint64_t c_first = offset / kRandomChunk;
+    const uint64_t c_last = (offset + n - 1) / kRandomChunk;
+    const size_t chunks = size_t(c_last - c_first + 1);
+    parallel_for(chunks, 8, [&](size_t, size_t cb, size_t ce) {
+        HWY_ALIGN T scratch[kRandomChunk];
+        for (size_t k = cb; k < ce; ++k) {
+            const uint64_t c = c_first + k;
+            const uint64_t g0 = std::max<uint64_t>(c * kRandomChunk, offset);
+            const uint64_t g1 = std::min<uint64_t>((c + 1) * kRandomChunk, offset + n);
+            dist_chunk<T>(dist, a, b, seed, c, scratch);
+            std::memcpy(out + (g0 - offset), scratch + (g0 - c * kRandomChunk),
+                        size_t(g1 - g0) * sizeof(T));
+        }
+    });
+}
+
+// out[i] = x[i] * keep[i] / (1 - p), keep drawn from the Bernoulli(1 - p)
+// stream at (seed, offset); the same seed and offset give the same mask
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<1>>
+dropout(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>> a, T p, uint64_t seed, uint64_t offset) {
+    if (!(p >= T(0) && p < T(1))) throw std::runtime_error("dropout: p must be in [0, 1)");
+    const size_t N = a.shape(0);
+    const T* A = a.data();
+
+    T* C = static_cast<T*>(aligned_alloc64(N * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* ptr) noexcept { _aligned_free(ptr); });
+#else
+    nb::capsule deleter(C, [](void* ptr) noexcept { free(ptr); });
+#endif
+
+    {
+        nb::gil_scoped_release release;
+        fill_random<T>(C, N, Dist::Bernoulli, T(1) - p, T(0), seed, offset);
+        const ScalableTag<T> d;
+        const size_t L = Lanes(d);
+        const T scale = T(1) / (T(1) - p);
+        parallel_for(N, 1 << 16, [&](size_t, size_t b, size_t e) {
+            const auto vs = Set(d, scale);
+            size_t i = b;
+            for (; i + L <= e; i += L)
+                StoreU(Mul(Mul(LoadU(d, A + i), LoadU(d, C + i)), vs), d, C + i);
+            for (; i < e; ++i) C[i] = A[i] * C[i] * scale;
+        });
+    }
+
+    return { C, { N }, deleter };
+}
+
+// In-place fills of a caller buffer of any shape
+template <typename T>
+void random_uniform(nb::ndarray<T, nb::c_contig, nb::device::cpu> out, T low, T high,
+                    uint64_t seed, uint64_t offset) {
+    nb::gil_scoped_release release;
+    fill_random<T>(out.data(), out.size(), Dist::Uniform, low, high, seed, offset);
+}
+
+template <typename T>
+void random_normal(nb::ndarray<T, nb::c_contig, nb::device::cpu> out, T mean, T stddev,
+                   uint64_t seed, uint64_t offset) {
+    nb::gil_scoped_release release;
+    fill_random<T>(out.data(), out.size(), Dist::Normal, mean, stddev, seed, offset);
+}
+
+template <typename T>
+void random_bernoulli(nb::ndarray<T, nb::c_contig, nb::device::cpu> out, T p,
+                      uint64_t seed, uint64_t offset) {
+    if (!(p >= T(0) && p <= T(1))) throw std::runtime_error("bernoulli: p must be in [0, 1]");
+    nb::gil_scoped_release release;
+    fill_random<T>(out.data(), out.size(), Dist::Bernoulli, p, T(0), seed, offset);
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
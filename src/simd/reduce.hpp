@@ -4,13 +4,14 @@
 #include <cstdlib>
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <stdexcept>
 #include <nanobind/nanobind.h>
 #include <nanobind/ndarray.h>
 #include <hwy/highway.h>
 
 #include "../alloc.hpp"
-#include "binary.hpp"
+#include "driver.hpp"
 
 namespace nb = nanobind;
 
@@ -19,175 +20,201 @@ namespace hwy {
 namespace HWY_NAMESPACE {
 namespace capnhook {
 
+// reduction functors for reduce_n (see driver.hpp)
+
 template <typename T>
-T reduce_sum(nb::ndarray<T, nb::c_contig> a) {
-    const T* A = a.data();
-    size_t N = a.shape(0);
-    
-    if (N == 0) throw std::runtime_error("reduce_sum: zero-length input");
-    if (N == 1) return A[0];
-    
-    const ScalableTag<T> d;
-    auto acc = Zero(d);
-    size_t i = 0, L = Lanes(d);
-    
-    if (N < L) {
-        T sum = T(0);
-        for (size_t j = 0; j < N; j++) {
-            sum += A[j];
-        }
-        return sum;
+struct SumReduce {
+    template <class D> VFromD<D> pad(D d) const { return Zero(d); }
+    template <class D> VFromD<D> init(D d) const { return Zero(d); }
+    template <class V> V step(V a, V v) const { return Add(a, v); }
+    template <class V> V merge(V a, V b) const { return Add(a, b); }
+    T merge(T a, T b) const { return a + b; }
+    template <class D, class V> T fold(D d, V a) const { return ReduceSum(d, a); }
+};
+
+// min and max start from the first element, which is also a neutral pad
+template <typename T>
+struct MinReduce {
+    T first;
+    template <class D> VFromD<D> pad(D d) const { return Set(d, first); }
+    template <class D> VFromD<D> init(D d) const { return Set(d, first); }
+    template <class V> V step(V a, V v) const { return Min(a, v); }
+    template <class V> V merge(V a, V b) const { return Min(a, b); }
+    T merge(T a, T b) const { return std::min(a, b); }
+    template <class D, class V> T fold(D d, V a) const { return ReduceMin(d, a); }
+};
+
+template <typename T>
+struct MaxReduce {
+    T first;
+    template <class D> VFromD<D> pad(D d) const { return Set(d, first); }
+    template <class D> VFromD<D> init(D d) const { return Set(d, first); }
+    template <class V> V step(V a, V v) const { return Max(a, v); }
+    template <class V> V merge(V a, V b) const { return Max(a, b); }
+    T merge(T a, T b) const { return std::max(a, b); }
+    template <class D, class V> T fold(D d, V a) const { return ReduceMax(d, a); }
+};
+
+template <typename T>
+struct ProdReduce {
+    template <class D> VFromD<D> pad(D d) const { return Set(d, T(1)); }
+    template <class D> VFromD<D> init(D d) const { return Set(d, T(1)); }
+    template <class V> V step(V a, V v) const { return Mul(a, v); }
+    template <class V> V merge(V a, V b) const { return Mul(a, b); }
+    T merge(T a, T b) const { return a * b; }
+    // no product-of-lanes op, so the lanes are multiplied out
+    template <class D, class V> T fold(D d, V a) const {
+        HWY_ALIGN T lanes[HWY_MAX_BYTES / sizeof(T)];
+        Store(a, d, lanes);
+        T p = T(1);
+        for (size_t i = 0; i < Lanes(d); ++i) p *= lanes[i];
+        return p;
     }
-    
-    for (; i + L <= N; i += L) {
-        acc = Add(acc, Load(d, A + i));
+};
+
+// sum of squared deviations from mu; padded lanes load mu and add nothing
+template <typename T>
+struct SqDevReduce {
+    T mu;
+    template <class D> VFromD<D> pad(D d) const { return Set(d, mu); }
+    template <class D> VFromD<D> init(D d) const { return Zero(d); }
+    template <class V> V step(V a, V v) const {
+        const auto c = Sub(v, Set(DFromV<V>(), mu));
+        return MulAdd(c, c, a);
     }
-    
-    T total = GetLane(SumOfLanes(d, acc));
-    for (; i < N; ++i) total += A[i];
-    return total;
-}
+    template <class V> V merge(V a, V b) const { return Add(a, b); }
+    T merge(T a, T b) const { return a + b; }
+    template <class D, class V> T fold(D d, V a) const { return ReduceSum(d, a); }
+};
 
+// norm reductions; all pad with zero, which adds nothing to a sum and
+// cannot exceed an absolute value
 template <typename T>
-T reduce_min(nb::ndarray<T, nb::c_contig> a) {
-    const T* A = a.data();
-    size_t N = a.shape(0);
-    
-    if (N == 0) throw std::runtime_error("reduce_min: zero-length input");
-    if (N == 1) return A[0];
-    
-    const ScalableTag<T> d;
-    size_t L = Lanes(d);
-    
-    if (N < L) {
-        T min_val = A[0];
-        for (size_t j = 1; j < N; j++) {
-            min_val = std::min(min_val, A[j]);
-        }
-        return min_val;
+struct AbsSumReduce : SumReduce<T> {
+    template <class V> V step(V a, V v) const { return Add(a, Abs(v)); }
+};
+
+// a NaN element makes the result NaN, as in numpy
+template <typename T>
+struct AbsMaxReduce {
+    template <class D> VFromD<D> pad(D d) const { return Zero(d); }
+    template <class D> VFromD<D> init(D d) const { return Zero(d); }
+    template <class V> V step(V a, V v) const { return nan_max(a, Abs(v)); }
+    template <class V> V merge(V a, V b) const { return nan_max(a, b); }
+    T merge(T a, T b) const { return nan_max(a, b); }
+    template <class D, class V> T fold(D d, V a) const {
+        return AllFalse(d, IsNaN(a)) ? ReduceMax(d, a) : std::numeric_limits<T>::quiet_NaN();
     }
-    
-    auto acc = Load(d, A);
-    size_t i = L; 
-    
-    for (; i + L <= N; i += L) {
-        acc = Min(acc, Load(d, A + i));
+};
+
+template <typename T>
+struct SqSumReduce : SumReduce<T> {
+    template <class V> V step(V a, V v) const { return MulAdd(v, v, a); }
+};
+
+// sum of (v / scale)^2; divides rather than multiplying by 1 / scale,
+// which overflows for a subnormal scale
+template <typename T>
+struct ScaledSqReduce : SumReduce<T> {
+    T scale;
+    explicit ScaledSqReduce(T s) : scale(s) {}
+    template <class V> V step(V a, V v) const {
+        const auto c = Div(v, Set(DFromV<V>(), scale));
+        return MulAdd(c, c, a);
     }
-    
-    T m = GetLane(MinOfLanes(d, acc));
-    for (; i < N; ++i) m = std::min(m, A[i]);
-    return m;
+};
+
+// Euclidean norm that neither overflows nor loses tiny inputs to
+// underflow. The plain sum of squares runs first, at the speed of a sum;
+// only when it comes out infinite or below min / epsilon (where squared
+// elements may have flushed to zero) is the input read twice more: once
+// for the largest magnitude m, then for m * sqrt(sum((x / m)^2)), every
+// term of which lies in [0, 1]. reduce(r) runs reducer r over the input.
+template <typename T, class Reduce>
+T l2_norm(const Reduce& reduce) {
+    const T s = reduce(SqSumReduce<T>{});
+    if (std::isnan(s)) return s;
+    const T tiny = std::numeric_limits<T>::min() / std::numeric_limits<T>::epsilon();
+    if (std::isfinite(s) && s >= tiny) return std::sqrt(s);
+    const T m = reduce(AbsMaxReduce<T>{});
+    if (m == T(0) || !std::isfinite(m)) return m;
+    return m * std::sqrt(reduce(ScaledSqReduce<T>(m)));
 }
 
+// ord-norm of A[0, N) for ord 1, 2 or inf, threaded through reduce_n
 template <typename T>
-T reduce_max(nb::ndarray<T, nb::c_contig> a) {
-    const T* A = a.data();
-    size_t N = a.shape(0);
-    
+T norm_n(const T* A, size_t N, double ord) {
+    if (ord == 1) return reduce_n(A, N, AbsSumReduce<T>{});
+    if (ord == 2) return l2_norm<T>([&](const auto& r) { return reduce_n(A, N, r); });
+    if (std::isinf(ord) && ord > 0) return reduce_n(A, N, AbsMaxReduce<T>{});
+    throw std::runtime_error("norm: ord must be 1, 2 or inf");
+}
+
+// the same on the calling thread, for callers that split rows themselves
+template <typename T>
+T norm_range(const T* A, size_t N, double ord) {
+    if (ord == 1) return reduce_range(A, 0, N, AbsSumReduce<T>{});
+    if (ord == 2) return l2_norm<T>([&](const auto& r) { return reduce_range(A, 0, N, r); });
+    if (std::isinf(ord) && ord > 0) return reduce_range(A, 0, N, AbsMaxReduce<T>{});
+    throw std::runtime_error("norm: ord must be 1, 2 or inf");
+}
+
+template <typename T>
+T reduce_sum_n(const T* A, size_t N) {
+    if (N == 0) throw std::runtime_error("reduce_sum: zero-length input");
+    return reduce_n(A, N, SumReduce<T>{});
+}
+
+template <typename T>
+T reduce_min_n(const T* A, size_t N) {
+    if (N == 0) throw std::runtime_error("reduce_min: zero-length input");
+    return reduce_n(A, N, MinReduce<T>{ A[0] });
+}
+
+template <typename T>
+T reduce_max_n(const T* A, size_t N) {
     if (N == 0) throw std::runtime_error("reduce_max: zero-length input");
-    if (N == 1) return A[0]; 
-    
-    const ScalableTag<T> d;
-    size_t L = Lanes(d);
-    
-    if (N < L) {
-        T max_val = A[0];
-        for (size_t j = 1; j < N; j++) {
-            max_val = std::max(max_val, A[j]);
-        }
-        return max_val;
-    }
-    
-    auto acc = Load(d, A); 
-    size_t i = L; 
-    
-    for (; i + L <= N; i += L) {
-        acc = Max(acc, Load(d, A + i));
-    }
-    
-    T m = GetLane(MaxOfLanes(d, acc));
-    for (; i < N; ++i) m = std::max(m, A[i]);
-    return m;
+    return reduce_n(A, N, MaxReduce<T>{ A[0] });
 }
 
 template <typename T>
-T reduce_prod(nb::ndarray<T, nb::c_contig> a) {
-    const T* A = a.data();
-    size_t N = a.shape(0);
-    
+T reduce_prod_n(const T* A, size_t N) {
     if (N == 0) throw std::runtime_error("reduce_prod: zero-length input");
-    if (N == 1) return A[0]; 
-    
-    const ScalableTag<T> d;
-    size_t L = Lanes(d);
-    
-    if (N < L) {
-        T prod = T(1);
-        for (size_t j = 0; j < N; j++) {
-            prod *= A[j];
-        }
-        return prod;
-    }
-    
-    auto acc = Set(d, T(1));
-    size_t i = 0;
-    
-    for (; i + L <= N; i += L) {
-        acc = Mul(acc, Load(d, A + i));
-    }
-    
-    T product = GetLane(SumOfLanes(d, acc));
-    for (; i < N; ++i) product *= A[i];
-    return product;
+    return reduce_n(A, N, ProdReduce<T>{});
 }
 
-
 template <typename T>
-T reduce_mean(nb::ndarray<T, nb::c_contig> a) {
-    size_t N = a.shape(0);
-    return reduce_sum<T>(a) / T(N);
+T reduce_mean_n(const T* A, size_t N) {
+    return reduce_sum_n<T>(A, N) / T(N);
 }
 
 template <typename T>
-T reduce_var(nb::ndarray<T, nb::c_contig> a) {
-    size_t N = a.shape(0);
-    T mu = reduce_mean<T>(a);
-    const T* A = a.data();
-    T var = T(0);
-    for (size_t i = 0; i < N; ++i) {
-        T d = A[i] - mu;
-        var += d * d;
-    }
-    return var / T(N);
+T reduce_var_n(const T* A, size_t N) {
+    const T mu = reduce_mean_n<T>(A, N);
+    return reduce_n(A, N, SqDevReduce<T>{ mu }) / T(N);
 }
 
 template <typename T>
-T reduce_std(nb::ndarray<T, nb::c_contig> a) {
-    return std::sqrt(reduce_var<T>(a));
+T reduce_std_n(const T* A, size_t N) {
+    return std::sqrt(reduce_var_n<T>(A, N));
 }
 
 
 template <typename T>
-bool reduce_any(nb::ndarray<T, nb::c_contig> a) {
-    const T* A = a.data();
-    size_t N = a.shape(0);
+bool reduce_any_n(const T* A, size_t N) {
     for (size_t i = 0; i < N; ++i) if (A[i] != T(0)) return true;
     return false;
 }
 
 template <typename T>
-bool reduce_all(nb::ndarray<T, nb::c_contig> a) {
-    const T* A = a.data();
-    size_t N = a.shape(0);
+bool reduce_all_n(const T* A, size_t N) {
     for (size_t i = 0; i < N; ++i) if (A[i] == T(0)) return false;
     return true;
 }
 
 
 template <typename T>
-size_t argmax(nb::ndarray<T, nb::c_contig> a) {
-    const T* A = a.data();
-    size_t N = a.shape(0);
+size_t argmax_n(const T* A, size_t N) {
     if (N == 0) throw std::runtime_error("argmax: zero-length input");
     size_t idx = 0;
     T best = A[0];
@@ -198,9 +225,7 @@ size_t argmax(nb::ndarray<T, nb::c_contig> a) {
 }
 
 template <typename T>
-size_t argmin(nb::ndarray<T, nb::c_contig> a) {
-    const T* A = a.data();
-    size_t N = a.shape(0);
+size_t argmin_n(const T* A, size_t N) {
     if (N == 0) throw std::runtime_error("argmin: zero-length input");
     size_t idx = 0;
     T best = A[0];
@@ -211,11 +236,63 @@ size_t argmin(nb::ndarray<T, nb::c_contig> a) {
 }
 
 
+template <typename T>
+void cumsum_n(const T* A, T* C, size_t N) {
+    T acc = T(0);
+    for (size_t i = 0; i < N; ++i) {
+        acc += A[i];
+        C[i] = acc;
+    }
+}
+
+template <typename T>
+void cumprod_n(const T* A, T* C, size_t N) {
+    T acc = T(1);
+    for (size_t i = 0; i < N; ++i) {
+        acc *= A[i];
+        C[i] = acc;
+    }
+}
+
+// ndarray entry points over the raw-buffer kernels above
+
+template <typename T>
+T reduce_sum(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return reduce_sum_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+T reduce_min(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return reduce_min_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+T reduce_max(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return reduce_max_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+T reduce_prod(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return reduce_prod_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+T reduce_mean(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return reduce_mean_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+T reduce_var(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return reduce_var_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+T reduce_std(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return reduce_std_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+bool reduce_any(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return reduce_any_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+bool reduce_all(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return reduce_all_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+size_t argmax(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return argmax_n<T>(a.data(), a.shape(0)); }
+
+template <typename T>
+size_t argmin(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) { return argmin_n<T>(a.data(), a.shape(0)); }
+
 template <typename T>
 nb::ndarray<nb::numpy, T, nb::ndim<1>>
-cumsum(nb::ndarray<T, nb::c_contig> a) {
+cumsum(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) {
     size_t N = a.shape(0);
-    const T* A = a.data();
     size_t bytes = N * sizeof(T);
     void* raw = aligned_alloc64(bytes);
     T* C = static_cast<T*>(raw);
@@ -224,19 +301,14 @@ cumsum(nb::ndarray<T, nb::c_contig> a) {
 #else
     nb::capsule deleter(C, [](void* p) noexcept { free(p); });
 #endif
-    T acc = T(0);
-    for (size_t i = 0; i < N; ++i) {
-        acc += A[i];
-        C[i] = acc;
-    }
+    cumsum_n<T>(a.data(), C, N);
     return { C, { N }, deleter };
 }
 
 template <typename T>
 nb::ndarray<nb::numpy, T, nb::ndim<1>>
-cumprod(nb::ndarray<T, nb::c_contig> a) {
+cumprod(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) {
     size_t N = a.shape(0);
-    const T* A = a.data();
     size_t bytes = N * sizeof(T);
     void* raw = aligned_alloc64(bytes);
     T* C = static_cast<T*>(raw);
@@ -245,11 +317,7 @@ cumprod(nb::ndarray<T, nb::c_contig> a) {
 #else
     nb::capsule deleter(C, [](void* p) noexcept { free(p); });
 #endif
-    T acc = T(1);
-    for (size_t i = 0; i < N; ++i) {
-        acc *= A[i];
-        C[i] = acc;
-    }
+    cumprod_n<T>(a.data(), C, N);
     return { C, { N }, deleter };
 }
 
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#include "../alloc.hpp"
+#include "driver.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// An operand of the broadcasting ops: an array, or a scalar repeated
+// across it. Array operands must share one shape, which the result takes.
+// Python ints get their own alternative: T rejects them in nanobind's
+// exact first pass, and the converting pass would then reach the float32
+// overload first and downcast float64 arrays.
+template <typename T>
+using Operand = std::variant<nb::ndarray<T, nb::c_contig, nb::device::cpu>, nb::int_, T>;
+
+using BoolArray = nb::ndarray<bool, nb::c_contig, nb::device::cpu>;
+
+// calls k with each operand as a driver input (array data or a Splat),
+// so every mix of arrays and scalars gets its own branch-free loop
+template <typename T, class K>
+void visit_operands(const K& k) { k(); }
+
+template <typename T, class K, class First, class... Rest>
+void visit_operands(const K& k, const First& op, const Rest&... rest) {
+    if constexpr (std::is_same_v<First, BoolArray>) {
+        const bool* p = op.data();
+        visit_operands<T>([&](const auto&... in) { k(p, in...); }, rest...);
+    } else if (const T* s = std::get_if<T>(&op)) {
+        const Splat<T> splat{ *s };
+        visit_operands<T>([&](const auto&... in) { k(splat, in...); }, rest...);
+    } else if (const nb::int_* i = std::get_if<nb::int_>(&op)) {
+        const Splat<T> splat{ static_cast<T>(nb::cast<double>(*i)) };
+        visit_operands<T>([&](const auto&... in) { k(splat, in...); }, rest...);
+    } else {
+        const T* p = std::get<0>(op).data();
+        visit_operands<T>([&](const auto&... in) { k(p, in...); }, rest...);
+    }
+}
+
+// records the shape of array operands; throws when two differ
+template <class A>
+void match_shape(const char* name, std::vector<size_t>& shape, bool& found, const A& a) {
+    std::vector<size_t> s(a.ndim());
+    for (size_t i = 0; i < a.ndim(); ++i) s[i] = a.shape(i);
+    if (found && s != shape) throw std::runtime_error(std::string(name) + ": shape mismatch");
+    shape = s;
+    found = true;
+}
+
+inline void operand_shape(const char* name, std::vector<size_t>& shape, bool& found, const BoolArray& m) {
+    match_shape(name, shape, found, m);
+}
+
+template <typename T>
+void operand_shape(const char* name, std::vector<size_t>& shape, bool& found, const Operand<T>& op) {
+    if (const auto* a = std::get_if<0>(&op)) match_shape(name, shape, found, *a);
+}
+
+// C = f(d, ops...) elementwise with scalars broadcast
+template <typename T, class F, class... Ops>
+nb::ndarray<nb::numpy, T> broadcast(const char* name, const F& f, const Ops&... ops) {
+    std::vector<size_t> shape;
+    bool found = false;
+    (operand_shape(name, shape, found, ops), ...);
+    if (!found) throw std::runtime_error(std::string(name) + ": needs at least one array operand");
+    size_t N = 1;
+    for (size_t s : shape) N *= s;
+
+    T* C = static_cast<T*>(aligned_alloc64(std::max<size_t>(N, 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+
+    visit_operands<T>([&](const auto&... in) { elementwise_n(C, N, f, in...); }, ops...);
+
+    return nb::ndarray<nb::numpy, T>(C, shape.size(), shape.data(), deleter);
+}
+
+// a * b + c with one rounding
+template <typename T>
+nb::ndarray<nb::numpy, T> fma(const Operand<T>& a, const Operand<T>& b, const Operand<T>& c) {
+    return broadcast<T>("fma", [](auto, auto x, auto y, auto z) { return MulAdd(x, y, z); }, a, b, c);
+}
+
+// min(max(x, lo), hi)
+template <typename T>
+nb::ndarray<nb::numpy, T> clip(const Operand<T>& x, const Operand<T>& lo, const Operand<T>& hi) {
+    return broadcast<T>("clip", [](auto, auto v, auto l, auto h) { return nan_min(nan_max(v, l), h); },
+                        x, lo, hi);
+}
+
+// a where mask is set, else b
+template <typename T>
+nb::ndarray<nb::numpy, T> where(const BoolArray& mask, const Operand<T>& a, const Operand<T>& b) {
+    return broadcast<T>("where", [](auto, auto m, auto x, auto y) { return IfThenElse(m, x, y); },
+                        mask, a, b);
+}
+
+// a + t * (b - a)
+template <typename T>
+nb::ndarray<nb::numpy, T> lerp(const Operand<T>& a, const Operand<T>& b, const Operand<T>& t) {
+    return broadcast<T>("lerp", [](auto, auto x, auto y, auto w) { return MulAdd(w, Sub(y, x), x); },
+                        a, b, t);
+}
+
+template <typename T>
+nb::ndarray<nb::numpy, T> maximum(const Operand<T>& a, const Operand<T>& b) {
+    return broadcast<T>("maximum", [](auto, auto x, auto y) { return nan_max(x, y); }, a, b);
+}
+
+template <typename T>
+nb::ndarray<nb::numpy, T> minimum(const Operand<T>& a, const Operand<T>& b) {
+    return broadcast<T>("minimum", [](auto, auto x, auto y) { return nan_min(x, y); }, a, b);
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
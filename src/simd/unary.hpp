@@ -9,6 +9,8 @@
 #include <hwy/contrib/math/math-inl.h>
 
 #include "../alloc.hpp"
+#include "approx.hpp"
+#include "driver.hpp"
 
 namespace nb = nanobind;
 
@@ -17,8 +19,23 @@ namespace hwy {
 namespace HWY_NAMESPACE {
 namespace capnhook {
 
+// C[i] = op(A[i]) on raw buffers; A may have any alignment. Ops with
+// precision tiers run the kernel of the current precision::mode().
+template <typename T, typename Op, Stores S = Stores::Auto>
+void unary_n(const T* A, T* C, size_t N) {
+    Op op;
+    if constexpr (Op::kTiered) {
+        precision::dispatch(precision::mode(), [&](auto p) {
+            constexpr Mode P = decltype(p)::value;
+            elementwise_n<T, S>(C, N, [&](auto d, auto a) { return op.template at<P>(d, a); }, A);
+        });
+    } else {
+        elementwise_n<T, S>(C, N, [&](auto d, auto a) { return op(d, a); }, A);
+    }
+}
+
 template <typename T, typename Op>
-nb::ndarray<nb::numpy, T, nb::ndim<1>> unary(nb::ndarray<T, nb::c_contig> a) {
+nb::ndarray<nb::numpy, T, nb::ndim<1>> unary(nb::ndarray<T, nb::c_contig, nb::device::cpu> a) {
     const size_t N = a.shape(0);
     const T* A = a.data();
 
@@ -32,48 +49,42 @@ nb::ndarray<nb::numpy, T, nb::ndim<1>> unary(nb::ndarray<T, nb::c_contig> a) {
     nb::capsule deleter(C, [](void* p) noexcept { free(p); });
 #endif
 
-    const ScalableTag<T> d;
-    Op op;
-    size_t i = 0;
-    const size_t L = Lanes(d);
-
-    for (; i + L <= N; i += L) {
-        auto v = Load(d, A + i);
-        Store(op(d, v), d, C + i);
-    }
-
-    for (; i < N; ++i) {
-        C[i] = op(A[i]);
-    }
+    unary_n<T, Op>(A, C, N);
 
     return { C, { N }, deleter };
 }
 
-#define DEFINE_SIMD_UNARY_OP(Symbol, expr_scalar, expr_simd)        \
+// expr_simd may use the precision tier P; tiered says whether it does
+#define DEFINE_SIMD_UNARY_OP(Symbol, tiered, expr_scalar, expr_simd) \
 struct Symbol##Op {                                                  \
+    static constexpr bool kTiered = tiered;                          \
+    template <Mode P, class D, class V>                              \
+    HWY_INLINE V at(D d, V v) const {                                \
+        return expr_simd;                                           \
+    }                                                                \
     template <class D, class V>                                     \
     HWY_INLINE V operator()(D d, V v) const {                       \
-        return expr_simd;                                           \
+        return at<Mode::Accurate>(d, v);                             \
     }                                                                \
     HWY_INLINE float operator()(float x) const { return (expr_scalar); } \
     HWY_INLINE double operator()(double x) const { return (expr_scalar); } \
 };                                                                   \
 inline nb::ndarray<nb::numpy, float, nb::ndim<1>>                     \
-Symbol(nb::ndarray<float, nb::c_contig> a) {                         \
+Symbol(nb::ndarray<float, nb::c_contig, nb::device::cpu> a) {                         \
     return unary<float, Symbol##Op>(a);                              \
 }                                                                    \
 inline nb::ndarray<nb::numpy, double, nb::ndim<1>>                    \
-Symbol(nb::ndarray<double, nb::c_contig> a) {                        \
+Symbol(nb::ndarray<double, nb::c_contig, nb::device::cpu> a) {                        \
     return unary<double, Symbol##Op>(a);                             \
 }
 
-DEFINE_SIMD_UNARY_OP(exp, std::exp(x), hwy::HWY_NAMESPACE::Exp(d, v))
-DEFINE_SIMD_UNARY_OP(log, std::log(x), hwy::HWY_NAMESPACE::Log(d, v))
-DEFINE_SIMD_UNARY_OP(sqrt, std::sqrt(x), hwy::HWY_NAMESPACE::Sqrt(v))
-DEFINE_SIMD_UNARY_OP(sin, std::sin(x), hwy::HWY_NAMESPACE::Sin(d, v))
-DEFINE_SIMD_UNARY_OP(cos, std::cos(x), hwy::HWY_NAMESPACE::Cos(d, v))
-DEFINE_SIMD_UNARY_OP(asin, std::asin(x), hwy::HWY_NAMESPACE::Asin(d, v))
-DEFINE_SIMD_UNARY_OP(acos, std::acos(x), hwy::HWY_NAMESPACE::Acos(d, v))
+DEFINE_SIMD_UNARY_OP(exp, true, std::exp(x), exp_p<P>(d, v))
+DEFINE_SIMD_UNARY_OP(log, true, std::log(x), log_p<P>(d, v))
+DEFINE_SIMD_UNARY_OP(sqrt, false, std::sqrt(x), hwy::HWY_NAMESPACE::Sqrt(v))
+DEFINE_SIMD_UNARY_OP(sin, true, std::sin(x), sin_p<P>(d, v))
+DEFINE_SIMD_UNARY_OP(cos, true, std::cos(x), cos_p<P>(d, v))
+DEFINE_SIMD_UNARY_OP(asin, false, std::asin(x), hwy::HWY_NAMESPACE::Asin(d, v))
+DEFINE_SIMD_UNARY_OP(acos, false, std::acos(x), hwy::HWY_NAMESPACE::Acos(d, v))
 
 }  // capnhook
 }  // HWY_NAMESPACE
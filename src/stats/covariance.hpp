@@ -0,0 +1,282 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+#include "../simd/linalg.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// elements per centred chunk handed to syrk; bounds the scratch to a few MB
+// while keeping the rank-k update long enough to run at gemm speed
+constexpr size_t kCovChunkElems = size_t(1) << 19;
+
+// mu[j] = mean of column j of a row-major (N, D) buffer, from per-thread
+// SIMD partial sums
+template <typename T>
+void col_means(const T* X, size_t N, size_t D, T* mu) {
+    const size_t nt = parallel_threads(N, 1024);
+    std::vector<T> partial(nt * D, T(0));
+    parallel_chunks(N, nt, [&](size_t tid, size_t b, size_t e) {
+        const ScalableTag<T> d;
+        const size_t L = Lanes(d);
+        T* acc = partial.data() + tid * D;
+        for (size_t i = b; i < e; ++i) {
+            const T* row = X + i * D;
+            size_t j = 0;
+            for (; j + L <= D; j += L)
+                StoreU(Add(LoadU(d, acc + j), LoadU(d, row + j)), d, acc + j);
+            for (; j < D; ++j) acc[j] += row[j];
+        }
+    });
+    for (size_t j = 0; j < D; ++j) {
+        T s = T(0);
+        for (size_t t = 0; t < nt; ++t) s += partial[t * D + j];
+        mu[j] = s / T(N);
+    }
+}
+
+// mu[i] = mean of row i of a row-major (D, N) buffer
+template <typename T>
+void row_means(const T* X, size_t D, size_t N, T* mu) {
+    parallel_for(D, std::max<size_t>(1, (1 << 16) / std::max<size_t>(N, 1)),
+                 [&](size_t, size_t b, size_t e) {
+        const ScalableTag<T> d;
+        const size_t L = Lanes(d);
+        for (size_t i = b; i < e; ++i) {
+            const T* row = X + i * N;
+            auto acc = Zero(d);
+            size_t j = 0;
+            for (; j + L <= N; j += L) acc = Add(acc, LoadU(d, row + j));
+            T s = ReduceSum(d, acc);
+            for (; j < N; ++j) s += row[j];
+            mu[i] = s / T(N);
+        }
+    });
+}
+
+// out[0:n) = x[0:n) - mu[0:n)
+template <typename T>
+void sub_n(const T* x, const T* mu, size_t n, T* out) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    size_t j = 0;
+    for (; j + L <= n; j += L)
+        StoreU(Sub(LoadU(d, x + j), LoadU(d, mu + j)), d, out + j);
+    for (; j < n; ++j) out[j] = x[j] - mu[j];
+}
+
+// Upper triangle of the (D, D) co-moment sum_k (x_k - mu)(x_k - mu)^T.
+// Observations are rows of an (N, D) buffer, or columns of a (D, N) one
+// when rowvar. X is never centred as a whole: each chunk is centred into
+// scratch and fed to syrk, accumulating into C.
+template <typename T>
+void centred_syrk(const T* X, size_t N, size_t D, bool rowvar, const T* mu, T* C) {
+    if (N == 0) {
+        std::fill(C, C + D * D, T(0));
+        return;
+    }
+    const size_t chunk = std::min(N, std::max<size_t>(64, kCovChunkElems / std::max<size_t>(D, 1)));
+    std::vector<T> buf(chunk * D);
+    for (size_t c0 = 0; c0 < N; c0 += chunk) {
+        const size_t k = std::min(chunk, N - c0);
+        const T beta = c0 == 0 ? T(0) : T(1);
+        if (!rowvar) {
+            parallel_for(k, 256, [&](size_t, size_t b, size_t e) {
+                for (size_t i = b; i < e; ++i)
+                    sub_n(X + (c0 + i) * D, mu, D, buf.data() + i * D);
+            });
+            syrk<T>(true, D, k, T(1), buf.data(), D, beta, C, D);
+        } else {
+            parallel_for(D, std::max<size_t>(1, 4096 / k), [&](size_t, size_t b, size_t e) {
+                const ScalableTag<T> d;
+                const size_t L = Lanes(d);
+                for (size_t i = b; i < e; ++i) {
+                    const T* src = X + i * N + c0;
+                    T* dst = buf.data() + i * k;
+                    const auto vm = Set(d, mu[i]);
+                    size_t j = 0;
+                    for (; j + L <= k; j += L) StoreU(Sub(LoadU(d, src + j), vm), d, dst + j);
+                    for (; j < k; ++j) dst[j] = src[j] - mu[i];
+                }
+            });
+            syrk<T>(false, D, k, T(1), buf.data(), k, beta, C, D);
+        }
+    }
+}
+
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<2>>
+cov(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> x, bool rowvar, size_t ddof) {
+    const size_t D = rowvar ? x.shape(0) : x.shape(1);
+    const size_t N = rowvar ? x.shape(1) : x.shape(0);
+    if (N <= ddof) throw std::runtime_error("cov: need more observations than ddof");
+    const T* X = x.data();
+
+    T* C = static_cast<T*>(aligned_alloc64(D * D * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+
+    {
+        nb::gil_scoped_release release;
+        std::vector<T> mu(D);
+        if (rowvar) row_means(X, D, N, mu.data());
+        else col_means(X, N, D, mu.data());
+        centred_syrk(X, N, D, rowvar, mu.data(), C);
+        const T s = T(1) / T(N - ddof);
+        for (size_t i = 0; i < D; ++i)
+            for (size_t j = i; j < D; ++j) C[i * D + j] *= s;
+        mirror_upper(C, D);
+    }
+
+    return { C, { D, D }, deleter };
+}
+
+// scales a symmetric (D, D) covariance to correlations in place, clipping
+// rounding excursions to [-1, 1]
+template <typename T>
+void cov_to_corr(T* C, size_t D) {
+    std::vector<T> inv(D);
+    for (size_t i = 0; i < D; ++i) inv[i] = T(1) / std::sqrt(C[i * D + i]);
+    parallel_for(D, 64, [&](size_t, size_t b, size_t e) {
+        const ScalableTag<T> d;
+        const size_t L = Lanes(d);
+        const auto lo = Set(d, T(-1)), hi = Set(d, T(1));
+        for (size_t i = b; i < e; ++i) {
+            T* row = C + i * D;
+            const auto si = Set(d, inv[i]);
+            size_t j = 0;
+            for (; j + L <= D; j += L) {
+                auto r = Mul(Mul(LoadU(d, row + j), si), LoadU(d, inv.data() + j));
+                StoreU(Min(Max(r, lo), hi), d, row + j);
+            }
+            for (; j < D; ++j) row[j] = std::min(T(1), std::max(T(-1), row[j] * inv[i] * inv[j]));
+        }
+    });
+}
+
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<2>>
+corrcoef(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> x, bool rowvar) {
+    auto c = cov(x, rowvar, 1);
+    {
+        nb::gil_scoped_release release;
+        cov_to_corr(c.data(), c.shape(0));
+    }
+    return c;
+}
+
+// Streaming state for covariance over row chunks: (count, mean, co-moment).
+// Chunks are combined with the pairwise update of Chan et al., so the
+// result matches the one-shot computation up to rounding.
+template <typename T>
+using CovState = std::tuple<size_t,
+                            nb::ndarray<nb::numpy, T, nb::ndim<1>>,
+                            nb::ndarray<nb::numpy, T, nb::ndim<2>>>;
+
+// the same state as received back from Python
+template <typename T>
+using CovStateIn = std::tuple<size_t,
+                              nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>>,
+                              nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>>>;
+
+// folds the rows of x into state (None starts a new one)
+template <typename T>
+CovState<T> cov_accumulate(nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<2>> x,
+                           std::optional<CovStateIn<T>> state) {
+    const size_t nc = x.shape(0), D = x.shape(1);
+    const size_t na = state ? std::get<0>(*state) : 0;
+    if (state && (std::get<1>(*state).shape(0) != D || std::get<2>(*state).shape(0) != D ||
+                  std::get<2>(*state).shape(1) != D))
+        throw std::runtime_error("cov_accumulate: state does not match the feature dimension");
+
+    T* mu = static_cast<T*>(aligned_alloc64(D * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule mu_deleter(mu, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule mu_deleter(mu, [](void* p) noexcept { free(p); });
+#endif
+    T* M = static_cast<T*>(aligned_alloc64(D * D * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule m_deleter(M, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule m_deleter(M, [](void* p) noexcept { free(p); });
+#endif
+
+    {
+        nb::gil_scoped_release release;
+        // chunk statistics
+        if (nc > 0) col_means(x.data(), nc, D, mu);
+        else std::fill(mu, mu + D, T(0));
+        centred_syrk(x.data(), nc, D, false, mu, M);
+
+        if (na > 0) {
+            const T* mu_a = std::get<1>(*state).data();
+            const T* M_a = std::get<2>(*state).data();
+            const size_t n = na + nc;
+            const T w = T(double(na) * double(nc) / double(n));
+            std::vector<T> delta(D);
+            for (size_t j = 0; j < D; ++j) delta[j] = mu[j] - mu_a[j];
+            parallel_for(D, 64, [&](size_t, size_t b, size_t e) {
+                for (size_t i = b; i < e; ++i)
+                    for (size_t j = i; j < D; ++j)
+                        M[i * D + j] += M_a[i * D + j] + w * delta[i] * delta[j];
+            });
+            for (size_t j = 0; j < D; ++j) mu[j] = mu_a[j] + delta[j] * T(double(nc) / double(n));
+        }
+        mirror_upper(M, D);
+    }
+
+    return { na + nc,
+             nb::ndarray<nb::numpy, T, nb::ndim<1>>(mu, { D }, mu_deleter),
+             nb::ndarray<nb::numpy, T, nb::ndim<2>>(M, { D, D }, m_deleter) };
+}
+
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<2>>
+cov_finalize(CovStateIn<T> state, size_t ddof) {
+    const size_t n = std::get<0>(state);
+    const auto& m = std::get<2>(state);
+    const size_t D = m.shape(0);
+    if (m.shape(1) != D) throw std::runtime_error("cov_finalize: co-moment must be square");
+    if (n <= ddof) throw std::runtime_error("cov_finalize: need more observations than ddof");
+
+    T* C = static_cast<T*>(aligned_alloc64(D * D * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+
+    const T s = T(1) / T(n - ddof);
+    const T* M = m.data();
+    for (size_t i = 0; i < D * D; ++i) C[i] = M[i] * s;
+
+    return { C, { D, D }, deleter };
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
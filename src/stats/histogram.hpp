@@ -0,0 +1,436 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// signed integer of the same width as T, used for SIMD bin indices
+template <typename T>
+using BinIndex = std::conditional_t<sizeof(T) == 4, int32_t, int64_t>;
+
+// idx[i] = clamp(floor((x[i] - lo) * scale), 0, bins - 1); x must be NaN-free
+template <typename T>
+void bin_indices(const T* x, size_t n, T lo, T scale, size_t bins, BinIndex<T>* idx) {
+    const ScalableTag<T> d;
+    const RebindToSigned<ScalableTag<T>> di;
+    const size_t L = Lanes(d);
+    const auto vlo = Set(d, lo), vs = Set(d, scale);
+    const auto zero = Zero(d), top = Set(d, T(bins - 1));
+    size_t i = 0;
+    for (; i + L <= n; i += L) {
+        auto f = Min(Max(Mul(Sub(LoadU(d, x + i), vlo), vs), zero), top);
+        StoreU(ConvertTo(di, f), di, idx + i);
+    }
+    for (; i < n; ++i)
+        idx[i] = BinIndex<T>(std::min(std::max((x[i] - lo) * scale, T(0)), T(bins - 1)));
+}
+
+// Like bin_indices, but elements outside [lo, hi] (and NaN) go to the
+// overflow bin `bins`. When edges are given the SIMD estimate is corrected
+// against them the way numpy does, so counts match np.histogram exactly.
+template <typename T>
+void range_bin_indices(const T* x, size_t n, T lo, T hi, T scale, size_t bins,
+                       const T* edges, BinIndex<T>* idx) {
+    const ScalableTag<T> d;
+    const RebindToSigned<ScalableTag<T>> di;
+    const size_t L = Lanes(d);
+    const auto vlo = Set(d, lo), vhi = Set(d, hi), vs = Set(d, scale);
+    const auto zero = Zero(d), top = Set(d, T(bins - 1)), dump = Set(d, T(bins));
+    size_t i = 0;
+    for (; i + L <= n; i += L) {
+        const auto v = LoadU(d, x + i);
+        const auto in = And(Ge(v, vlo), Le(v, vhi));
+        const auto f = Min(Max(Mul(Sub(v, vlo), vs), zero), top);
+        StoreU(ConvertTo(di, IfThenElse(in, f, dump)), di, idx + i);
+    }
+    for (; i < n; ++i) {
+        const T v = x[i];
+        idx[i] = (v >= lo && v <= hi)
+            ? BinIndex<T>(std::min(std::max((v - lo) * scale, T(0)), T(bins - 1)))
+            : BinIndex<T>(bins);
+    }
+    if (!edges) return;
+    for (size_t t = 0; t < n; ++t) {
+        const BinIndex<T> b = idx[t];
+        if (b == BinIndex<T>(bins)) continue;
+        if (x[t] < edges[b]) idx[t] = b - 1;
+        else if (b + 1 < BinIndex<T>(bins) && x[t] >= edges[b + 1]) idx[t] = b + 1;
+    }
+}
+
+// Bin indices for arbitrary increasing edges by binary search; the last
+// bin is closed on the right as in numpy.
+template <typename T>
+void edge_bin_indices(const T* x, size_t n, const T* edges, size_t bins, BinIndex<T>* idx) {
+    for (size_t t = 0; t < n; ++t) {
+        const T v = x[t];
+        if (!(v >= edges[0] && v <= edges[bins])) { idx[t] = BinIndex<T>(bins); continue; }
+        size_t b = size_t(std::upper_bound(edges, edges + bins + 1, v) - edges) - 1;
+        idx[t] = BinIndex<T>(std::min(b, bins - 1));
+    }
+}
+
+// Generic threaded counter: index_block(begin, m, idx) fills bin indices in
+// [0, nbins] for elements [begin, begin + m), where nbins is an overflow bin
+// that is dropped. Each thread owns kHistCopies interleaved sub-histograms
+// when they fit in L1/L2, so runs of equal indices increment different
+// counters instead of serialising on one store-to-load chain.
+//
+// Private histograms are capped at max(n, kHistBudget) counters in total,
+// so a large bin count on a short input (bincount of one big value) costs
+// no more memory than the output: fewer threads get a private copy, and
+// when not even two fit, threads split the bins instead of the elements,
+// each scanning the whole input and counting only its own range.
+constexpr size_t kHistBlock = 1024;
+constexpr size_t kHistCopies = 4;
+constexpr size_t kHistBudget = size_t(1) << 20;
+
+template <typename W, typename I, typename Wt, typename F>
+std::vector<W> count_bins(size_t n, size_t nbins, const Wt* weights, F&& index_block) {
+    const size_t copies = nbins <= 4096 ? kHistCopies : 1;
+    const size_t stride = nbins + 1;
+    const size_t per_thread = copies * stride;
+    const size_t budget = std::max(n, kHistBudget);
+    const size_t want = parallel_threads(n, 1 << 16);
+    const size_t fit = budget / per_thread;
+
+    if (want > 1 && fit < 2) {
+        // bins split over threads, output shared
+        std::vector<W> out(stride, W(0));
+        parallel_for(nbins, std::max<size_t>(1, nbins / want), [&](size_t, size_t kb, size_t ke) {
+            I idx[kHistBlock];
+            for (size_t i = 0; i < n; i += kHistBlock) {
+                const size_t m = std::min(kHistBlock, n - i);
+                index_block(i, m, idx);
+                for (size_t t = 0; t < m; ++t) {
+                    const size_t k = size_t(idx[t]);
+                    if (k - kb < ke - kb) out[k] += weights ? W(weights[i + t]) : W(1);
+                }
+            }
+        });
+        out.pop_back();
+        return out;
+    }
+
+    // as many private histograms as the budget allows, at least one
+    const size_t nt_cap = std::max<size_t>(1, std::min(want, fit));
+    const size_t grain = std::max<size_t>(size_t(1) << 16, (n + nt_cap - 1) / nt_cap);
+    const size_t nt = parallel_threads(n, grain);
+    std::vector<W> hist(nt * per_thread, W(0));
+
+    parallel_chunks(n, nt, [&](size_t tid, size_t b, size_t e) {
+        I idx[kHistBlock];
+        W* h = hist.data() + tid * per_thread;
+        for (size_t i = b; i < e; i += kHistBlock) {
+            const size_t m = std::min(kHistBlock, e - i);
+            index_block(i, m, idx);
+            if (copies == kHistCopies) {
+                size_t t = 0;
+                for (; t + 4 <= m; t += 4) {
+                    if (weights) {
+                        h[idx[t]] += W(weights[i + t]);
+                        h[stride + idx[t + 1]] += W(weights[i + t + 1]);
+                        h[2 * stride + idx[t + 2]] += W(weights[i + t + 2]);
+                        h[3 * stride + idx[t + 3]] += W(weights[i + t + 3]);
+                    } else {
+                        ++h[idx[t]];
+                        ++h[stride + idx[t + 1]];
+                        ++h[2 * stride + idx[t + 2]];
+                        ++h[3 * stride + idx[t + 3]];
+                    }
+                }
+                for (; t < m; ++t) h[idx[t]] += weights ? W(weights[i + t]) : W(1);
+            } else {
+                for (size_t t = 0; t < m; ++t) h[idx[t]] += weights ? W(weights[i + t]) : W(1);
+            }
+        }
+    });
+
+    // merge, split over bins
+    if (nt * copies == 1) {
+        hist.resize(nbins);
+        return hist;
+    }
+    std::vector<W> out(nbins, W(0));
+    parallel_for(nbins, std::max<size_t>(1, (size_t(1) << 16) / (nt * copies)), [&](size_t, size_t kb, size_t ke) {
+        for (size_t c = 0; c < nt * copies; ++c) {
+            const W* h = hist.data() + c * stride;
+            for (size_t k = kb; k < ke; ++k) out[k] += h[k];
+        }
+    });
+    return out;
+}
+
+template <typename T>
+using Histogram = std::tuple<nb::ndarray<nb::numpy, int64_t, nb::ndim<1>>,
+                             nb::ndarray<nb::numpy, T, nb::ndim<1>>>;
+
+template <typename T>
+Histogram<T> wrap_histogram(const std::vector<uint64_t>& counts, const T* edges, size_t bins) {
+    int64_t* C = static_cast<int64_t*>(aligned_alloc64(bins * sizeof(int64_t)));
+#if defined(_MSC_VER)
+    nb::capsule c_deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule c_deleter(C, [](void* p) noexcept { free(p); });
+#endif
+    T* E = static_cast<T*>(aligned_alloc64((bins + 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule e_deleter(E, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule e_deleter(E, [](void* p) noexcept { free(p); });
+#endif
+    for (size_t k = 0; k < bins; ++k) C[k] = int64_t(counts[k]);
+    std::copy(edges, edges + bins + 1, E);
+
+    return { nb::ndarray<nb::numpy, int64_t, nb::ndim<1>>(C, { bins }, c_deleter),
+             nb::ndarray<nb::numpy, T, nb::ndim<1>>(E, { bins + 1 }, e_deleter) };
+}
+
+// (min, max) ignoring NaN, threaded; (inf, -inf) when every value is NaN
+template <typename T>
+std::pair<T, T> nan_range(const T* x, size_t n) {
+    const size_t nt = parallel_threads(n, 1 << 16);
+    std::vector<T> tmin(nt, std::numeric_limits<T>::infinity());
+    std::vector<T> tmax(nt, -std::numeric_limits<T>::infinity());
+    parallel_chunks(n, nt, [&](size_t tid, size_t b, size_t e) {
+        const ScalableTag<T> d;
+        const size_t L = Lanes(d);
+        auto vmin = Set(d, tmin[tid]), vmax = Set(d, tmax[tid]);
+        size_t i = b;
+        for (; i + L <= e; i += L) {
+            const auto v = LoadU(d, x + i);
+            const auto ok = Eq(v, v);
+            vmin = IfThenElse(ok, Min(vmin, v), vmin);
+            vmax = IfThenElse(ok, Max(vmax, v), vmax);
+        }
+        T mn = ReduceMin(d, vmin), mx = ReduceMax(d, vmax);
+        for (; i < e; ++i) {
+            if (std::isnan(x[i])) continue;
+            mn = std::min(mn, x[i]);
+            mx = std::max(mx, x[i]);
+        }
+        tmin[tid] = mn;
+        tmax[tid] = mx;
+    });
+    return { *std::min_element(tmin.begin(), tmin.end()),
+             *std::max_element(tmax.begin(), tmax.end()) };
+}
+
+// Counts over `bins` equal-width bins spanning `range` (default: the data's
+// min and max); returns (counts, edges) like np.histogram.
+template <typename T>
+Histogram<T> histogram(nb::ndarray<T, nb::c_contig, nb::device::cpu> x, size_t bins,
+                       std::optional<std::pair<double, double>> range) {
+    if (bins == 0) throw std::runtime_error("histogram: bins must be positive");
+    const T* X = x.data();
+    const size_t n = x.size();
+
+    std::vector<T> edges;
+    std::vector<uint64_t> counts;
+    {
+        nb::gil_scoped_release release;
+        double lo, hi;
+        if (range) {
+            lo = range->first;
+            hi = range->second;
+            if (!(lo <= hi) || !std::isfinite(lo) || !std::isfinite(hi))
+                throw std::runtime_error("histogram: range must be finite with min <= max");
+        } else if (n == 0) {
+            lo = 0.0;
+            hi = 1.0;
+        } else {
+            auto r = nan_range(X, n);
+            if (!std::isfinite(r.first) || !std::isfinite(r.second))
+                throw std::runtime_error("histogram: autodetected range is not finite");
+            lo = double(r.first);
+            hi = double(r.second);
+        }
+        if (lo == hi) { lo -= 0.5; hi += 0.5; }
+
+        // edges as np.linspace computes them, in double and then cast
+        edges.resize(bins + 1);
+        const double step = (hi - lo) / double(bins);
+        for (size_t k = 0; k < bins; ++k) edges[k] = T(lo + double(k) * step);
+        edges[bins] = T(hi);
+
+        const T scale = T(double(bins) / (hi - lo));
+        counts = count_bins<uint64_t, BinIndex<T>, T>(n, bins, nullptr,
+            [&](size_t b, size_t m, BinIndex<T>* idx) {
+                range_bin_indices(X + b, m, T(lo), T(hi), scale, bins, edges.data(), idx);
+            });
+    }
+    return wrap_histogram(counts, edges.data(), bins);
+}
+
+// Counts over explicit, increasing bin edges.
+template <typename T>
+Histogram<T> histogram(nb::ndarray<T, nb::c_contig, nb::device::cpu> x,
+                       nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>> edges) {
+    if (edges.shape(0) < 2) throw std::runtime_error("histogram: need at least two edges");
+    const size_t bins = edges.shape(0) - 1;
+    const T* E = edges.data();
+    for (size_t k = 0; k < bins; ++k)
+        if (!(E[k] <= E[k + 1])) throw std::runtime_error("histogram: edges must increase monotonically");
+    const T* X = x.data();
+
+    std::vector<uint64_t> counts;
+    {
+        nb::gil_scoped_release release;
+        counts = count_bins<uint64_t, BinIndex<T>, T>(x.size(), bins, nullptr,
+            [&](size_t b, size_t m, BinIndex<T>* idx) { edge_bin_indices(X + b, m, E, bins, idx); });
+    }
+    return wrap_histogram(counts, E, bins);
+}
+
+// largest value of a non-negative int64 array; throws on negatives
+inline int64_t bincount_max(const int64_t* x, size_t n) {
+    const size_t nt = parallel_threads(n, 1 << 16);
+    std::vector<int64_t> tmax(nt, -1), tmin(nt, 0);
+    parallel_chunks(n, nt, [&](size_t tid, size_t b, size_t e) {
+        int64_t mn = 0, mx = -1;
+        for (size_t i = b; i < e; ++i) {
+            mn = std::min(mn, x[i]);
+            mx = std::max(mx, x[i]);
+        }
+        tmin[tid] = mn;
+        tmax[tid] = mx;
+    });
+    if (*std::min_element(tmin.begin(), tmin.end()) < 0)
+        throw std::runtime_error("bincount: values must be non-negative");
+    return *std::max_element(tmax.begin(), tmax.end());
+}
+
+// occurrences of each value in a non-negative int64 array
+inline nb::ndarray<nb::numpy, int64_t, nb::ndim<1>>
+bincount(nb::ndarray<int64_t, nb::c_contig, nb::device::cpu, nb::ndim<1>> x, size_t minlength) {
+    const int64_t* X = x.data();
+    const size_t n = x.shape(0);
+    size_t bins;
+    std::vector<uint64_t> counts;
+    {
+        nb::gil_scoped_release release;
+        bins = std::max(minlength, size_t(bincount_max(X, n) + 1));
+        counts = count_bins<uint64_t, int64_t, int64_t>(n, bins, nullptr,
+            [&](size_t b, size_t m, int64_t* idx) { std::copy(X + b, X + b + m, idx); });
+    }
+
+    int64_t* C = static_cast<int64_t*>(aligned_alloc64(std::max<size_t>(bins, 1) * sizeof(int64_t)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+    for (size_t k = 0; k < bins; ++k) C[k] = int64_t(counts[k]);
+    return { C, { bins }, deleter };
+}
+
+// weighted occurrences: out[v] = sum of weights[i] where x[i] == v
+template <typename T>
+nb::ndarray<nb::numpy, T, nb::ndim<1>>
+bincount(nb::ndarray<int64_t, nb::c_contig, nb::device::cpu, nb::ndim<1>> x,
+         nb::ndarray<T, nb::c_contig, nb::device::cpu, nb::ndim<1>> weights, size_t minlength) {
+    const int64_t* X = x.data();
+    const size_t n = x.shape(0);
+    if (weights.shape(0) != n) throw std::runtime_error("bincount: weights must match x");
+    size_t bins;
+    std::vector<double> sums;
+    {
+        nb::gil_scoped_release release;
+        bins = std::max(minlength, size_t(bincount_max(X, n) + 1));
+        sums = count_bins<double, int64_t, T>(n, bins, weights.data(),
+            [&](size_t b, size_t m, int64_t* idx) { std::copy(X + b, X + b + m, idx); });
+    }
+
+    T* C = static_cast<T*>(aligned_alloc64(std::max<size_t>(bins, 1) * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+    for (size_t k = 0; k < bins; ++k) C[k] = T(sums[k]);
+    return { C, { bins }, deleter };
+}
+
+// Most frequent value and its count; ties go to the smallest value and NaN
+// is ignored. Integer-valued data with a modest span is counted with the
+// histogram path, anything else falls back to sorting a copy.
+constexpr size_t kModeMaxSpan = size_t(1) << 22;
+
+template <typename T>
+std::tuple<T, int64_t> mode(nb::ndarray<T, nb::c_contig, nb::device::cpu> x) {
+    const T* X = x.data();
+    const size_t n = x.size();
+    nb::gil_scoped_release release;
+    const auto [lo, hi] = nan_range(X, n);
+    if (!(lo <= hi)) throw std::runtime_error("mode: no non-NaN values");
+
+    // integral check, threaded
+    const size_t nt = parallel_threads(n, 1 << 16);
+    std::vector<char> frac(nt, 0);
+    parallel_chunks(n, nt, [&](size_t tid, size_t b, size_t e) {
+        const ScalableTag<T> d;
+        const size_t L = Lanes(d);
+        size_t i = b;
+        for (; i + L <= e; i += L) {
+            const auto v = LoadU(d, X + i);
+            // NaN compares unequal to its floor but is skipped later anyway
+            if (!AllTrue(d, Or(Eq(Floor(v), v), Ne(v, v)))) { frac[tid] = 1; return; }
+        }
+        for (; i < e; ++i)
+            if (!std::isnan(X[i]) && std::floor(X[i]) != X[i]) { frac[tid] = 1; return; }
+    });
+    const bool integral = std::find(frac.begin(), frac.end(), 1) == frac.end();
+
+    if (integral && double(hi) - double(lo) < double(kModeMaxSpan)) {
+        const size_t bins = size_t(double(hi) - double(lo)) + 1;
+        auto counts = count_bins<uint64_t, BinIndex<T>, T>(n, bins, nullptr,
+            [&](size_t b, size_t m, BinIndex<T>* idx) {
+                range_bin_indices(X + b, m, lo, hi, T(1), bins, static_cast<const T*>(nullptr), idx);
+            });
+        const size_t best = size_t(std::max_element(counts.begin(), counts.end()) - counts.begin());
+        return { T(double(lo) + double(best)), int64_t(counts[best]) };
+    }
+
+    std::vector<T> s;
+    s.reserve(n);
+    for (size_t i = 0; i < n; ++i) if (!std::isnan(X[i])) s.push_back(X[i]);
+    std::sort(s.begin(), s.end());
+    T best = s[0];
+    size_t best_n = 0;
+    for (size_t i = 0; i < s.size();) {
+        size_t j = i + 1;
+        while (j < s.size() && s[j] == s[i]) ++j;
+        if (j - i > best_n) { best_n = j - i; best = s[i]; }
+        i = j;
+    }
+    return { best, int64_t(best_n) };
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
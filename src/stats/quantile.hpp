@@ -0,0 +1,416 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#include "../alloc.hpp"
+#include "../parallel.hpp"
+#include "histogram.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// In-place partition of a[0:n) into [< pivot][>= pivot], or [<= pivot]
+// [> pivot] when inclusive; returns the size of the first group. The
+// first and last vectors are held in registers, which leaves a vector of
+// room at each end: every step loads from the side with less room and
+// compresses its lanes to the two write cursors, so a write never reaches
+// data not yet loaded. The gap left in the middle takes the remainder and
+// then the two held vectors.
+template <typename T>
+size_t partition2(T* a, size_t n, T pivot, bool inclusive) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    auto below = [&](T v) { return inclusive ? v <= pivot : v < pivot; };
+    if (n < 2 * L) return size_t(std::partition(a, a + n, below) - a);
+    const auto vp = Set(d, pivot);
+    size_t wl = 0, wr = n;
+    auto put = [&](auto v) {
+        const auto m = inclusive ? Le(v, vp) : Lt(v, vp);
+        const size_t k = CompressBlendedStore(v, m, d, a + wl);
+        wl += k;
+        wr -= L - k;
+        CompressBlendedStore(v, Not(m), d, a + wr);
+    };
+    const auto first = LoadU(d, a), last = LoadU(d, a + n - L);
+    size_t rl = L, rr = n - L;
+    while (rr - rl >= L) {
+        if (rl - wl <= wr - rr) {
+            const auto v = LoadU(d, a + rl);
+            rl += L;
+            put(v);
+        } else {
+            rr -= L;
+            put(LoadU(d, a + rr));
+        }
+    }
+    // fewer than L unread elements remain between the read cursors
+    HWY_ALIGN T rest[HWY_MAX_BYTES / sizeof(T)];
+    std::copy(a + rl, a + rr, rest);
+    for (size_t t = 0; t < rr - rl; ++t) {
+        if (below(rest[t])) a[wl++] = rest[t];
+        else a[--wr] = rest[t];
+    }
+    put(first);
+    put(last);
+    return wl;
+}
+
+// Three-way partition of a[0:n) around pivot into [< pivot][== pivot]
+// [> pivot], in place: the smaller elements split off first, then the
+// equal ones from the rest. Returns the sizes of the first two groups.
+template <typename T>
+void partition3(T* a, size_t n, T pivot, size_t& nl, size_t& ne) {
+    nl = partition2(a, n, pivot, false);
+    ne = partition2(a + nl, n - nl, pivot, true);
+}
+
+template <typename T>
+T median_of_3(T a, T b, T c) {
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+// Writes a[r[j]] of the sorted order to v[j] for ascending ranks r[0:m),
+// partitioning once per level and recursing only into sides that still
+// hold requested ranks. Falls back to sorting when the depth budget runs
+// out (introselect), so the worst case stays O(n log n).
+template <typename T>
+void multiselect(T* a, size_t n, const size_t* r, size_t m, T* v, int budget) {
+    if (m == 0) return;
+    if (n <= 32 || budget == 0) {
+        std::sort(a, a + n);
+        for (size_t j = 0; j < m; ++j) v[j] = a[r[j]];
+        return;
+    }
+    T pivot;
+    if (n < 1024) {
+        pivot = median_of_3(a[0], a[n / 2], a[n - 1]);
+    } else {
+        // ninther
+        const size_t s = n / 8;
+        pivot = median_of_3(median_of_3(a[0], a[s], a[2 * s]),
+                            median_of_3(a[3 * s], a[4 * s], a[5 * s]),
+                            median_of_3(a[6 * s], a[7 * s], a[n - 1]));
+    }
+    size_t nl, ne;
+    partition3(a, n, pivot, nl, ne);
+
+    size_t j = 0;
+    while (j < m && r[j] < nl) ++j;
+    multiselect(a, nl, r, j, v, budget - 1);
+    for (; j < m && r[j] < nl + ne; ++j) v[j] = pivot;
+    if (j < m) {
+        std::vector<size_t> shifted(r + j, r + m);
+        for (auto& x : shifted) x -= nl + ne;
+        multiselect(a + nl + ne, n - nl - ne, shifted.data(), m - j, v + j, budget - 1);
+    }
+}
+
+// linear interpolation between the order statistics around q (n - 1), as
+// numpy's default method
+struct QuantilePlan {
+    std::vector<size_t> ranks;     // sorted, unique
+    std::vector<size_t> lo, hi;    // per quantile, indices into ranks
+    std::vector<double> frac;
+};
+
+inline QuantilePlan plan_quantiles(const std::vector<double>& qs, size_t n) {
+    QuantilePlan p;
+    std::vector<size_t> raw;
+    for (double q : qs) {
+        const double h = q * double(n - 1);
+        const size_t f = std::min(size_t(std::floor(h)), n - 1);
+        raw.push_back(f);
+        raw.push_back(std::min(f + 1, n - 1));
+        p.frac.push_back(h - double(f));
+    }
+    p.ranks = raw;
+    std::sort(p.ranks.begin(), p.ranks.end());
+    p.ranks.erase(std::unique(p.ranks.begin(), p.ranks.end()), p.ranks.end());
+    auto pos = [&](size_t k) {
+        return size_t(std::lower_bound(p.ranks.begin(), p.ranks.end(), k) - p.ranks.begin());
+    };
+    for (size_t j = 0; j < qs.size(); ++j) {
+        p.lo.push_back(pos(raw[2 * j]));
+        p.hi.push_back(pos(raw[2 * j + 1]));
+    }
+    return p;
+}
+
+// true if any element is NaN
+template <typename T>
+bool has_nan(const T* x, size_t n) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    const auto zero = Zero(d), one = Set(d, T(1));
+    auto any = zero;
+    size_t i = 0;
+    for (; i + L <= n; i += L) {
+        const auto v = LoadU(d, x + i);
+        any = IfThenElse(Ne(v, v), one, any);
+    }
+    if (!AllFalse(d, Ne(any, zero))) return true;
+    for (; i < n; ++i) if (std::isnan(x[i])) return true;
+    return false;
+}
+
+// Exact quantiles of work[0:n), which is reordered in place and is the
+// only scratch. out[j * stride].
+template <typename T>
+void quantiles_exact(T* work, size_t n, const std::vector<double>& qs, T* out, size_t stride) {
+    if (has_nan(work, n)) {
+        for (size_t j = 0; j < qs.size(); ++j) out[j * stride] = std::numeric_limits<T>::quiet_NaN();
+        return;
+    }
+    const QuantilePlan p = plan_quantiles(qs, n);
+    std::vector<T> vals(p.ranks.size());
+    int budget = 2;
+    for (size_t m = n; m > 1; m >>= 1) budget += 2;
+    multiselect(work, n, p.ranks.data(), p.ranks.size(), vals.data(), budget);
+    for (size_t j = 0; j < qs.size(); ++j) {
+        const T a = vals[p.lo[j]], b = vals[p.hi[j]];
+        out[j * stride] = a + T(p.frac[j]) * (b - a);
+    }
+}
+
+// Approximate quantiles from two levels of histograms: a coarse pass over
+// [min, max], then a fine histogram inside each coarse bin holding a
+// requested rank. Three streaming reads, O(bins) memory per thread and no
+// copy of x; values are interpolated within the fine bin, so the error is
+// about (max - min) / kQuantileBins^2 once n is large.
+constexpr size_t kQuantileBins = 4096;
+constexpr size_t kQuantileApproxMin = size_t(1) << 20;
+
+template <typename T>
+void quantiles_approx(const T* x, size_t n, const std::vector<double>& qs, T* out, size_t stride) {
+    const size_t k = qs.size();
+    const size_t B = kQuantileBins;
+    constexpr size_t blk = 1024;
+    const size_t nt = parallel_threads(n, 1 << 16);
+
+    // min / max and NaN check
+    std::vector<T> tmin(nt, std::numeric_limits<T>::infinity());
+    std::vector<T> tmax(nt, -std::numeric_limits<T>::infinity());
+    std::vector<char> tnan(nt, 0);
+    parallel_chunks(n, nt, [&](size_t tid, size_t b, size_t e) {
+        const ScalableTag<T> d;
+        const size_t L = Lanes(d);
+        if (has_nan(x + b, e - b)) { tnan[tid] = 1; return; }
+        auto vmin = Set(d, tmin[tid]), vmax = Set(d, tmax[tid]);
+        size_t i = b;
+        for (; i + L <= e; i += L) {
+            const auto v = LoadU(d, x + i);
+            vmin = Min(vmin, v);
+            vmax = Max(vmax, v);
+        }
+        T mn = ReduceMin(d, vmin), mx = ReduceMax(d, vmax);
+        for (; i < e; ++i) { mn = std::min(mn, x[i]); mx = std::max(mx, x[i]); }
+        tmin[tid] = mn;
+        tmax[tid] = mx;
+    });
+    if (std::find(tnan.begin(), tnan.end(), 1) != tnan.end()) {
+        for (size_t j = 0; j < k; ++j) out[j * stride] = std::numeric_limits<T>::quiet_NaN();
+        return;
+    }
+    const T lo = *std::min_element(tmin.begin(), tmin.end());
+    const T hi = *std::max_element(tmax.begin(), tmax.end());
+    if (!(hi > lo)) {
+        for (size_t j = 0; j < k; ++j) out[j * stride] = lo;
+        return;
+    }
+
+    // coarse histogram
+    const T scale = T(B) / (hi - lo);
+    std::vector<uint64_t> coarse(nt * B, 0);
+    parallel_chunks(n, nt, [&](size_t tid, size_t b, size_t e) {
+        BinIndex<T> idx[blk];
+        uint64_t* h = coarse.data() + tid * B;
+        for (size_t i = b; i < e; i += blk) {
+            const size_t m = std::min(blk, e - i);
+            bin_indices(x + i, m, lo, scale, B, idx);
+            for (size_t t = 0; t < m; ++t) ++h[idx[t]];
+        }
+    });
+    for (size_t t = 1; t < nt; ++t)
+        for (size_t c = 0; c < B; ++c) coarse[c] += coarse[t * B + c];
+
+    // coarse bin and the count before it for each quantile position
+    std::vector<double> pos(k);
+    std::vector<BinIndex<T>> cbin(k);
+    std::vector<uint64_t> before(k);
+    for (size_t j = 0; j < k; ++j) {
+        pos[j] = qs[j] * double(n - 1);
+        uint64_t cum = 0;
+        size_t c = 0;
+        while (c + 1 < B && double(cum + coarse[c]) <= pos[j]) cum += coarse[c++];
+        cbin[j] = BinIndex<T>(c);
+        before[j] = cum;
+    }
+
+    // fine histograms inside the selected coarse bins
+    const T cw = (hi - lo) / T(B);
+    std::vector<uint64_t> fine(nt * k * B, 0);
+    parallel_chunks(n, nt, [&](size_t tid, size_t b, size_t e) {
+        BinIndex<T> idx[blk];
+        uint64_t* h = fine.data() + tid * k * B;
+        for (size_t i = b; i < e; i += blk) {
+            const size_t m = std::min(blk, e - i);
+            bin_indices(x + i, m, lo, scale, B, idx);
+            for (size_t t = 0; t < m; ++t) {
+                for (size_t j = 0; j < k; ++j) {
+                    if (idx[t] != cbin[j]) continue;
+                    const double f = (double(x[i + t]) - (double(lo) + double(cbin[j]) * double(cw)))
+                                     * double(scale) * double(B);
+                    ++h[j * B + size_t(std::min(std::max(f, 0.0), double(B - 1)))];
+                }
+            }
+        }
+    });
+    for (size_t t = 1; t < nt; ++t)
+        for (size_t c = 0; c < k * B; ++c) fine[c] += fine[t * k * B + c];
+
+    for (size_t j = 0; j < k; ++j) {
+        const uint64_t* h = fine.data() + j * B;
+        double cum = double(before[j]);
+        size_t f = 0;
+        while (f + 1 < B && cum + double(h[f]) <= pos[j]) cum += double(h[f++]);
+        const double fw = double(cw) / double(B);
+        const double base = double(lo) + double(cbin[j]) * double(cw) + double(f) * fw;
+        const double inside = h[f] ? (pos[j] - cum + 0.5) / double(h[f]) : 0.5;
+        const double v = base + fw * std::min(1.0, std::max(0.0, inside));
+        out[j * stride] = T(std::min(double(hi), std::max(double(lo), v)));
+    }
+}
+
+// Quantiles of x along `axis` (all elements when unset). The result has
+// shape (len(qs), *x.shape without axis); keep_q = false drops the leading
+// dimension for a single quantile.
+template <typename T>
+nb::ndarray<nb::numpy, T>
+quantile_impl(nb::ndarray<T, nb::c_contig, nb::device::cpu> x, const std::vector<double>& qs,
+              std::optional<int> axis, const std::string& method, bool keep_q) {
+    if (qs.empty()) throw std::runtime_error("quantile: qs must be non-empty");
+    for (double q : qs)
+        if (!(q >= 0.0 && q <= 1.0)) throw std::runtime_error("quantile: q must be in [0, 1]");
+    if (method != "approx" && method != "exact")
+        throw std::runtime_error("quantile: method must be 'exact' or 'approx'");
+    const size_t nd = x.ndim();
+    if (x.size() == 0) throw std::runtime_error("quantile: zero-length input");
+
+    // view x as (outer, n, inner) with n along the reduced axis
+    size_t outer = 1, n = x.size(), inner = 1;
+    std::vector<size_t> shape;
+    if (keep_q) shape.push_back(qs.size());
+    if (axis) {
+        int ax = *axis < 0 ? *axis + int(nd) : *axis;
+        if (ax < 0 || ax >= int(nd)) throw std::runtime_error("quantile: axis out of range");
+        n = x.shape(ax);
+        for (int i = 0; i < ax; ++i) outer *= x.shape(i);
+        for (int i = ax + 1; i < int(nd); ++i) inner *= x.shape(i);
+        for (int i = 0; i < int(nd); ++i) if (i != ax) shape.push_back(x.shape(i));
+    }
+    const size_t slices = outer * inner;
+    const T* X = x.data();
+    // on small inputs the gap between neighbouring order
+    // statistics usually exceeds the histogram resolution, so stay exact
+    const bool approx = method == "approx" && n >= kQuantileApproxMin;
+
+    T* C = static_cast<T*>(aligned_alloc64(qs.size() * slices * sizeof(T)));
+#if defined(_MSC_VER)
+    nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+    nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+
+    {
+        nb::gil_scoped_release release;
+        if (approx && inner == 1) {
+            // contiguous slices are histogrammed where they lie
+            for (size_t s = 0; s < slices; ++s)
+                quantiles_approx(X + s * n, n, qs, C + s, slices);
+        } else {
+            const size_t nt = parallel_threads(slices, 1);
+            std::vector<T> scratch(nt * n);
+            parallel_chunks(slices, nt, [&](size_t tid, size_t sb, size_t se) {
+                T* work = scratch.data() + tid * n;
+                for (size_t s = sb; s < se; ++s) {
+                    const size_t o = s / inner, j = s % inner;
+                    const T* src = X + o * n * inner + j;
+                    if (inner == 1) std::memcpy(work, src, n * sizeof(T));
+                    else for (size_t t = 0; t < n; ++t) work[t] = src[t * inner];
+                    if (approx) quantiles_approx(work, n, qs, C + s, slices);
+                    else quantiles_exact(work, n, qs, C + s, slices);
+                }
+            });
+        }
+    }
+
+    return nb::ndarray<nb::numpy, T>(C, shape.size(), shape.data(), deleter);
+}
+
+template <typename T>
+nb::ndarray<nb::numpy, T>
+quantile(nb::ndarray<T, nb::c_contig, nb::device::cpu> x, const std::vector<double>& qs,
+         std::optional<int> axis, const std::string& method) {
+    return quantile_impl(x, qs, axis, method, true);
+}
+
+template <typename T>
+T quantile(nb::ndarray<T, nb::c_contig, nb::device::cpu> x, double q, const std::string& method) {
+    return quantile_impl(x, { q }, std::nullopt, method, false).data()[0];
+}
+
+// percentiles are checked here so the error names their own range
+inline double percentile_fraction(double p) {
+    if (!(p >= 0.0 && p <= 100.0)) throw std::runtime_error("percentile: p must be in [0, 100]");
+    return p / 100.0;
+}
+
+template <typename T>
+nb::ndarray<nb::numpy, T>
+percentile(nb::ndarray<T, nb::c_contig, nb::device::cpu> x, const std::vector<double>& ps,
+           std::optional<int> axis, const std::string& method) {
+    std::vector<double> qs(ps);
+    for (auto& q : qs) q = percentile_fraction(q);
+    return quantile_impl(x, qs, axis, method, true);
+}
+
+template <typename T>
+T percentile(nb::ndarray<T, nb::c_contig, nb::device::cpu> x, double p, const std::string& method) {
+    return quantile_impl(x, { percentile_fraction(p) }, std::nullopt, method, false).data()[0];
+}
+
+template <typename T>
+T median(nb::ndarray<T, nb::c_contig, nb::device::cpu> x) {
+    return quantile_impl(x, { 0.5 }, std::nullopt, "exact", false).data()[0];
+}
+
+// median along an axis; shape is x.shape without axis
+template <typename T>
+nb::ndarray<nb::numpy, T> median(nb::ndarray<T, nb::c_contig, nb::device::cpu> x, int axis) {
+    return quantile_impl(x, { 0.5 }, axis, "exact", false);
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#include "../alloc.hpp"
+#include "../interop.hpp"
+#include "../parallel.hpp"
+#include "../simd/driver.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// rows per block reduced in the batch dtype before folding into float64
+// state; keeps float32 partial sums short
+constexpr size_t kRunningBlock = 256;
+
+// per-feature mean, m2, min and max of a row-major (N, D) block, two
+// passes with SIMD across the features; a NaN sticks in min and max
+template <typename T>
+void block_moments(const T* X, size_t N, size_t D, T* mu, T* m2, T* lo, T* hi) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    std::copy(X, X + D, lo);
+    std::copy(X, X + D, hi);
+    std::fill(mu, mu + D, T(0));
+    std::fill(m2, m2 + D, T(0));
+    for (size_t i = 0; i < N; ++i) {
+        const T* row = X + i * D;
+        size_t j = 0;
+        for (; j + L <= D; j += L) {
+            const auto v = LoadU(d, row + j);
+            StoreU(Add(LoadU(d, mu + j), v), d, mu + j);
+            StoreU(nan_min(LoadU(d, lo + j), v), d, lo + j);
+            StoreU(nan_max(LoadU(d, hi + j), v), d, hi + j);
+        }
+        for (; j < D; ++j) {
+            mu[j] += row[j];
+            lo[j] = nan_min(lo[j], row[j]);
+            hi[j] = nan_max(hi[j], row[j]);
+        }
+    }
+    const T inv = T(1) / T(N);
+    for (size_t j = 0; j < D; ++j) mu[j] *= inv;
+    for (size_t i = 0; i < N; ++i) {
+        const T* row = X + i * D;
+        size_t j = 0;
+        for (; j + L <= D; j += L) {
+            const auto c = Sub(LoadU(d, row + j), LoadU(d, mu + j));
+            StoreU(MulAdd(c, c, LoadU(d, m2 + j)), d, m2 + j);
+        }
+        for (; j < D; ++j) {
+            const T c = row[j] - mu[j];
+            m2[j] += c * c;
+        }
+    }
+}
+
+// Chan's pairwise combine of per-feature (count, mean, m2, min, max) state
+// a with b, in place in a; SIMD across the features
+inline void merge_moments(size_t D, double na, double* mean, double* m2, double* lo, double* hi,
+                          double nb_, const double* bmean, const double* bm2,
+                          const double* blo, const double* bhi) {
+    const double n = na + nb_;
+    const double wb = nb_ / n, wab = na * nb_ / n;
+    const ScalableTag<double> d;
+    const size_t L = Lanes(d);
+    const auto vwb = Set(d, wb), vwab = Set(d, wab);
+    size_t j = 0;
+    for (; j + L <= D; j += L) {
+        const auto delta = Sub(LoadU(d, bmean + j), LoadU(d, mean + j));
+        StoreU(MulAdd(delta, vwb, LoadU(d, mean + j)), d, mean + j);
+        const auto m = Add(LoadU(d, m2 + j), LoadU(d, bm2 + j));
+        StoreU(MulAdd(Mul(delta, delta), vwab, m), d, m2 + j);
+        StoreU(nan_min(LoadU(d, lo + j), LoadU(d, blo + j)), d, lo + j);
+        StoreU(nan_max(LoadU(d, hi + j), LoadU(d, bhi + j)), d, hi + j);
+    }
+    for (; j < D; ++j) {
+        const double delta = bmean[j] - mean[j];
+        mean[j] += delta * wb;
+        m2[j] += bm2[j] + delta * delta * wab;
+        lo[j] = nan_min(lo[j], blo[j]);
+        hi[j] = nan_max(hi[j], bhi[j]);
+    }
+}
+
+// Per-feature running count, mean, variance, min, max and sum over
+// batches of D-dimensional samples. Batches are reduced in their own dtype
+// in blocks of kRunningBlock rows with a two-pass mean/m2, and the blocks
+// are folded into float64 state with Chan's update, so results match a
+// one-shot computation up to rounding however the data is split. State
+// round-trips through state()/from_state() and pickle for checkpointing.
+class RunningStats {
+public:
+    using State = std::tuple<size_t, uint64_t,
+                             std::vector<double>, std::vector<double>,
+                             std::vector<double>, std::vector<double>>;
+
+    explicit RunningStats(size_t dim)
+        : dim_(dim), mean_(dim, 0.0), m2_(dim, 0.0),
+          min_(dim, std::numeric_limits<double>::infinity()),
+          max_(dim, -std::numeric_limits<double>::infinity()) {
+        if (dim == 0) throw std::runtime_error("RunningStats: dim must be positive");
+    }
+
+    size_t dim() const { return dim_; }
+    uint64_t count() const { return count_; }
+
+    // batch is (N, dim), or a single (dim,) sample
+    template <typename T>
+    void update(nb::ndarray<T, nb::c_contig, nb::device::cpu> batch) {
+        const size_t D = batch.ndim() == 1 ? batch.shape(0) : batch.ndim() == 2 ? batch.shape(1) : 0;
+        if (D != dim_) throw std::runtime_error("RunningStats.update: batch must be (N, dim) or (dim,)");
+        const size_t N = batch.ndim() == 1 ? 1 : batch.shape(0);
+        if (N == 0) return;
+
+        // blocks are spread over threads, each folding into its own
+        // accumulator; those are merged in order so results do not depend
+        // on the thread count
+        const T* X = batch.data();
+        const size_t nblocks = (N + kRunningBlock - 1) / kRunningBlock;
+        const size_t nt = parallel_threads(nblocks, 4);
+        std::vector<RunningStats> parts(nt, RunningStats(D));
+        {
+            nb::gil_scoped_release release;
+            parallel_chunks(nblocks, nt, [&](size_t tid, size_t b, size_t e) {
+                std::vector<T> mu(D), m2(D), lo(D), hi(D);
+                std::vector<double> bmean(D), bm2(D), blo(D), bhi(D);
+                for (size_t blk = b; blk < e; ++blk) {
+                    const size_t r0 = blk * kRunningBlock, n = std::min(kRunningBlock, N - r0);
+                    block_moments(X + r0 * D, n, D, mu.data(), m2.data(), lo.data(), hi.data());
+                    std::copy(mu.begin(), mu.end(), bmean.begin());
+                    std::copy(m2.begin(), m2.end(), bm2.begin());
+                    std::copy(lo.begin(), lo.end(), blo.begin());
+                    std::copy(hi.begin(), hi.end(), bhi.begin());
+                    parts[tid].merge_raw(double(n), bmean.data(), bm2.data(), blo.data(), bhi.data());
+                    parts[tid].count_ += n;
+                }
+            });
+        }
+        // merged with the GIL held, so concurrent updates of one
+        // accumulator are serialised here
+        for (const auto& p : parts) merge(p);
+    }
+
+    void merge(const RunningStats& other) {
+        if (other.dim_ != dim_) throw std::runtime_error("RunningStats.merge: dimensions differ");
+        if (other.count_ == 0) return;
+        merge_raw(double(other.count_), other.mean_.data(), other.m2_.data(),
+                  other.min_.data(), other.max_.data());
+        count_ += other.count_;
+    }
+
+    // {count, mean, var, std, min, max, sum}; var and std divide by count - ddof
+    nb::dict result(size_t ddof) const {
+        if (count_ <= ddof) throw std::runtime_error("RunningStats.result: need more samples than ddof");
+        const double s = 1.0 / double(count_ - ddof);
+        std::vector<double> var(dim_), sd(dim_), sum(dim_);
+        for (size_t j = 0; j < dim_; ++j) {
+            var[j] = m2_[j] * s;
+            sd[j] = std::sqrt(var[j]);
+            sum[j] = mean_[j] * double(count_);
+        }
+        nb::dict out;
+        out["count"] = count_;
+        out["mean"] = to_array(mean_);
+        out["var"] = to_array(var);
+        out["std"] = to_array(sd);
+        out["min"] = to_array(min_);
+        out["max"] = to_array(max_);
+        out["sum"] = to_array(sum);
+        return out;
+    }
+
+    // (dim, count, mean, m2, min, max)
+    State state() const { return { dim_, count_, mean_, m2_, min_, max_ }; }
+
+    static RunningStats from_state(const State& s) {
+        RunningStats r(std::get<0>(s));
+        const size_t D = r.dim_;
+        if (std::get<2>(s).size() != D || std::get<3>(s).size() != D ||
+            std::get<4>(s).size() != D || std::get<5>(s).size() != D)
+            throw std::runtime_error("RunningStats.from_state: state does not match dim");
+        r.count_ = std::get<1>(s);
+        r.mean_ = std::get<2>(s);
+        r.m2_ = std::get<3>(s);
+        r.min_ = std::get<4>(s);
+        r.max_ = std::get<5>(s);
+        return r;
+    }
+
+private:
+    void merge_raw(double nb_, const double* bmean, const double* bm2,
+                   const double* blo, const double* bhi) {
+        if (count_ == 0) {
+            std::copy(bmean, bmean + dim_, mean_.begin());
+            std::copy(bm2, bm2 + dim_, m2_.begin());
+            std::copy(blo, blo + dim_, min_.begin());
+            std::copy(bhi, bhi + dim_, max_.begin());
+            return;
+        }
+        merge_moments(dim_, double(count_), mean_.data(), m2_.data(), min_.data(), max_.data(),
+                      nb_, bmean, bm2, blo, bhi);
+    }
+
+    static nb::object to_array(const std::vector<double>& v) {
+        const size_t n = v.size();
+        double* C = static_cast<double*>(aligned_alloc64(n * sizeof(double)));
+#if defined(_MSC_VER)
+        nb::capsule deleter(C, [](void* p) noexcept { _aligned_free(p); });
+#else
+        nb::capsule deleter(C, [](void* p) noexcept { free(p); });
+#endif
+        std::copy(v.begin(), v.end(), C);
+        return interop::export_value(nb::ndarray<nb::numpy, double, nb::ndim<1>>(C, { n }, deleter));
+    }
+
+    size_t dim_;
+    uint64_t count_ = 0;
+    std::vector<double> mean_, m2_, min_, max_;
+};
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
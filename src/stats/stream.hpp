@@ -0,0 +1,373 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <hwy/highway.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../parallel.hpp"
+#include "../simd/ternary.hpp"
+
+namespace nb = nanobind;
+
+HWY_BEFORE_NAMESPACE();
+namespace hwy {
+namespace HWY_NAMESPACE {
+namespace capnhook {
+
+// bytes per chunk handed to a worker; resident memory stays around two
+// chunks per thread (the one being reduced and the one being read ahead)
+constexpr size_t kStreamChunkBytes = size_t(8) << 20;
+// elements per SIMD pass inside a chunk; small enough that the shifted
+// float32 sums stay accurate before they are folded into doubles
+constexpr size_t kStreamBlock = 4096;
+
+// running count, sum, mean, sum of squared deviations and extrema of a
+// stream; blocks and chunks are combined with Chan's pairwise update. As
+// in numpy a NaN is both the min and the max, at the index of the first.
+struct StreamStats {
+    uint64_t count = 0;
+    double sum = 0.0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    uint64_t argmin = 0;
+    uint64_t argmax = 0;
+
+    // b must cover elements after this one's, so ties keep the first index
+    void merge(const StreamStats& b) {
+        if (b.count == 0) return;
+        if (count == 0) {
+            *this = b;
+            return;
+        }
+        const double n = double(count) + double(b.count);
+        const double delta = b.mean - mean;
+        m2 += b.m2 + delta * delta * (double(count) * double(b.count) / n);
+        mean += delta * (double(b.count) / n);
+        sum += b.sum;
+        count += b.count;
+        const bool nan = std::isnan(min), b_nan = std::isnan(b.min);
+        if (!nan && (b_nan || b.min < min)) { min = b.min; argmin = b.argmin; }
+        if (!nan && (b_nan || b.max > max)) { max = b.max; argmax = b.argmax; }
+    }
+};
+
+// sum and sum of squares of x - x[0], min and max in a single pass over
+// one block; first is the global index of x[0]. Min and max go through
+// nan_min/nan_max, since Highway's Min/Max drop or keep NaN by target.
+template <typename T>
+StreamStats stream_block(const T* x, size_t n, uint64_t first) {
+    const ScalableTag<T> d;
+    const size_t L = Lanes(d);
+    const T K = x[0];
+    const auto vk = Set(d, K);
+    auto vs = Zero(d), vss = Zero(d);
+    auto vmin = Set(d, K), vmax = Set(d, K);
+    size_t i = 0;
+    for (; i + L <= n; i += L) {
+        const auto v = LoadU(d, x + i);
+        const auto c = Sub(v, vk);
+        vs = Add(vs, c);
+        vss = MulAdd(c, c, vss);
+        vmin = nan_min(vmin, v);
+        vmax = nan_max(vmax, v);
+    }
+    T s = ReduceSum(d, vs), ss = ReduceSum(d, vss);
+    bool nan = !AllFalse(d, IsNaN(vmin));
+    T lo = nan ? T(0) : ReduceMin(d, vmin), hi = nan ? T(0) : ReduceMax(d, vmax);
+    for (; i < n; ++i) {
+        const T c = x[i] - K;
+        s += c;
+        ss += c * c;
+        nan = nan || std::isnan(x[i]);
+        lo = std::min(lo, x[i]);
+        hi = std::max(hi, x[i]);
+    }
+
+    StreamStats r;
+    r.count = n;
+    r.sum = double(K) * double(n) + double(s);
+    r.mean = double(K) + double(s) / double(n);
+    const double m2 = double(ss) - double(s) * double(s) / double(n);
+    r.m2 = m2 < 0.0 ? 0.0 : m2;  // keeps a NaN
+    if (nan) {
+        const uint64_t at = first + size_t(std::find_if(x, x + n, [](T v) { return std::isnan(v); }) - x);
+        r.min = r.max = std::numeric_limits<double>::quiet_NaN();
+        r.argmin = r.argmax = at;
+        return r;
+    }
+    r.min = double(lo);
+    r.max = double(hi);
+    r.argmin = first + size_t(std::find(x, x + n, lo) - x);
+    r.argmax = first + size_t(std::find(x, x + n, hi) - x);
+    return r;
+}
+
+template <typename T>
+StreamStats stream_chunk(const T* x, size_t n, uint64_t first) {
+    StreamStats acc;
+    for (size_t b = 0; b < n; b += kStreamBlock)
+        acc.merge(stream_block(x + b, std::min(kStreamBlock, n - b), first + b));
+    return acc;
+}
+
+// [offset, offset + bytes) of a file on disk. POSIX maps each chunk and
+// unmaps it when done, with posix_fadvise read-ahead for the next one;
+// elsewhere chunks are read into a per-thread buffer.
+class FileChunks {
+public:
+    FileChunks(const std::string& path, uint64_t offset, size_t threads)
+        : path_(path), offset_(offset), slots_(threads) {
+#if !defined(_WIN32)
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error("stream.reduce: cannot open " + path);
+        page_ = uint64_t(::sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    ~FileChunks() {
+#if !defined(_WIN32)
+        for (size_t t = 0; t < slots_.size(); ++t) release(t);
+        ::close(fd_);
+#endif
+    }
+
+    FileChunks(const FileChunks&) = delete;
+    FileChunks& operator=(const FileChunks&) = delete;
+
+    void prefetch(uint64_t off, size_t len) {
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+        ::posix_fadvise(fd_, off_t(offset_ + off), off_t(len), POSIX_FADV_WILLNEED);
+#elif !defined(_WIN32) && defined(F_RDADVISE)
+        radvisory ra{ off_t(offset_ + off), int(std::min<size_t>(len, INT32_MAX)) };
+        ::fcntl(fd_, F_RDADVISE, &ra);
+#else
+        (void)off; (void)len;
+#endif
+    }
+
+    const void* acquire(size_t tid, uint64_t off, size_t len) {
+        Slot& s = slots_[tid];
+#if !defined(_WIN32)
+        const uint64_t start = offset_ + off;
+        const uint64_t base = start - start % page_;
+        s.len = size_t(start - base) + len;
+        s.map = ::mmap(nullptr, s.len, PROT_READ, MAP_SHARED, fd_, off_t(base));
+        if (s.map == MAP_FAILED) {
+            s.map = nullptr;
+            throw std::runtime_error("stream.reduce: mmap failed on " + path_);
+        }
+        ::madvise(s.map, s.len, MADV_SEQUENTIAL);
+        return static_cast<const char*>(s.map) + (start - base);
+#else
+        s.buf.resize(len);
+        std::ifstream in(path_, std::ios::binary);
+        in.seekg(std::streamoff(offset_ + off));
+        if (!in.read(s.buf.data(), std::streamsize(len)))
+            throw std::runtime_error("stream.reduce: read failed on " + path_);
+        return s.buf.data();
+#endif
+    }
+
+    void release(size_t tid) {
+#if !defined(_WIN32)
+        Slot& s = slots_[tid];
+        if (s.map) ::munmap(s.map, s.len);
+        s.map = nullptr;
+#else
+        (void)tid;
+#endif
+    }
+
+private:
+    struct Slot {
+        void* map = nullptr;
+        size_t len = 0;
+        std::vector<char> buf;
+    };
+    std::string path_;
+    uint64_t offset_;
+    std::vector<Slot> slots_;
+#if !defined(_WIN32)
+    int fd_ = -1;
+    uint64_t page_ = 4096;
+#endif
+};
+
+// an array already in memory, such as an np.memmap. When the pages are a
+// shared file mapping they are read ahead with MADV_WILLNEED and dropped
+// with MADV_DONTNEED once reduced; other memory is only read.
+class MemoryChunks {
+public:
+    MemoryChunks(const void* data, bool file_backed)
+        : data_(static_cast<const char*>(data)), file_backed_(file_backed) {
+#if !defined(_WIN32)
+        page_ = uint64_t(::sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    void prefetch(uint64_t off, size_t len) { advise(off, len, true); }
+    const void* acquire(size_t, uint64_t off, size_t) { return data_ + off; }
+    void release_range(uint64_t off, size_t len) { advise(off, len, false); }
+
+private:
+    void advise(uint64_t off, size_t len, bool willneed) {
+#if !defined(_WIN32)
+        if (!file_backed_ || len == 0) return;
+        // only whole pages inside the range, so neighbours are untouched
+        const uintptr_t a = reinterpret_cast<uintptr_t>(data_ + off);
+        uintptr_t lo = willneed ? a - a % page_ : (a + page_ - 1) / page_ * page_;
+        uintptr_t hi = willneed ? a + len : (a + len) / page_ * page_;
+        if (hi <= lo) return;
+        ::madvise(reinterpret_cast<void*>(lo), size_t(hi - lo), willneed ? MADV_WILLNEED : MADV_DONTNEED);
+#else
+        (void)off; (void)len; (void)willneed;
+#endif
+    }
+
+    const char* data_;
+    bool file_backed_;
+    uint64_t page_ = 4096;
+};
+
+// Reduces n elements of T from src in chunks of chunk_elems over nt
+// workers (the count src was sized for). Workers take contiguous runs of chunks and read the next chunk ahead while reducing
+// the current one; per-chunk results are merged in order, so the output
+// does not depend on the thread count.
+template <typename T, typename Src>
+StreamStats stream_chunks(Src& src, uint64_t n, size_t chunk_elems, size_t nt) {
+    const size_t nchunks = size_t((n + chunk_elems - 1) / chunk_elems);
+    std::vector<StreamStats> parts(nchunks);
+    parallel_chunks(nchunks, nt, [&](size_t tid, size_t b, size_t e) {
+        for (size_t c = b; c < e; ++c) {
+            const uint64_t first = uint64_t(c) * chunk_elems;
+            const size_t len = size_t(std::min<uint64_t>(chunk_elems, n - first));
+            if (c + 1 < e) {
+                const uint64_t next = first + chunk_elems;
+                src.prefetch(next * sizeof(T), size_t(std::min<uint64_t>(chunk_elems, n - next)) * sizeof(T));
+            }
+            const T* x = static_cast<const T*>(src.acquire(tid, first * sizeof(T), len * sizeof(T)));
+            parts[c] = stream_chunk(x, len, first);
+            if constexpr (std::is_same_v<Src, FileChunks>) src.release(tid);
+            else src.release_range(first * sizeof(T), len * sizeof(T));
+        }
+    });
+    StreamStats total;
+    for (const auto& p : parts) total.merge(p);
+    return total;
+}
+
+// the reductions stream_chunks computes together
+inline const std::vector<std::string>& stream_ops() {
+    static const std::vector<std::string> ops = {
+        "sum", "mean", "var", "std", "min", "max", "argmin", "argmax", "count"
+    };
+    return ops;
+}
+
+// Reduces a float32/float64 file or array without loading it whole. source
+// is a path (read from byte `offset`), an np.memmap or any C-contiguous CPU
+// array; dtype is required for paths and must match arrays when given.
+// Returns {op: value}.
+inline nb::dict stream_reduce(nb::object source, const std::vector<std::string>& ops,
+                              std::optional<std::string> dtype, size_t chunk_bytes,
+                              uint64_t offset) {
+    for (const auto& op : ops)
+        if (std::find(stream_ops().begin(), stream_ops().end(), op) == stream_ops().end())
+            throw std::runtime_error("stream.reduce: unknown op '" + op +
+                                     "' (sum, mean, var, std, min, max, argmin, argmax, count)");
+    if (chunk_bytes < 4096) throw std::runtime_error("stream.reduce: chunk_bytes must be at least 4096");
+
+    const bool is_path = nb::isinstance<nb::str>(source) || nb::hasattr(source, "__fspath__");
+    std::string dt = dtype ? *dtype : "";
+    std::string path;
+    nb::ndarray<nb::c_contig, nb::device::cpu> arr;
+    bool file_backed = false;
+    uint64_t bytes = 0;
+
+    if (is_path) {
+        if (!dtype) throw std::runtime_error("stream.reduce: dtype is required when reading a path");
+        path = nb::cast<std::string>(nb::module_::import_("os").attr("fspath")(source));
+        const uint64_t size = uint64_t(std::filesystem::file_size(path));
+        if (offset > size) throw std::runtime_error("stream.reduce: offset is past the end of the file");
+        bytes = size - offset;
+    } else {
+        if (offset != 0) throw std::runtime_error("stream.reduce: offset only applies to paths");
+        if (!nb::try_cast(source, arr, false))
+            throw std::runtime_error("stream.reduce: source must be a path or a C-contiguous CPU array");
+        const std::string arr_dt = arr.dtype() == nb::dtype<float>() ? "float32"
+                                 : arr.dtype() == nb::dtype<double>() ? "float64" : "";
+        if (arr_dt.empty()) throw std::runtime_error("stream.reduce: array must be float32 or float64");
+        if (dtype && *dtype != arr_dt) throw std::runtime_error("stream.reduce: dtype does not match the array");
+        dt = arr_dt;
+        bytes = arr.nbytes();
+        // np.memmap in a shared mode ('r', 'r+', 'w+'); copy-on-write pages
+        // may hold changes, so those are never dropped
+        if (nb::hasattr(source, "filename") && !source.attr("filename").is_none() &&
+            nb::hasattr(source, "mode"))
+            file_backed = nb::cast<std::string>(source.attr("mode")) != "c";
+    }
+    if (dt != "float32" && dt != "float64")
+        throw std::runtime_error("stream.reduce: dtype must be 'float32' or 'float64'");
+
+    const size_t elem = dt == "float32" ? sizeof(float) : sizeof(double);
+    if (bytes % elem != 0) throw std::runtime_error("stream.reduce: size is not a whole number of elements");
+    const uint64_t n = bytes / elem;
+    if (n == 0) throw std::runtime_error("stream.reduce: zero-length input");
+    const size_t chunk_elems = chunk_bytes / elem;
+
+    StreamStats r;
+    {
+        nb::gil_scoped_release release;
+        const size_t nt = parallel_threads(size_t((n + chunk_elems - 1) / chunk_elems), 1);
+        if (is_path) {
+            FileChunks src(path, offset, nt);
+            r = elem == sizeof(float) ? stream_chunks<float>(src, n, chunk_elems, nt)
+                                      : stream_chunks<double>(src, n, chunk_elems, nt);
+        } else {
+            MemoryChunks src(arr.data(), file_backed);
+            r = elem == sizeof(float) ? stream_chunks<float>(src, n, chunk_elems, nt)
+                                      : stream_chunks<double>(src, n, chunk_elems, nt);
+        }
+    }
+
+    nb::dict out;
+    for (const auto& op : ops) {
+        if (op == "sum") out[op.c_str()] = r.sum;
+        else if (op == "mean") out[op.c_str()] = r.mean;
+        else if (op == "var") out[op.c_str()] = r.m2 / double(r.count);
+        else if (op == "std") out[op.c_str()] = std::sqrt(r.m2 / double(r.count));
+        else if (op == "min") out[op.c_str()] = r.min;
+        else if (op == "max") out[op.c_str()] = r.max;
+        else if (op == "argmin") out[op.c_str()] = r.argmin;
+        else if (op == "argmax") out[op.c_str()] = r.argmax;
+        else out[op.c_str()] = r.count;
+    }
+    return out;
+}
+
+} // capnhook
+} // HWY_NAMESPACE
+} // hwy
+HWY_AFTER_NAMESPACE();
+
+namespace capnhook = hwy::HWY_NAMESPACE::capnhook;
@@ -0,0 +1,226 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+#include <nanobind/nanobind.h>
+
+#include "fastpath.hpp"
+#include "interop.hpp"
+
+namespace nb = nanobind;
+
+// Asynchronous op submission. submit() returns a concurrent.futures.Future
+// straight away and runs the op on a background executor thread, in
+// submission order. Ops in fastpath::table() on float32/float64 arrays are
+// checked and given their output array on the calling thread; their
+// kernel then runs on the executor with the GIL released (still spread
+// over the worker pool), so an event loop or preprocessing code keeps
+// running alongside. Any other op is called on the executor with the GIL
+// held; capnhook's own ops release it around their compute and hold it
+// only to convert arguments and wrap outputs, so Python keeps running
+// while they work too. A task holds its arguments until the future is
+// resolved.
+namespace tasks {
+
+// kernel runs without the GIL and may be empty; finish runs with it and
+// returns the future's result
+struct Job {
+    std::function<void()> kernel;
+    std::function<nb::object()> finish;
+};
+
+// scalar-returning kernel: the value is computed off the GIL and
+// converted on finish
+template <typename R, typename F>
+Job scalar_job(F f) {
+    auto r = std::make_shared<R>();
+    return { [r, f] { *r = f(); }, [r] { return nb::cast(*r); } };
+}
+
+// the fast path of fastpath::run, split at the GIL
+template <typename T>
+Job fast_job(const fastpath::FastOp& op, const fastpath::Kernels<T>& k, const fastpath::Array* args) {
+    using fastpath::Kind;
+    const auto* kp = &k;
+    const T* A = static_cast<const T*>(args[0].data());
+    const size_t N = args[0].size();
+    switch (op.kind) {
+    case Kind::Binary: {
+        fastpath::check_same_shape(args[0], args[1]);
+        const T* B = static_cast<const T*>(args[1].data());
+        T* C;
+        auto out = fastpath::empty_like<T>(args[0], &C);
+        return { [=] { kp->binary(A, B, C, N); }, [out] { return interop::export_value(out); } };
+    }
+    case Kind::Unary:
+    case Kind::Scan: {
+        T* C;
+        auto out = fastpath::empty_like<T>(args[0], &C, op.kind == Kind::Scan);
+        return { [=] { kp->unary(A, C, N); }, [out] { return interop::export_value(out); } };
+    }
+    case Kind::Reduce: return scalar_job<T>([=] { return kp->reduce(A, N); });
+    case Kind::Predicate: return scalar_job<bool>([=] { return kp->predicate(A, N); });
+    case Kind::Index: return scalar_job<size_t>([=] { return kp->index(A, N); });
+    case Kind::Dot: {
+        if (args[1].size() != N) throw std::runtime_error("dot: vectors must have the same length");
+        const T* B = static_cast<const T*>(args[1].data());
+        return scalar_job<T>([=] { return kp->dot(A, B, N); });
+    }
+    }
+    throw std::runtime_error("submit: unknown op kind");
+}
+
+struct Task {
+    Job job;
+    nb::object future;
+    nb::object inputs;  // the call's arguments, kept alive until resolve
+};
+
+// sets the future's result, or the exception raised by the kernel or op;
+// called with the GIL held
+inline void resolve(Task& t, std::exception_ptr error) {
+    // a future cancelled while queued stays cancelled; the result is dropped
+    if (!nb::cast<bool>(t.future.attr("set_running_or_notify_cancel")())) return;
+    try {
+        if (error) std::rethrow_exception(error);
+        t.future.attr("set_result")(t.job.finish());
+    } catch (nb::python_error& e) {
+        t.future.attr("set_exception")(e.value());
+    } catch (const std::exception& e) {
+        t.future.attr("set_exception")(nb::module_::import_("builtins").attr("RuntimeError")(e.what()));
+    } catch (...) {
+        t.future.attr("set_exception")(nb::module_::import_("builtins").attr("RuntimeError")("unknown error"));
+    }
+}
+
+// one thread running tasks in order; started by the first push and joined
+// by stop() at interpreter exit
+class Executor {
+public:
+    ~Executor() {
+        if (thread_.joinable()) thread_.detach();  // stop() did not run (os._exit)
+    }
+
+    // called with the GIL held
+    void push(std::unique_ptr<Task> t) {
+        {
+            std::lock_guard<std::mutex> g(m_);
+            if (!thread_.joinable()) {
+                stop_ = false;
+                thread_ = std::thread([this] { work(); });
+            }
+            queue_.push_back(std::move(t));
+        }
+        cv_.notify_one();
+    }
+
+    // runs what is queued, then joins the thread; called without the GIL,
+    // which the executor needs to resolve futures
+    void stop() {
+        std::thread t;
+        {
+            std::lock_guard<std::mutex> g(m_);
+            stop_ = true;
+            t = std::move(thread_);
+        }
+        cv_.notify_one();
+        if (t.joinable()) t.join();
+    }
+
+    // in a forked child the executor thread is gone: its handle and the
+    // queue are abandoned (the parent resolves those futures; releasing
+    // their Python objects mid-fork is unsafe) and the lock re-created, so
+    // the next push starts a new thread
+    void after_fork() {
+        new (&m_) std::mutex;
+        new (&cv_) std::condition_variable;
+        new std::thread(std::move(thread_));  // leaked, never joined
+        new std::deque<std::unique_ptr<Task>>(std::move(queue_));
+        queue_.clear();
+        stop_ = false;
+    }
+
+private:
+    void work() {
+        for (;;) {
+            std::unique_ptr<Task> t;
+            {
+                std::unique_lock<std::mutex> g(m_);
+                cv_.wait(g, [&] { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                t = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            std::exception_ptr error;
+            if (t->job.kernel) {
+                try { t->job.kernel(); }
+                catch (...) { error = std::current_exception(); }
+            }
+            // the task owns Python objects, so it is also released here
+            nb::gil_scoped_acquire gil;
+            resolve(*t, error);
+            t.reset();
+        }
+    }
+
+    std::thread thread_;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<Task>> queue_;
+    bool stop_ = false;
+};
+
+inline Executor& executor() {
+    static Executor e;
+#if !defined(_WIN32)
+    static const int at_fork = pthread_atfork(nullptr, nullptr, [] { executor().after_fork(); });
+    (void)at_fork;
+#endif
+    return e;
+}
+
+inline void stop() { executor().stop(); }
+
+// Queues op(*args, **kwargs) and returns its concurrent.futures.Future.
+// op is an op name or a capnhook function; a fast-path op is only
+// recognised as the module's own function, not as any callable that
+// shares its name.
+inline nb::object submit(nb::module_ module, nb::object op, nb::args args, nb::kwargs kwargs) {
+    auto task = std::make_unique<Task>();
+    const bool by_name = nb::isinstance<nb::str>(op);
+
+    fastpath::Array a[2];
+    fastpath::DType dt;
+    const fastpath::FastOp* fast = nb::len(kwargs) == 0 ? fastpath::lookup(module, op, args, a, dt) : nullptr;
+
+    if (fast) {
+        task->job = dt == fastpath::DType::F32 ? fast_job(*fast, fast->f32, a) : fast_job(*fast, fast->f64, a);
+        // finish runs on the executor thread, outside this call's scope
+        const interop::Framework source = interop::framework_of(args[0]);
+        task->job.finish = [finish = std::move(task->job.finish), source] {
+            interop::SourceScope scope(source);
+            return finish();
+        };
+    } else {
+        nb::object f = by_name ? module.attr(fastpath::op_name(op).c_str()) : op;
+        task->job.finish = [f, args, kwargs] { return f(*args, **kwargs); };
+    }
+    task->inputs = args;
+    task->future = nb::module_::import_("concurrent.futures").attr("Future")();
+    nb::object future = task->future;
+    executor().push(std::move(task));
+    return future;
+}
+
+} // tasks
@@ -111,5 +111,22 @@ def test_broadcast_errors():
     with pytest.raises(Exception):
         ch.div(a, b)
 
+def test_misaligned(test_arrays):
+    """Test inputs offset from vector alignment."""
+    for dtype in ['float32', 'float64']:
+        a = test_arrays[f'{dtype}_a']
+        b = test_arrays[f'{dtype}_b']
+        for off in [1, 3]:
+            ch_result = ch.add(a[off:], b[:len(b) - off])
+            assert np.allclose(a[off:] + b[:len(b) - off], ch_result, rtol=RTOL, atol=ATOL)
+
+def test_streaming_size():
+    """Test outputs large enough for non-temporal stores."""
+    for dtype in [np.float32, np.float64]:
+        a = np.random.uniform(-10.0, 10.0, 9_000_001).astype(dtype)
+        b = np.random.uniform(-10.0, 10.0, 9_000_001).astype(dtype)
+        assert np.array_equal(a + b, ch.add(a, b))
+        assert np.array_equal(a[1:] * b[:-1], ch.mul(a[1:], b[:-1]))
+
 if __name__ == "__main__":
     pytest.main(["-xvs", __file__])
\ No newline at end of file
@@ -0,0 +1,65 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+matrix_sizes = [(2, 1), (100, 5), (5000, 64), (300, 700)]
+
+@pytest.fixture(params=matrix_sizes)
+def observations(request):
+    """Generate correlated observations with a non-zero mean."""
+    n, d = request.param
+    rng = np.random.default_rng(0)
+    x = rng.normal(5.0, 1.0, (n, d)) @ rng.normal(size=(d, d)) + 10.0
+    return {
+        'float32': x.astype(np.float32),
+        'float64': x
+    }
+
+def test_cov(observations):
+    """Test cov matches numpy with observations in rows."""
+    for dtype in ['float32', 'float64']:
+        x = observations[dtype]
+        c = ch.cov(x, rowvar=False)
+        ref = np.cov(x.astype(np.float64), rowvar=False).reshape(c.shape)
+        assert c.dtype == x.dtype
+        assert np.allclose(c, ref, rtol=RTOL, atol=ATOL)
+        assert np.array_equal(c, c.T)
+
+def test_cov_rowvar(observations):
+    """Test the default layout treats rows as variables."""
+    x = np.ascontiguousarray(observations['float64'].T)
+    assert np.allclose(ch.cov(x), np.cov(x).reshape(x.shape[0], x.shape[0]))
+    assert np.allclose(ch.cov(x, ddof=0), np.cov(x, ddof=0).reshape(x.shape[0], x.shape[0]))
+
+def test_corrcoef(observations):
+    """Test correlations match numpy and stay within [-1, 1]."""
+    for dtype in ['float32', 'float64']:
+        x = observations[dtype]
+        if x.shape[0] < 3:
+            continue
+        r = ch.corrcoef(x, rowvar=False)
+        ref = np.corrcoef(x.astype(np.float64), rowvar=False).reshape(r.shape)
+        assert np.allclose(r, ref, rtol=RTOL, atol=1e-3)
+        assert np.all(np.abs(r) <= 1.0)
+
+def test_streaming_matches_one_shot(observations):
+    """Test accumulating row chunks gives the one-shot covariance."""
+    x = observations['float64']
+    state = None
+    for chunk in np.array_split(x, 7):
+        state = ch.cov_accumulate(np.ascontiguousarray(chunk), state)
+    count, mean, _ = state
+    assert count == x.shape[0]
+    assert np.allclose(mean, x.mean(axis=0))
+    assert np.allclose(ch.cov_finalize(state), ch.cov(x, rowvar=False))
+
+def test_cov_errors():
+    """Test too few observations raise."""
+    with pytest.raises(Exception):
+        ch.cov(np.ones((1, 3)), rowvar=False)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -0,0 +1,103 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-3
+
+matrix_sizes = [(200, 50, 5), (2000, 300, 10), (500, 800, 20)]
+
+@pytest.fixture(params=matrix_sizes)
+def low_rank(request):
+    """Generate a noisy low-rank matrix with a decaying spectrum."""
+    n, d, r = request.param
+    rng = np.random.default_rng(0)
+    a = rng.normal(size=(n, r))
+    b = rng.normal(size=(r, d))
+    x = (a * np.linspace(10.0, 1.0, r)) @ b + 1e-3 * rng.normal(size=(n, d)) + 2.0
+
+    return {
+        'rank': r,
+        'float32': x.astype(np.float32),
+        'float64': x
+    }
+
+def test_randomized_svd(low_rank):
+    """Test singular values and subspaces match LAPACK on the top components."""
+    for dtype in ['float32', 'float64']:
+        x = low_rank[dtype]
+        k = low_rank['rank'] // 2
+        U, S, Vt = ch.randomized_svd(x, k, n_iter=4)
+        _, S_ref, _ = np.linalg.svd(x.astype(np.float64), full_matrices=False)
+        assert U.shape == (x.shape[0], k)
+        assert S.shape == (k,)
+        assert Vt.shape == (k, x.shape[1])
+        assert U.dtype == x.dtype
+        assert np.allclose(S, S_ref[:k], rtol=RTOL)
+        assert np.allclose(U.T @ U, np.eye(k), atol=ATOL)
+        assert np.allclose(Vt @ Vt.T, np.eye(k), atol=ATOL)
+        # U diag(S) Vt reproduces the projection of x onto the top-k subspace
+        assert np.allclose((U * S) @ Vt, U @ (U.T @ x), rtol=RTOL, atol=1e-2 * np.abs(x).max())
+
+def test_pca(low_rank):
+    """Test PCA matches an eigendecomposition of the covariance matrix."""
+    for dtype in ['float32', 'float64']:
+        x = low_rank[dtype]
+        k = low_rank['rank'] // 2
+        scores, components, variance, mean = ch.pca(x, k)
+        x64 = x.astype(np.float64)
+        centred = x64 - x64.mean(axis=0)
+        _, s_ref, vt_ref = np.linalg.svd(centred, full_matrices=False)
+        assert np.allclose(mean, x64.mean(axis=0), rtol=RTOL, atol=ATOL)
+        assert np.allclose(variance, s_ref[:k] ** 2 / (x.shape[0] - 1), rtol=RTOL)
+        # components agree up to sign
+        overlap = np.abs(np.sum(components * vt_ref[:k], axis=1))
+        assert np.allclose(overlap, 1.0, atol=1e-2)
+        assert np.allclose(scores, centred @ components.T, rtol=RTOL, atol=1e-2 * np.abs(scores).max())
+
+def test_pca_float32_large_offset():
+    """Test float32 PCA on features far from zero matches the float64 fit."""
+    rng = np.random.default_rng(6)
+    n, d = 20000, 40
+    latent = rng.normal(size=(n, 5)) * np.array([3.0, 2.0, 1.5, 0.3, 0.2])
+    x = 1e4 + latent @ rng.normal(size=(5, d)) / np.sqrt(d) + 0.05 * rng.normal(size=(n, d))
+    x32 = x.astype(np.float32)
+    _, comp32, var32, _ = ch.pca(x32, 3)
+    _, comp64, var64, _ = ch.pca(x32.astype(np.float64), 3)
+    # centring by rank-one corrections loses about 1e-4 of the variance here
+    assert np.allclose(var32, var64, rtol=1e-5)
+    overlap = np.abs(np.sum(comp32 * comp64, axis=1))
+    assert np.allclose(overlap, 1.0, atol=1e-5)
+
+def test_randomized_svd_wide_spectrum_float32():
+    """Test float32 keeps singular values spanning four decades."""
+    rng = np.random.default_rng(4)
+    k = 10
+    u, _ = np.linalg.qr(rng.normal(size=(3000, k)))
+    v, _ = np.linalg.qr(rng.normal(size=(200, k)))
+    s = np.logspace(0.0, -4.0, k)
+    x = ((u * s) @ v.T).astype(np.float32)
+    U, S, Vt = ch.randomized_svd(x, k, n_iter=4)
+    assert np.allclose(S, s, rtol=RTOL)
+    assert np.allclose(U.T @ U, np.eye(k), atol=ATOL)
+    assert np.allclose(Vt @ Vt.T, np.eye(k), atol=ATOL)
+
+def test_randomized_svd_rank_deficient():
+    """Test a rank-one matrix gives one non-zero singular value."""
+    u = np.random.rand(100, 1)
+    v = np.random.rand(1, 40)
+    x = u @ v
+    U, S, Vt = ch.randomized_svd(x, 3)
+    assert np.allclose(S[0], np.linalg.norm(u) * np.linalg.norm(v), rtol=RTOL)
+    assert np.all(S[1:] < 1e-6 * S[0])
+
+def test_decomposition_errors():
+    """Test invalid component counts raise."""
+    x = np.random.rand(10, 4).astype(np.float32)
+    with pytest.raises(Exception):
+        ch.randomized_svd(x, 5)
+    with pytest.raises(Exception):
+        ch.pca(x, 0)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
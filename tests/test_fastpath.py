@@ -0,0 +1,120 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+sizes = [1, 7, 64, 1000]
+
+@pytest.fixture(params=sizes)
+def small_arrays(request):
+    """Generate small positive arrays in each dtype."""
+    n = request.param
+    rng = np.random.default_rng(0)
+    a = rng.uniform(0.1, 0.9, n)
+    b = rng.uniform(0.1, 0.9, n)
+    return {
+        'float32': (a.astype(np.float32), b.astype(np.float32)),
+        'float64': (a, b)
+    }
+
+def test_fast_binary_unary(small_arrays):
+    """Test elementwise ops keep the input dtype on small arrays."""
+    for dtype in ['float32', 'float64']:
+        a, b = small_arrays[dtype]
+        out = ch.add(a, b)
+        assert out.dtype == a.dtype
+        assert np.allclose(out, a + b, rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.div(a, b), a / b, rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.exp(a), np.exp(a), rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.cumsum(a), np.cumsum(a), rtol=RTOL, atol=ATOL)
+
+def test_fast_scalar_results(small_arrays):
+    """Test reductions, predicates, indices and dot return Python scalars."""
+    for dtype in ['float32', 'float64']:
+        a, b = small_arrays[dtype]
+        s = ch.reduce_sum(a)
+        assert isinstance(s, float)
+        assert np.isclose(s, a.sum(), rtol=RTOL, atol=ATOL)
+        assert ch.reduce_all(a) is True
+        assert ch.argmax(a) == np.argmax(a)
+        assert np.isclose(ch.dot(a, b), np.dot(a, b), rtol=RTOL, atol=ATOL)
+
+def test_fast_nd_shape():
+    """Test elementwise ops keep the shape of multi-dimensional inputs."""
+    x = np.random.default_rng(1).random((4, 5))
+    out = ch.mul(x, x)
+    assert out.shape == (4, 5)
+    assert np.allclose(out, x * x)
+    assert np.isclose(ch.reduce_sum(x), x.sum())
+    with pytest.raises(Exception):
+        ch.add(x, x.T.copy())
+
+def test_fast_scan_flattens():
+    """Test cumsum and cumprod flatten multi-dimensional inputs like numpy."""
+    x = np.random.default_rng(4).uniform(0.5, 1.5, (4, 5))
+    for dtype in [np.float32, np.float64]:
+        y = x.astype(dtype)
+        for op, ref in [(ch.cumsum, np.cumsum), (ch.cumprod, np.cumprod)]:
+            direct = op(y)
+            batched = ch.batch([(op, y)])[0]
+            submitted = ch.submit(op, y).result()
+            for out in [direct, batched, submitted]:
+                assert out.shape == (20,)
+                assert out.dtype == dtype
+                assert np.allclose(out, ref(y), rtol=RTOL, atol=ATOL)
+
+def test_batch(small_arrays):
+    """Test batch matches calling each op on its own."""
+    a, b = small_arrays['float64']
+    af, bf = small_arrays['float32']
+    results = ch.batch([
+        ("add", (a, b)),
+        (ch.sqrt, a),
+        ("reduce_max", (af,)),
+        ("dot", (af, bf)),
+        ("argmin", b),
+    ])
+    assert len(results) == 5
+    assert np.allclose(results[0], a + b)
+    assert np.allclose(results[1], np.sqrt(a))
+    assert np.isclose(results[2], af.max())
+    assert np.isclose(results[3], np.dot(af, bf), rtol=RTOL, atol=ATOL)
+    assert results[4] == np.argmin(b)
+
+def test_batch_fallback():
+    """Test ops without a fast path run through the module."""
+    x = np.random.default_rng(2).random((3, 3))
+    results = ch.batch([("matmul", (x, x)), (ch.median, x)])
+    assert np.allclose(results[0], x @ x)
+    assert np.isclose(results[1], np.median(x))
+
+def test_batch_foreign_callables():
+    """Test callables that are not capnhook ops are called as given."""
+    import functools
+    x = np.random.default_rng(3).uniform(0.1, 0.9, 100)
+    y = x.astype(np.float32)
+    results = ch.batch([
+        (np.add, (x, x)),
+        (np.exp, y),
+        (functools.partial(np.multiply, 3.0), x),
+        (lambda v: v - 1.0, (x,)),
+    ])
+    assert np.array_equal(results[0], np.add(x, x))
+    assert np.array_equal(results[1], np.exp(y))
+    assert np.array_equal(results[2], 3.0 * x)
+    assert np.array_equal(results[3], x - 1.0)
+    assert ch.submit(functools.partial(np.multiply, 2.0), x).result().tolist() == (2.0 * x).tolist()
+
+def test_batch_errors():
+    """Test malformed entries and kernel errors are raised."""
+    x = np.ones(3)
+    with pytest.raises(Exception):
+        ch.batch([("add", x, x)])
+    with pytest.raises(Exception):
+        ch.batch([("add", (x, np.ones(4)))])
+    assert ch.batch([]) == []
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -0,0 +1,89 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+sizes = [1, 1000, 1_000_003]
+
+@pytest.fixture(params=sizes)
+def samples(request):
+    """Generate normal samples in each dtype."""
+    n = request.param
+    x = np.random.default_rng(0).normal(size=n)
+    return {
+        'float32': x.astype(np.float32),
+        'float64': x
+    }
+
+def test_histogram(samples):
+    """Test counts and edges match np.histogram."""
+    for dtype in ['float32', 'float64']:
+        x = samples[dtype]
+        counts, edges = ch.histogram(x, 50)
+        ref_counts, ref_edges = np.histogram(x, 50)
+        assert counts.dtype == np.int64
+        assert np.allclose(edges, ref_edges, rtol=1e-6)
+        assert np.abs(counts - ref_counts).sum() <= max(2, x.size // 100_000)
+        assert counts.sum() == x.size
+
+def test_histogram_range(samples):
+    """Test values outside range are dropped and the last bin is closed."""
+    x = samples['float64']
+    counts, edges = ch.histogram(x, 13, range=(-1.0, 2.0))
+    ref_counts, ref_edges = np.histogram(x, 13, range=(-1.0, 2.0))
+    assert np.array_equal(counts, ref_counts)
+    assert np.allclose(edges, ref_edges)
+    edge_counts, _ = ch.histogram(np.array([0.0, 1.0, 2.0]), 2, range=(0.0, 2.0))
+    assert list(edge_counts) == [1, 2]
+
+def test_histogram_edges(samples):
+    """Test non-uniform bin edges."""
+    x = samples['float64']
+    bins = np.array([-3.0, -1.0, -0.5, 0.0, 0.1, 2.0, 4.0])
+    counts, edges = ch.histogram(x, bins)
+    assert np.array_equal(counts, np.histogram(x, bins)[0])
+    assert np.array_equal(edges, bins)
+
+def test_bincount():
+    """Test bincount with and without weights."""
+    rng = np.random.default_rng(1)
+    x = rng.integers(0, 500, 2_000_000)
+    assert np.array_equal(ch.bincount(x), np.bincount(x))
+    assert len(ch.bincount(x, minlength=1000)) == 1000
+    w = rng.random(x.size)
+    assert np.allclose(ch.bincount(x, w), np.bincount(x, w), rtol=RTOL, atol=ATOL)
+    with pytest.raises(Exception):
+        ch.bincount(np.array([1, -1]))
+
+def test_bincount_large_values():
+    """Test bincount where the largest value dwarfs the input length."""
+    x = np.array([3, 10_000_000, 3])
+    counts = ch.bincount(x)
+    assert len(counts) == 10_000_001
+    assert counts[3] == 2 and counts[-1] == 1 and counts.sum() == 3
+    rng = np.random.default_rng(3)
+    x = rng.integers(0, 1000, 300_000)
+    x[7] = 10_000_000
+    w = rng.random(x.size)
+    assert np.array_equal(ch.bincount(x), np.bincount(x))
+    assert np.allclose(ch.bincount(x, w), np.bincount(x, w), rtol=RTOL, atol=ATOL)
+    y = x.astype(np.float64)
+    y[7] = 4_000_000.0
+    values, counts = np.unique(y, return_counts=True)
+    assert ch.mode(y) == (values[np.argmax(counts)], counts.max())
+
+def test_mode():
+    """Test mode on integral and fractional data, with ties to the smallest."""
+    x = np.array([3.0, 1.0, 2.0, 2.0, 5.0, 1.0, -4.0])
+    value, count = ch.mode(x)
+    assert value == 1.0 and count == 2
+    y = np.random.default_rng(2).normal(size=10_000).round(1).astype(np.float32)
+    values, counts = np.unique(y, return_counts=True)
+    value, count = ch.mode(y)
+    assert value == values[np.argmax(counts)]
+    assert count == counts.max()
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
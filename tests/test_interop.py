@@ -0,0 +1,90 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+sizes = [1, 1000, 100_003]
+
+@pytest.fixture(params=sizes)
+def arrays(request):
+    """Generate random arrays in each dtype."""
+    n = request.param
+    x = np.random.default_rng(0).random(n)
+    return {
+        'float32': x.astype(np.float32),
+        'float64': x
+    }
+
+@pytest.fixture(autouse=True)
+def auto_output():
+    """Restore input-following outputs after every test."""
+    yield
+    ch.set_framework("auto")
+
+def test_framework_setting():
+    """Test set_framework returns the previous setting and rejects unknown names."""
+    assert ch.get_framework() == "auto"
+    assert ch.set_framework("dlpack") == "auto"
+    assert ch.get_framework() == "dlpack"
+    with pytest.raises(Exception):
+        ch.set_framework("matlab")
+    assert ch.get_framework() == "dlpack"
+
+def test_dlpack_output(arrays):
+    """Test dlpack outputs import into numpy with the right values."""
+    ch.set_framework("dlpack")
+    for dtype in ['float32', 'float64']:
+        x = arrays[dtype]
+        out = ch.add(x, x)
+        assert hasattr(out, "__dlpack__")
+        assert np.allclose(np.from_dlpack(out), x + x, rtol=RTOL, atol=ATOL)
+        vals, idx = ch.knn(x.reshape(-1, 1)[:8], x.reshape(-1, 1)[:8], 1)
+        assert np.from_dlpack(idx).dtype == np.int64
+
+def test_numpy_default(arrays):
+    """Test results are numpy arrays by default, including inside tuples."""
+    x = arrays['float64']
+    assert isinstance(ch.exp(x), np.ndarray)
+    counts, edges = ch.histogram(x, 5)
+    assert isinstance(counts, np.ndarray) and isinstance(edges, np.ndarray)
+
+def test_torch_roundtrip(arrays):
+    """Test torch tensors are accepted and returned as tensors without any setting."""
+    torch = pytest.importorskip("torch")
+    for dtype in ['float32', 'float64']:
+        t = torch.from_numpy(arrays[dtype])
+        out = ch.mul(t, t)
+        assert isinstance(out, torch.Tensor)
+        assert out.dtype == t.dtype
+        assert torch.allclose(out, t * t)
+        assert np.isclose(ch.reduce_sum(t), float(t.sum()), rtol=RTOL, atol=ATOL)
+        counts, edges = ch.histogram(t, 5)
+        assert isinstance(counts, torch.Tensor) and isinstance(edges, torch.Tensor)
+        assert isinstance(ch.batch([("mul", (t, t))])[0], torch.Tensor)
+        assert isinstance(ch.submit("mul", t, t).result(), torch.Tensor)
+        assert isinstance(ch.mul(arrays[dtype], arrays[dtype]), np.ndarray)
+
+def test_framework_override(arrays):
+    """Test set_framework forces the output framework regardless of the inputs."""
+    torch = pytest.importorskip("torch")
+    t = torch.from_numpy(arrays['float64'])
+    ch.set_framework("numpy")
+    assert isinstance(ch.mul(t, t), np.ndarray)
+    ch.set_framework("torch")
+    out = ch.mul(arrays['float64'], arrays['float64'])
+    assert isinstance(out, torch.Tensor)
+    assert torch.allclose(out, t * t)
+
+def test_jax_output(arrays):
+    """Test jax arrays are accepted and returned as jax arrays."""
+    jnp = pytest.importorskip("jax.numpy")
+    import jax
+    x = jnp.asarray(arrays['float32'])
+    out = ch.sqrt(x)
+    assert isinstance(out, jax.Array)
+    assert np.allclose(np.asarray(out), np.sqrt(arrays['float32']), rtol=RTOL, atol=ATOL)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -0,0 +1,84 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+pair_sizes = [(1, 1, 3), (70, 40, 5), (300, 1100, 16)]
+
+@pytest.fixture(params=pair_sizes)
+def point_sets(request):
+    """Generate two point sets for Gram matrix tests."""
+    n, m, d = request.param
+    rng = np.random.default_rng(0)
+    x = rng.normal(0.0, 0.5, (n, d))
+    y = rng.normal(0.0, 0.5, (m, d))
+
+    return {
+        'float32_x': x.astype(np.float32),
+        'float32_y': y.astype(np.float32),
+        'float64_x': x,
+        'float64_y': y
+    }
+
+def _reference(x, y, kind, gamma=0.3, degree=3, coef0=1.0, period=2.0, length_scale=1.5):
+    x = x.astype(np.float64)
+    y = y.astype(np.float64)
+    dot = x @ y.T
+    d2 = ((x[:, None, :] - y[None, :, :]) ** 2).sum(-1)
+    if kind == 'linear':
+        return dot
+    if kind == 'rbf':
+        return np.exp(-gamma * d2)
+    if kind == 'polynomial':
+        return (gamma * dot + coef0) ** degree
+    if kind == 'quadratic':
+        return (gamma * dot + coef0) ** 2
+    s = np.sin(np.pi * np.sqrt(d2) / period)
+    return np.exp(-2.0 * s ** 2 / length_scale ** 2)
+
+kinds = ['linear', 'rbf', 'polynomial', 'quadratic', 'periodic']
+
+def test_kernel_matrix(point_sets):
+    """Test every kernel against a dense numpy reference."""
+    for dtype in ['float32', 'float64']:
+        x = point_sets[f'{dtype}_x']
+        y = point_sets[f'{dtype}_y']
+        for kind in kinds:
+            ch_result = ch.kernel_matrix(x, y, kind, gamma=0.3, degree=3, coef0=1.0,
+                                         period=2.0, length_scale=1.5)
+            np_result = _reference(x, y, kind)
+            assert ch_result.shape == np_result.shape
+            assert ch_result.dtype == x.dtype
+            assert np.allclose(np_result, ch_result, rtol=RTOL, atol=ATOL)
+
+def test_kernel_matrix_symmetric(point_sets):
+    """Test the symmetric path (Y omitted or Y is X) matches the general one."""
+    for dtype in ['float32', 'float64']:
+        x = point_sets[f'{dtype}_x']
+        for kind in kinds:
+            full = _reference(x, x, kind)
+            omitted = ch.kernel_matrix(x, kind=kind, gamma=0.3, period=2.0, length_scale=1.5)
+            same = ch.kernel_matrix(x, x, kind, gamma=0.3, period=2.0, length_scale=1.5)
+            assert np.allclose(full, omitted, rtol=RTOL, atol=ATOL)
+            assert np.array_equal(omitted, same)
+            assert np.array_equal(omitted, omitted.T)
+
+def test_kernel_matrix_default_gamma():
+    """Test gamma defaults to 1 / n_features."""
+    x = np.random.rand(20, 8)
+    assert np.allclose(ch.kernel_matrix(x), _reference(x, x, 'rbf', gamma=1.0 / 8))
+
+def test_kernel_matrix_errors():
+    """Test bad kinds and shapes raise."""
+    x = np.random.rand(5, 3)
+    with pytest.raises(Exception):
+        ch.kernel_matrix(x, np.random.rand(5, 4))
+    with pytest.raises(Exception):
+        ch.kernel_matrix(x, kind="sigmoid")
+    with pytest.raises(Exception):
+        ch.kernel_matrix(x, kind="periodic", period=0.0)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
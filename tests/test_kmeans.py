@@ -0,0 +1,96 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+blob_sizes = [(300, 2, 3), (3000, 16, 4), (20000, 64, 8)]
+
+@pytest.fixture(params=blob_sizes)
+def blobs(request):
+    """Generate well separated gaussian blobs with known centres."""
+    n, d, k = request.param
+    rng = np.random.default_rng(0)
+    centres = rng.uniform(-50.0, 50.0, (k, d))
+    labels = np.arange(n) % k
+    points = centres[labels] + rng.normal(0.0, 0.5, (n, d))
+
+    return {
+        'k': k,
+        'centres': centres,
+        'labels': labels,
+        'float32': points.astype(np.float32),
+        'float64': points.astype(np.float64)
+    }
+
+def _match_centres(found, expected):
+    """Distance from every expected centre to its nearest found centre."""
+    d = ((expected[:, None, :] - found[None, :, :]) ** 2).sum(-1)
+    return np.sqrt(d.min(axis=1))
+
+def test_kmeans_recovers_blobs(blobs):
+    """Test Lloyd k-means finds the generating centres."""
+    for dtype in ['float32', 'float64']:
+        X = blobs[dtype]
+        centroids, labels, inertia = ch.kmeans(X, blobs['k'], iters=100, seed=1)
+        assert centroids.shape == (blobs['k'], X.shape[1])
+        assert centroids.dtype == X.dtype
+        assert labels.shape == (X.shape[0],)
+        assert np.all(_match_centres(centroids, blobs['centres']) < 1.0)
+
+        # labels agree with the nearest returned centroid
+        d = ((X[:, None, :].astype(np.float64) - centroids[None, :, :]) ** 2).sum(-1)
+        assert np.array_equal(labels, d.argmin(axis=1))
+        assert np.allclose(inertia, d.min(axis=1).sum(), rtol=RTOL)
+
+def test_kmeans_random_init(blobs):
+    """Test k-means with random initialisation converges to a valid partition."""
+    X = blobs['float64']
+    centroids, labels, inertia = ch.kmeans(X, blobs['k'], iters=100, init="random", seed=3)
+    assert labels.min() >= 0 and labels.max() < blobs['k']
+    assert inertia >= 0.0
+
+def test_kmeans_minibatch(blobs):
+    """Test mini-batch mode reaches the same centres as full batch."""
+    for dtype in ['float32', 'float64']:
+        X = blobs[dtype]
+        centroids, labels, inertia = ch.kmeans(X, blobs['k'], iters=200, batch_size=256, seed=1)
+        assert centroids.shape == (blobs['k'], X.shape[1])
+        assert np.all(_match_centres(centroids, blobs['centres']) < 1.0)
+
+def test_kmeans_deterministic():
+    """Test the same seed gives the same clustering."""
+    X = np.random.rand(1000, 8).astype(np.float32)
+    c1, l1, i1 = ch.kmeans(X, 5, seed=7)
+    c2, l2, i2 = ch.kmeans(X, 5, seed=7)
+    assert np.array_equal(l1, l2)
+    assert np.allclose(c1, c2)
+
+def test_kmeans_float32_many_rows():
+    """Test float32 centroids stay exact when one thread sums millions of rows."""
+    rng = np.random.default_rng(8)
+    n = 4_000_000
+    X = (rng.normal(0.0, 0.1, (n, 2)) + np.where(np.arange(n) % 2, 105.3, 5.3)[:, None]).astype(np.float32)
+    expected = np.array([X[0::2].astype(np.float64).mean(axis=0), X[1::2].astype(np.float64).mean(axis=0)])
+    # a single thread puts 2e6 rows in each per-thread cluster sum
+    ch.set_num_threads(1)
+    try:
+        centroids, labels, _ = ch.kmeans(X, 2, iters=5, seed=0)
+    finally:
+        ch.set_num_threads(0)
+    assert labels[0] != labels[1]
+    assert np.all(_match_centres(centroids, expected) < 1e-3)
+
+def test_kmeans_errors():
+    """Test invalid arguments raise."""
+    X = np.random.rand(10, 2).astype(np.float32)
+    with pytest.raises(Exception):
+        ch.kmeans(X, 11)
+    with pytest.raises(Exception):
+        ch.kmeans(X, 0)
+    with pytest.raises(Exception):
+        ch.kmeans(X, 2, init="bogus")
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
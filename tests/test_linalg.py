@@ -81,6 +81,54 @@ def test_norm(vector_arrays):
         except AttributeError:
             pytest.skip("norm not implemented in capnhook_ml")
 
+def test_norm_ord_axis(non_square_matrices):
+    """Test 1, 2 and inf norms of whole arrays and along each axis."""
+    for dtype in ['float32', 'float64']:
+        a = non_square_matrices[f'{dtype}_a']
+        for ord in [1, 2, np.inf]:
+            assert np.isclose(ch.norm(a, ord), np.linalg.norm(a.ravel(), ord), rtol=RTOL, atol=ATOL)
+            for axis in [0, 1, -1]:
+                result = ch.norm(a, ord=ord, axis=axis)
+                assert np.allclose(result, np.linalg.norm(a, ord, axis=axis), rtol=RTOL, atol=ATOL)
+                assert result.dtype == a.dtype
+        x = a.reshape(2, -1, 5)
+        assert np.allclose(ch.norm(x, axis=1), np.linalg.norm(x, axis=1), rtol=RTOL, atol=ATOL)
+    with pytest.raises(Exception):
+        ch.norm(np.ones(3), ord=3)
+    with pytest.raises(Exception):
+        ch.norm(np.ones((2, 2)), axis=2)
+
+def test_norm_no_overflow():
+    """Test that the L2 norm of huge or tiny values stays finite and exact."""
+    for dtype, scale in [(np.float32, 1e30), (np.float32, 1e-30), (np.float64, 1e200), (np.float64, 1e-200)]:
+        x = (np.random.uniform(-1.0, 1.0, 100_001) * scale).astype(dtype)
+        expected = np.linalg.norm(x.astype(np.float64) / scale) * scale
+        assert np.isclose(ch.norm(x), expected, rtol=RTOL, atol=0)
+        rows = x[:100_000].reshape(1000, 100)
+        expected_rows = np.linalg.norm(rows.astype(np.float64) / scale, axis=1) * scale
+        assert np.allclose(ch.norm(rows, axis=1), expected_rows, rtol=RTOL, atol=0)
+        assert np.allclose(ch.row_norm(rows), expected_rows, rtol=RTOL, atol=0)
+        expected_cols = np.linalg.norm(rows.astype(np.float64) / scale, axis=0) * scale
+        assert np.allclose(ch.norm(rows, axis=0), expected_cols, rtol=RTOL, atol=0)
+    assert np.isinf(ch.norm(np.array([1.0, np.inf])))
+    assert np.isnan(ch.norm(np.array([1.0, np.nan])))
+
+def test_norm_nan():
+    """Test that a NaN anywhere makes every norm NaN, as in numpy."""
+    for dtype in [np.float32, np.float64]:
+        for n, at in [(3, 0), (17, 16), (100_003, 50_001), (3_000_000, 2_999_999)]:
+            x = np.ones(n, dtype=dtype)
+            x[at] = np.nan
+            for ord in [1, 2, np.inf]:
+                assert np.isnan(ch.norm(x, ord))
+        rows = np.ones((50, 9), dtype=dtype)
+        rows[20, 4] = np.nan
+        for ord in [1, 2, np.inf]:
+            cols = ch.norm(rows, ord=ord, axis=0)
+            assert np.array_equal(np.isnan(cols), np.isnan(np.linalg.norm(rows, ord, axis=0)))
+            by_row = ch.norm(rows, ord=ord, axis=1)
+            assert np.array_equal(np.isnan(by_row), np.isnan(np.linalg.norm(rows, ord, axis=1)))
+
 def test_matmul_square(square_matrices):
     """Test matrix multiplication with square matrices."""
     for dtype in ['float32', 'float64']:
@@ -109,6 +157,64 @@ def test_matmul_non_square(non_square_matrices):
         except AttributeError:
             pytest.skip("matmul not implemented in capnhook_ml")
 
+def test_matmul_transposed(non_square_matrices):
+    """Test matmul on transposed, F-ordered and strided operands."""
+    for dtype in ['float32', 'float64']:
+        a = non_square_matrices[f'{dtype}_a']
+        b = non_square_matrices[f'{dtype}_b']
+        w = np.ascontiguousarray(b.T)
+        cases = [(a, w.T), (b.T, a.T), (np.asfortranarray(a), b), (a[:, ::2], b[::2, :])]
+        for x, y in cases:
+            ch_result = ch.matmul(x, y)
+            assert np.allclose(x @ y, ch_result, rtol=RTOL, atol=ATOL)
+            assert ch_result.dtype == a.dtype
+
+def test_transpose(non_square_matrices):
+    """Test the blocked transpose against numpy."""
+    for dtype in ['float32', 'float64']:
+        a = non_square_matrices[f'{dtype}_a']
+        for x in [a, a.T, np.asfortranarray(a), a[::3, 1:], np.zeros((0, 4), dtype=a.dtype)]:
+            t = ch.transpose(x)
+            assert np.array_equal(t, x.T)
+            assert t.flags['C_CONTIGUOUS'] and t.dtype == a.dtype
+    big = np.random.uniform(-1.0, 1.0, (1031, 517))
+    assert np.array_equal(ch.transpose(big), big.T)
+
+def test_gemv(non_square_matrices):
+    """Test matrix-vector products, including a transposed matrix."""
+    for dtype in ['float32', 'float64']:
+        a = non_square_matrices[f'{dtype}_a']
+        x = np.random.uniform(-5.0, 5.0, a.shape[1]).astype(dtype)
+        z = np.random.uniform(-5.0, 5.0, a.shape[0]).astype(dtype)
+        assert np.allclose(ch.gemv(a, x), a @ x, rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.gemv(a.T, z), a.T @ z, rtol=RTOL, atol=ATOL)
+        assert ch.gemv(a, x).dtype == a.dtype
+        with pytest.raises(Exception):
+            ch.gemv(a, z)
+
+def test_outer(vector_arrays):
+    """Test the outer product against numpy."""
+    for dtype in ['float32', 'float64']:
+        a = vector_arrays[f'{dtype}_a']
+        b = vector_arrays[f'{dtype}_b'][:7]
+        assert np.allclose(ch.outer(a, b), np.outer(a, b), rtol=RTOL, atol=ATOL)
+        assert ch.outer(a, b).shape == (len(a), 7)
+
+def test_row_dot_norm(non_square_matrices):
+    """Test per-row dot products and norms, and cosine similarity built on them."""
+    for dtype in ['float32', 'float64']:
+        a = non_square_matrices[f'{dtype}_a']
+        b = np.random.uniform(-5.0, 5.0, a.shape).astype(dtype)
+        assert np.allclose(ch.row_dot(a, b), np.einsum('ij,ij->i', a, b), rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.row_norm(a), np.linalg.norm(a, axis=1), rtol=RTOL, atol=ATOL)
+        cos = ch.row_dot(a, b) / (ch.row_norm(a) * ch.row_norm(b))
+        expected = np.sum(a * b, axis=1) / (np.linalg.norm(a, axis=1) * np.linalg.norm(b, axis=1))
+        assert np.allclose(cos, expected, rtol=RTOL, atol=ATOL)
+    big = np.random.uniform(-1.0, 1.0, (200_000, 16))
+    assert np.allclose(ch.row_norm(big), np.linalg.norm(big, axis=1), rtol=RTOL, atol=ATOL)
+    with pytest.raises(Exception):
+        ch.row_dot(big, big[:10])
+
 def test_trace(square_matrices):
     """Test matrix trace operation."""
     for dtype in ['float32', 'float64']:
@@ -152,6 +258,59 @@ def test_linalg_edge_cases():
     except AttributeError:
         pass
 
+def _spd(n, dtype):
+    """Random symmetric positive definite matrix."""
+    x = np.random.uniform(-1.0, 1.0, (n, n + 3))
+    return (x @ x.T / n + np.eye(n)).astype(dtype)
+
+@pytest.mark.parametrize("n", [1, 50, 300])
+def test_cholesky(n):
+    """Test the lower and upper factors and the log-determinant."""
+    for dtype in ['float32', 'float64']:
+        A = _spd(n, dtype)
+        L = ch.cholesky(A)
+        U = ch.cholesky(A, lower=False)
+        assert np.allclose(L, np.linalg.cholesky(A.astype(np.float64)), rtol=RTOL, atol=ATOL)
+        assert np.array_equal(np.triu(L, 1), np.zeros_like(L))
+        assert np.allclose(U, L.T, rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.cholesky(np.asfortranarray(A)), L, rtol=RTOL, atol=ATOL)
+        _, expected = np.linalg.slogdet(A.astype(np.float64))
+        assert np.isclose(ch.logdet(A), expected, rtol=1e-4, atol=ATOL)
+
+@pytest.mark.parametrize("n", [1, 50, 300])
+def test_triangular_solves(n):
+    """Test solve_triangular and cho_solve against numpy."""
+    for dtype in ['float32', 'float64']:
+        A = _spd(n, dtype)
+        b = np.random.uniform(-1.0, 1.0, n).astype(dtype)
+        B = np.random.uniform(-1.0, 1.0, (n, 3)).astype(dtype)
+        L = ch.cholesky(A)
+        L64 = L.astype(np.float64)
+        for lower, T in [(True, L), (False, np.ascontiguousarray(L.T))]:
+            T64 = T.astype(np.float64)
+            assert np.allclose(ch.solve_triangular(T, b, lower=lower), np.linalg.solve(T64, b), rtol=RTOL, atol=ATOL)
+            assert np.allclose(ch.solve_triangular(T, B, lower=lower, trans=True), np.linalg.solve(T64.T, B),
+                               rtol=RTOL, atol=ATOL)
+        # the .T view of L is an upper factor used in place
+        assert np.allclose(ch.solve_triangular(L.T, b, lower=False), np.linalg.solve(L64.T, b), rtol=RTOL, atol=ATOL)
+        expected = np.linalg.solve(A.astype(np.float64), B)
+        assert np.allclose(ch.cho_solve(L, B), expected, rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.cho_solve(L.T, B, lower=False), expected, rtol=RTOL, atol=ATOL)
+        assert ch.cho_solve(L, b).shape == (n,)
+
+def test_cholesky_errors():
+    """Test that indefinite, singular and mismatched inputs raise."""
+    with pytest.raises(Exception):
+        ch.cholesky(np.array([[1.0, 2.0], [2.0, 1.0]]))
+    with pytest.raises(Exception):
+        ch.logdet(-np.eye(3))
+    with pytest.raises(Exception):
+        ch.cholesky(np.random.rand(3, 4))
+    with pytest.raises(Exception):
+        ch.solve_triangular(np.zeros((3, 3)), np.ones(3))
+    with pytest.raises(Exception):
+        ch.cho_solve(np.eye(3), np.ones(4))
+
 def test_matmul_errors():
     """Test that proper errors are raised for invalid shapes in matmul."""
     try:
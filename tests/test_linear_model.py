@@ -0,0 +1,126 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-3
+
+problem_sizes = [(50, 3), (1000, 10), (20000, 40)]
+
+@pytest.fixture(params=problem_sizes)
+def regression_data(request):
+    """Generate a linear problem with a sparse ground truth and an offset."""
+    n, d = request.param
+    rng = np.random.default_rng(0)
+    x = rng.normal(1.0, 1.0, (n, d))
+    w = np.zeros(d)
+    w[: max(1, d // 3)] = rng.uniform(1.0, 3.0, max(1, d // 3))
+    z = x @ w + 2.0
+    y = z + 0.01 * rng.normal(size=n)
+    p = 1.0 / (1.0 + np.exp(-(z - z.mean()) / z.std()))
+    labels = (rng.uniform(size=n) < p).astype(np.float64)
+
+    return {
+        'float32_x': x.astype(np.float32),
+        'float32_y': y.astype(np.float32),
+        'float32_labels': labels.astype(np.float32),
+        'float64_x': x,
+        'float64_y': y,
+        'float64_labels': labels
+    }
+
+def test_ridge(regression_data):
+    """Test ridge matches the closed form on centred data."""
+    for dtype in ['float32', 'float64']:
+        x = regression_data[f'{dtype}_x']
+        y = regression_data[f'{dtype}_y']
+        alpha = 0.5
+        coef, intercept = ch.ridge(x, y, alpha)
+        x64, y64 = x.astype(np.float64), y.astype(np.float64)
+        xc, yc = x64 - x64.mean(0), y64 - y64.mean()
+        ref = np.linalg.solve(xc.T @ xc + alpha * np.eye(x.shape[1]), xc.T @ yc)
+        assert coef.dtype == x.dtype
+        assert np.allclose(coef, ref, rtol=RTOL, atol=ATOL)
+        assert np.allclose(intercept, y64.mean() - x64.mean(0) @ ref, rtol=RTOL, atol=1e-2)
+
+def test_ridge_no_intercept(regression_data):
+    """Test ridge without an intercept solves the uncentred system."""
+    x = regression_data['float64_x']
+    y = regression_data['float64_y']
+    coef, intercept = ch.ridge(x, y, 1.0, fit_intercept=False)
+    ref = np.linalg.solve(x.T @ x + np.eye(x.shape[1]), x.T @ y)
+    assert intercept == 0.0
+    assert np.allclose(coef, ref, rtol=RTOL, atol=ATOL)
+
+def test_lasso(regression_data):
+    """Test lasso satisfies the KKT conditions and zeroes irrelevant features."""
+    for dtype in ['float32', 'float64']:
+        x = regression_data[f'{dtype}_x']
+        y = regression_data[f'{dtype}_y']
+        alpha = 0.05
+        coef, intercept = ch.lasso(x, y, alpha, max_iter=5000, tol=1e-8)
+        x64, y64 = x.astype(np.float64), y.astype(np.float64)
+        n = x.shape[0]
+        grad = x64.T @ (y64 - x64 @ coef - intercept) / n
+        active = coef != 0
+        assert np.allclose(grad[active], alpha * np.sign(coef[active]), atol=1e-2)
+        assert np.all(np.abs(grad[~active]) <= alpha + 1e-2)
+
+def test_float32_large_offset():
+    """Test float32 ridge and lasso on features whose mean dwarfs their spread."""
+    rng = np.random.default_rng(2)
+    x = rng.normal(1000.0, 1.0, (200_000, 5))
+    w = np.array([1.0, -2.0, 0.5, 3.0, 0.0])
+    y = (x - 1000.0) @ w + 500.0 + 0.01 * rng.normal(size=x.shape[0])
+    x32, y32 = x.astype(np.float32), y.astype(np.float32)
+    x64, y64 = x32.astype(np.float64), y32.astype(np.float64)
+    xc, yc = x64 - x64.mean(0), y64 - y64.mean()
+    ref = np.linalg.solve(xc.T @ xc + np.eye(5), xc.T @ yc)
+    coef, intercept = ch.ridge(x32, y32, 1.0)
+    assert np.allclose(coef, ref, rtol=RTOL, atol=ATOL)
+    assert np.isclose(intercept, y64.mean() - x64.mean(0) @ ref, rtol=RTOL)
+    coef, _ = ch.lasso(x32, y32, 0.01, max_iter=5000, tol=1e-8)
+    assert np.allclose(coef, w - 0.01 * np.sign(w), rtol=RTOL, atol=1e-2)
+
+def test_logistic_regression(regression_data):
+    """Test the L-BFGS solution is a stationary point of the penalised loss."""
+    for dtype in ['float32', 'float64']:
+        x = regression_data[f'{dtype}_x']
+        labels = regression_data[f'{dtype}_labels']
+        alpha = 1.0
+        coef, intercept = ch.logistic_regression(x, labels, alpha, max_iter=500)
+        x64 = x.astype(np.float64)
+        p = 1.0 / (1.0 + np.exp(-(x64 @ coef + intercept)))
+        grad = x64.T @ (p - labels) + alpha * coef
+        scale = np.abs(x64.T @ labels).max()
+        assert np.all(np.abs(grad) <= 1e-2 * scale)
+        assert np.abs(np.sum(p - labels)) <= 1e-2 * scale
+
+def test_batched_fits_match_single():
+    """Test the batched overloads agree with fitting each model on its own."""
+    rng = np.random.default_rng(1)
+    xs = rng.normal(size=(16, 200, 5))
+    ys = xs @ rng.normal(size=5) + rng.normal(size=(16, 200))
+    labels = (ys > 0).astype(np.float64)
+    coefs, intercepts = ch.ridge(xs, ys, 0.1)
+    assert coefs.shape == (16, 5)
+    assert intercepts.shape == (16,)
+    for m in [0, 7, 15]:
+        coef, intercept = ch.ridge(xs[m], ys[m], 0.1)
+        assert np.allclose(coefs[m], coef)
+        assert np.allclose(intercepts[m], intercept)
+    coefs, _ = ch.lasso(xs, ys, 0.1)
+    assert np.allclose(coefs[3], ch.lasso(xs[3], ys[3], 0.1)[0])
+    coefs, _ = ch.logistic_regression(xs, labels)
+    assert np.allclose(coefs[5], ch.logistic_regression(xs[5], labels[5])[0])
+
+def test_linear_model_errors():
+    """Test mismatched shapes raise."""
+    x = np.random.rand(10, 3)
+    with pytest.raises(Exception):
+        ch.ridge(x, np.random.rand(9))
+    with pytest.raises(Exception):
+        ch.logistic_regression(x, np.random.rand(11))
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
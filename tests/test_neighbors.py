@@ -0,0 +1,84 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-3
+
+pair_sizes = [(1, 5, 3), (50, 200, 8), (300, 2500, 64)]
+metrics = ['sqeuclidean', 'euclidean', 'cosine']
+
+@pytest.fixture(params=pair_sizes)
+def point_sets(request):
+    """Generate query and reference point sets."""
+    n, m, d = request.param
+    rng = np.random.default_rng(0)
+    x = rng.normal(0.0, 1.0, (n, d))
+    y = rng.normal(0.0, 1.0, (m, d))
+
+    return {
+        'float32_x': x.astype(np.float32),
+        'float32_y': y.astype(np.float32),
+        'float64_x': x,
+        'float64_y': y
+    }
+
+def _reference_cdist(x, y, metric):
+    x = x.astype(np.float64)
+    y = y.astype(np.float64)
+    if metric == 'cosine':
+        xn = x / np.linalg.norm(x, axis=1, keepdims=True)
+        yn = y / np.linalg.norm(y, axis=1, keepdims=True)
+        return 1.0 - xn @ yn.T
+    d2 = ((x[:, None, :] - y[None, :, :]) ** 2).sum(-1)
+    return d2 if metric == 'sqeuclidean' else np.sqrt(d2)
+
+def test_cdist(point_sets):
+    """Test pairwise distances against a dense numpy reference."""
+    for dtype in ['float32', 'float64']:
+        x = point_sets[f'{dtype}_x']
+        y = point_sets[f'{dtype}_y']
+        for metric in metrics:
+            ch_result = ch.cdist(x, y, metric)
+            np_result = _reference_cdist(x, y, metric)
+            assert ch_result.shape == np_result.shape
+            assert ch_result.dtype == x.dtype
+            assert np.allclose(np_result, ch_result, rtol=RTOL, atol=ATOL)
+
+def test_knn(point_sets):
+    """Test k nearest neighbours match argsort of the full distance matrix."""
+    for dtype in ['float32', 'float64']:
+        x = point_sets[f'{dtype}_x']
+        y = point_sets[f'{dtype}_y']
+        k = min(3, y.shape[0])
+        for metric in metrics:
+            dist, idx = ch.knn(x, y, k, metric)
+            ref = _reference_cdist(x, y, metric)
+            ref_idx = np.argsort(ref, axis=1, kind='stable')[:, :k]
+            assert dist.shape == (x.shape[0], k)
+            assert idx.shape == (x.shape[0], k)
+            assert np.allclose(np.take_along_axis(ref, ref_idx, 1), dist, rtol=RTOL, atol=ATOL)
+            assert np.all(np.diff(dist, axis=1) >= -ATOL)
+            # indices may only differ where distances tie
+            assert np.allclose(np.take_along_axis(ref, idx, 1), dist, rtol=RTOL, atol=ATOL)
+
+def test_knn_self_is_nearest():
+    """Test every point is its own nearest neighbour."""
+    x = np.random.rand(500, 16).astype(np.float32)
+    dist, idx = ch.knn(x, x, 1)
+    assert np.array_equal(idx[:, 0], np.arange(500))
+    assert np.allclose(dist[:, 0], 0.0, atol=1e-2)
+
+def test_neighbors_errors():
+    """Test invalid shapes and arguments raise."""
+    x = np.random.rand(10, 3).astype(np.float32)
+    y = np.random.rand(5, 4).astype(np.float32)
+    with pytest.raises(Exception):
+        ch.cdist(x, y)
+    with pytest.raises(Exception):
+        ch.knn(x, x, 11)
+    with pytest.raises(Exception):
+        ch.cdist(x, x, "manhattan")
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -0,0 +1,115 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+# documented bounds per (mode, dtype): (exp, log) in ulp or relative
+# error, (sin, cos) in absolute error
+ULP_BOUNDS = {
+    ('fast', 'float32'): {'exp': 4, 'log': 6},
+    ('fast', 'float64'): {'exp': 4, 'log': 4},
+}
+REL_BOUNDS = {
+    ('fastest', 'float32'): {'exp': 1e-4, 'log': 5e-5},
+    ('fastest', 'float64'): {'exp': 2e-7, 'log': 2e-7},
+}
+ABS_BOUNDS = {
+    ('fast', 'float32'): 2e-7,
+    ('fast', 'float64'): 3e-16,
+    ('fastest', 'float32'): 2e-5,
+    ('fastest', 'float64'): 5e-8,
+}
+
+@pytest.fixture
+def restore_precision():
+    """Restore the accurate kernels after a test."""
+    yield
+    ch.set_precision("accurate")
+
+@pytest.fixture
+def inputs():
+    """Arguments covering each kernel's fast range in both dtypes."""
+    rng = np.random.default_rng(0)
+    x = {
+        'exp': rng.uniform(-80.0, 80.0, 100_000),
+        'log': np.exp2(rng.uniform(-120.0, 120.0, 100_000)) * rng.uniform(1.0, 2.0, 100_000),
+        'trig': rng.uniform(-100.0, 100.0, 100_000),
+    }
+    return {dtype: {k: v.astype(dtype) for k, v in x.items()} for dtype in ['float32', 'float64']}
+
+def _reference(f, x):
+    """f evaluated in extended precision."""
+    return f(x.astype(np.longdouble))
+
+def test_set_precision(restore_precision):
+    """Test that the mode round-trips and unknown names raise."""
+    assert ch.get_precision() == "accurate"
+    assert ch.set_precision("fast") == "accurate"
+    assert ch.set_precision("fastest") == "fast"
+    assert ch.get_precision() == "fastest"
+    with pytest.raises(Exception):
+        ch.set_precision("approximate")
+    assert ch.get_precision() == "fastest"
+
+@pytest.mark.parametrize("mode", ["fast", "fastest"])
+def test_error_bounds(inputs, mode, restore_precision):
+    """Test each reduced tier against its documented error bound."""
+    ch.set_precision(mode)
+    for dtype in ['float32', 'float64']:
+        x = inputs[dtype]
+        for name, f, arg in [('exp', np.exp, 'exp'), ('log', np.log, 'log')]:
+            ref = _reference(f, x[arg])
+            err = np.abs(getattr(ch, name)(x[arg]).astype(np.longdouble) - ref)
+            if (mode, dtype) in ULP_BOUNDS:
+                ulp = np.spacing(np.abs(ref.astype(dtype))).astype(np.longdouble)
+                assert (err / ulp).max() <= ULP_BOUNDS[(mode, dtype)][name]
+            else:
+                assert (err / np.abs(ref)).max() <= REL_BOUNDS[(mode, dtype)][name]
+        for name, f in [('sin', np.sin), ('cos', np.cos)]:
+            ref = _reference(f, x['trig'])
+            err = np.abs(getattr(ch, name)(x['trig']).astype(np.longdouble) - ref)
+            assert err.max() <= ABS_BOUNDS[(mode, dtype)]
+
+def test_special_values(restore_precision):
+    """Test that every tier returns the same special values."""
+    x = np.array([0.0, -0.0, -1.0, np.inf, -np.inf, np.nan, 1e-310, 800.0, -800.0, 1e4])
+    for mode in ["accurate", "fast", "fastest"]:
+        ch.set_precision(mode)
+        for dtype in ['float32', 'float64']:
+            xd = x.astype(dtype)
+            with np.errstate(all='ignore'):
+                for name in ['exp', 'log', 'sin', 'cos']:
+                    result = getattr(ch, name)(xd)
+                    expected = getattr(np, name)(xd)
+                    special = ~np.isfinite(expected) | (expected == 0)
+                    assert np.array_equal(result[special], expected[special], equal_nan=True)
+                    assert np.allclose(result, expected, rtol=RTOL, atol=ATOL, equal_nan=True)
+
+def test_unaffected_ops(restore_precision):
+    """Test that asin, acos and sqrt give the same result in every mode."""
+    x = np.random.uniform(-1.0, 1.0, 10_001)
+    expected = [ch.asin(x), ch.acos(x), ch.sqrt(np.abs(x))]
+    ch.set_precision("fastest")
+    assert all(np.array_equal(a, b) for a, b in zip([ch.asin(x), ch.acos(x), ch.sqrt(np.abs(x))], expected))
+
+def test_fused_activations(restore_precision):
+    """Test kernel matrices and logistic regression under the reduced tiers."""
+    rng = np.random.default_rng(1)
+    x = rng.normal(size=(200, 5))
+    labels = (x @ rng.normal(size=5) + 0.5 * rng.normal(size=200) > 0).astype(np.float64)
+    kernels = {kind: ch.kernel_matrix(x, kind=kind, gamma=0.3, period=2.0, length_scale=1.5)
+               for kind in ['rbf', 'periodic']}
+    coef, intercept = ch.logistic_regression(x, labels, 1.0)
+    for mode in ["fast", "fastest"]:
+        ch.set_precision(mode)
+        for kind, expected in kernels.items():
+            result = ch.kernel_matrix(x, kind=kind, gamma=0.3, period=2.0, length_scale=1.5)
+            assert np.allclose(result, expected, rtol=1e-6, atol=1e-6)
+        c, b = ch.logistic_regression(x, labels, 1.0)
+        assert np.allclose(c, coef, rtol=RTOL, atol=ATOL)
+        assert np.isclose(b, intercept, rtol=RTOL, atol=ATOL)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -0,0 +1,78 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+sizes = [1, 1000, 1_000_003]
+
+@pytest.fixture(params=sizes)
+def arrays(request):
+    """Generate random arrays in each dtype."""
+    n = request.param
+    x = np.random.default_rng(0).random(n)
+    return {
+        'float32': x.astype(np.float32),
+        'float64': x
+    }
+
+@pytest.fixture(autouse=True)
+def profiling_off():
+    """Leave profiling disabled and the counters clear after every test."""
+    yield
+    ch.profile(False)
+    ch.profile_reset()
+
+def test_profile_disabled(arrays):
+    """Test nothing is recorded while profiling is off."""
+    ch.profile(False)
+    ch.profile_reset()
+    ch.add(arrays['float64'], arrays['float64'])
+    assert ch.profile_stats() == {}
+
+def test_profile_counts(arrays):
+    """Test calls, bytes and allocations are recorded per op."""
+    ch.profile_reset()
+    assert ch.profile(True)
+    for dtype in ['float32', 'float64']:
+        x = arrays[dtype]
+        ch.add(x, x)
+        ch.reduce_sum(x)
+    stats = ch.profile_stats()
+    nbytes = arrays['float32'].nbytes + arrays['float64'].nbytes
+    assert stats['add']['calls'] == 2
+    assert stats['add']['bytes_read'] == 2 * nbytes
+    assert stats['add']['bytes_written'] == nbytes
+    assert stats['add']['allocs'] == 2
+    assert stats['add']['alloc_bytes'] >= nbytes
+    assert stats['reduce_sum']['bytes_written'] == 0
+    assert 0 <= stats['add']['max_s'] <= stats['add']['total_s']
+    assert isinstance(stats['add']['target'], str)
+
+def test_profile_in_place(arrays):
+    """Test ops filling an output in place count it as written."""
+    ch.profile_reset()
+    ch.profile(True)
+    out = np.empty_like(arrays['float64'])
+    ch.random.uniform(out, seed=1)
+    stats = ch.profile_stats()['random.uniform']
+    assert stats['bytes_read'] == 0
+    assert stats['bytes_written'] == out.nbytes
+
+def test_profile_reset(arrays):
+    """Test reset clears counters but keeps profiling on."""
+    ch.profile(True)
+    ch.exp(arrays['float32'])
+    assert ch.profile_stats()['exp']['calls'] == 1
+    ch.profile_reset()
+    assert ch.profile_stats() == {}
+    assert ch.profile()
+
+def test_profile_error():
+    """Test a failing call is still counted."""
+    ch.profile_reset()
+    ch.profile(True)
+    with pytest.raises(Exception):
+        ch.add(np.ones(3), np.ones(4))
+    assert ch.profile_stats()['add']['calls'] >= 1
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -0,0 +1,86 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+sizes = [1, 2, 1000, 100_001]
+
+@pytest.fixture(params=sizes)
+def data(request):
+    """Generate heavy-tailed data with repeated values."""
+    n = request.param
+    rng = np.random.default_rng(0)
+    x = np.round(rng.lognormal(0.0, 2.0, n), 2)
+    return {
+        'float32': x.astype(np.float32),
+        'float64': x
+    }
+
+def test_median(data):
+    """Test median matches numpy exactly."""
+    for dtype in ['float32', 'float64']:
+        x = data[dtype]
+        assert np.isclose(ch.median(x), np.median(x), rtol=1e-6)
+
+def test_quantile(data):
+    """Test several quantiles from one call match numpy's linear method."""
+    qs = [0.0, 0.5, 0.95, 0.99, 1.0]
+    for dtype in ['float32', 'float64']:
+        x = data[dtype]
+        res = ch.quantile(x, qs)
+        assert res.shape == (len(qs),)
+        assert np.allclose(res, np.quantile(x, qs), rtol=1e-5)
+        assert np.isclose(ch.quantile(x, 0.95), np.quantile(x, 0.95), rtol=1e-5)
+
+def test_percentile(data):
+    """Test percentiles are quantiles scaled by 100."""
+    x = data['float64']
+    assert np.allclose(ch.percentile(x, [50, 95, 99]), np.percentile(x, [50, 95, 99]))
+    assert np.isclose(ch.percentile(x, 99), np.percentile(x, 99))
+
+def test_axis():
+    """Test reduction along each axis of a 3D array."""
+    x = np.random.default_rng(1).normal(size=(4, 37, 6))
+    for axis in [0, 1, 2, -1]:
+        assert np.allclose(ch.median(x, axis), np.median(x, axis=axis))
+        res = ch.quantile(x, [0.1, 0.9], axis=axis)
+        assert np.allclose(res, np.quantile(x, [0.1, 0.9], axis=axis))
+
+def test_exact_patterns():
+    """Test exact mode on sorted, reversed, constant and few-valued inputs."""
+    n = 100_003
+    rng = np.random.default_rng(3)
+    qs = [0.0, 0.01, 0.5, 0.99, 1.0]
+    for x in [np.arange(n, dtype=np.float64), np.arange(n, 0, -1, dtype=np.float64),
+              np.full(n, 7.0), rng.integers(0, 5, n).astype(np.float64)]:
+        for dtype in [np.float32, np.float64]:
+            xd = x.astype(dtype)
+            assert np.allclose(ch.quantile(xd, qs), np.quantile(xd, qs), rtol=1e-6)
+        y = x.reshape(-1, 1)[:100_000].reshape(1000, 100)
+        assert np.allclose(ch.quantile(y, qs, axis=0), np.quantile(y, qs, axis=0), rtol=1e-6)
+
+def test_approx():
+    """Test the histogram mode stays within its resolution on a large array."""
+    x = np.random.default_rng(2).lognormal(0.0, 1.0, 3_000_000)
+    qs = [0.5, 0.95, 0.99]
+    res = ch.quantile(x, qs, method="approx")
+    span = x.max() - x.min()
+    assert np.all(np.abs(res - np.quantile(x, qs)) <= span / 4096**2 * 4)
+
+def test_nan_and_errors():
+    """Test NaN propagates and invalid arguments raise."""
+    x = np.array([1.0, np.nan, 3.0])
+    assert np.isnan(ch.median(x))
+    with pytest.raises(Exception):
+        ch.quantile(np.ones(4), [1.5])
+    with pytest.raises(Exception):
+        ch.median(np.ones((2, 2)), 2)
+    with pytest.raises(RuntimeError, match=r"\[0, 100\]"):
+        ch.percentile(np.ones(4), [150])
+    with pytest.raises(RuntimeError, match=r"\[0, 100\]"):
+        ch.percentile(np.ones(4), -1)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -0,0 +1,84 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+sizes = [1, 1000, 1_000_003]
+
+@pytest.fixture(params=sizes)
+def buffers(request):
+    """Allocate output buffers of each dtype."""
+    n = request.param
+    return {
+        'float32': np.empty(n, dtype=np.float32),
+        'float64': np.empty(n, dtype=np.float64)
+    }
+
+def test_uniform(buffers):
+    """Test uniform samples lie in [low, high) and have the right moments."""
+    for dtype in ['float32', 'float64']:
+        out = buffers[dtype]
+        ch.random.uniform(out, -1.0, 3.0, seed=42)
+        assert np.all(out >= -1.0) and np.all(out < 3.0)
+        if out.size > 10000:
+            assert np.isclose(out.mean(), 1.0, atol=1e-2)
+            assert np.isclose(out.var(), 16.0 / 12.0, rtol=RTOL)
+
+def test_normal(buffers):
+    """Test normal samples are finite with the requested mean and std."""
+    for dtype in ['float32', 'float64']:
+        out = buffers[dtype]
+        ch.random.normal(out, 2.0, 0.5, seed=7)
+        assert np.all(np.isfinite(out))
+        if out.size > 10000:
+            assert np.isclose(out.mean(), 2.0, atol=1e-2)
+            assert np.isclose(out.std(), 0.5, rtol=RTOL)
+
+def test_bernoulli(buffers):
+    """Test bernoulli samples are 0/1 with frequency p."""
+    for dtype in ['float32', 'float64']:
+        out = buffers[dtype]
+        ch.random.bernoulli(out, 0.3, seed=1)
+        assert np.all((out == 0) | (out == 1))
+        if out.size > 10000:
+            assert np.isclose(out.mean(), 0.3, atol=1e-2)
+
+def test_reproducible_and_offset():
+    """Test a seed gives the same stream and offsets index into it."""
+    for fill in [ch.random.uniform, ch.random.normal]:
+        a = np.empty(100_000)
+        b = np.empty(100_000)
+        fill(a, seed=3)
+        fill(b, seed=3)
+        assert np.array_equal(a, b)
+        c = np.empty(50_000)
+        fill(c, seed=3, offset=12345)
+        assert np.array_equal(c, a[12345:62345])
+        fill(b, seed=4)
+        assert not np.array_equal(a, b)
+
+def test_fills_any_shape():
+    """Test buffers of any contiguous shape are filled."""
+    out = np.zeros((64, 33), dtype=np.float32)
+    ch.random.uniform(out, seed=5)
+    flat = np.empty(64 * 33, dtype=np.float32)
+    ch.random.uniform(flat, seed=5)
+    assert np.array_equal(out.ravel(), flat)
+
+def test_dropout():
+    """Test dropout keeps a 1 - p fraction scaled by 1 / (1 - p)."""
+    for dtype in [np.float32, np.float64]:
+        x = np.ones(200_000, dtype=dtype)
+        y = ch.dropout(x, 0.25, seed=9)
+        assert y.dtype == x.dtype
+        kept = y != 0
+        assert np.allclose(y[kept], 1.0 / 0.75, rtol=RTOL, atol=ATOL)
+        assert np.isclose(kept.mean(), 0.75, atol=1e-2)
+        assert np.array_equal(y, ch.dropout(x, 0.25, seed=9))
+    with pytest.raises(Exception):
+        ch.dropout(np.ones(4), 1.0)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -132,5 +132,22 @@ def test_reduce_edge_cases():
     except AttributeError:
         pass
 
+def test_reduce_prod():
+    """Test product reduction, including lengths that leave a masked tail."""
+    for dtype in [np.float32, np.float64]:
+        for size in [1, 3, 8, 17, 63]:
+            arr = np.random.uniform(0.9, 1.1, size).astype(dtype)
+            assert np.allclose(np.prod(arr), ch.reduce_prod(arr), rtol=1e-4)
+
+def test_reduce_large():
+    """Test reductions split across threads and misaligned views."""
+    arr = np.random.uniform(-10.0, 10.0, 3_000_001)
+    for a in [arr, arr[1:], arr.astype(np.float32)[3:]]:
+        a64 = a.astype(np.float64)
+        assert np.isclose(ch.reduce_sum(a), a64.sum(), rtol=1e-4, atol=1e-2)
+        assert ch.reduce_min(a) == a.min()
+        assert ch.reduce_max(a) == a.max()
+        assert np.isclose(ch.reduce_var(a), a64.var(), rtol=1e-4)
+
 if __name__ == "__main__":
     pytest.main(["-xvs", __file__])
\ No newline at end of file
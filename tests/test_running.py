@@ -0,0 +1,120 @@
+import pickle
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+sizes = [(1, 1), (1000, 7), (30_011, 64)]
+
+@pytest.fixture(params=sizes)
+def data(request):
+    """Generate shifted normal samples in each dtype."""
+    n, d = request.param
+    x = np.random.default_rng(0).normal(100.0, 3.0, (n, d))
+    return {
+        'float32': x.astype(np.float32),
+        'float64': x
+    }
+
+def check(res, x, ddof=0):
+    """Compare a RunningStats result against numpy."""
+    x64 = x.astype(np.float64)
+    assert res["count"] == x.shape[0]
+    assert np.allclose(res["mean"], x64.mean(axis=0), rtol=1e-6, atol=ATOL)
+    assert np.allclose(res["var"], x64.var(axis=0, ddof=ddof), rtol=1e-4, atol=ATOL)
+    assert np.allclose(res["std"], x64.std(axis=0, ddof=ddof), rtol=1e-4, atol=ATOL)
+    assert np.allclose(res["sum"], x64.sum(axis=0), rtol=1e-6, atol=ATOL)
+    assert np.array_equal(res["min"], x64.min(axis=0))
+    assert np.array_equal(res["max"], x64.max(axis=0))
+
+def test_running_one_shot(data):
+    """Test a single batch against numpy."""
+    for dtype in ['float32', 'float64']:
+        x = data[dtype]
+        rs = ch.RunningStats(x.shape[1])
+        rs.update(x)
+        check(rs.result(), x)
+
+def test_running_batches(data):
+    """Test uneven batches, including single samples, against numpy."""
+    for dtype in ['float32', 'float64']:
+        x = data[dtype]
+        rs = ch.RunningStats(x.shape[1])
+        bounds = [0, 1, 2, 300, 1000, x.shape[0]]
+        for a, b in zip(bounds[:-1], bounds[1:]):
+            if a < min(b, x.shape[0]):
+                rs.update(x[a:b])
+        rs.update(x[0])
+        check(rs.result(), np.vstack([x, x[:1]]))
+
+def test_running_merge(data):
+    """Test that merging split accumulators matches one pass."""
+    for dtype in ['float32', 'float64']:
+        x = data[dtype]
+        half = x.shape[0] // 2
+        a = ch.RunningStats(x.shape[1])
+        b = ch.RunningStats(x.shape[1])
+        if half:
+            a.update(x[:half])
+        b.update(x[half:])
+        a.merge(b)
+        check(a.result(), x)
+
+def test_running_ddof(data):
+    """Test the sample variance."""
+    x = data['float64']
+    if x.shape[0] < 2:
+        pytest.skip("needs two samples")
+    rs = ch.RunningStats(x.shape[1])
+    rs.update(x)
+    check(rs.result(ddof=1), x, ddof=1)
+
+def test_running_state(data):
+    """Test checkpointing through state/from_state and pickle."""
+    x = data['float64']
+    rs = ch.RunningStats(x.shape[1])
+    rs.update(x)
+    for restored in (ch.RunningStats.from_state(rs.state()), pickle.loads(pickle.dumps(rs))):
+        assert restored.dim == rs.dim
+        assert restored.count == rs.count
+        restored.update(x)
+        check(restored.result(), np.vstack([x, x]))
+
+def test_running_nan():
+    """Test that a NaN in a column makes its min and max NaN, as in numpy."""
+    for dtype in [np.float32, np.float64]:
+        x = np.ones((5000, 13), dtype=dtype)
+        x[1234, 2] = np.nan
+        x[4321, 12] = np.nan
+        rs = ch.RunningStats(13)
+        rs.update(x[:2000])
+        rs.update(x[2000:])
+        out = rs.result()
+        assert np.array_equal(np.isnan(out["min"]), np.isnan(x.min(axis=0)))
+        assert np.array_equal(np.isnan(out["max"]), np.isnan(x.max(axis=0)))
+
+def test_running_concurrent_updates():
+    """Test updates from several threads at once count every row."""
+    from concurrent.futures import ThreadPoolExecutor
+    x = np.random.default_rng(3).random((20_000, 8))
+    rs = ch.RunningStats(8)
+    with ThreadPoolExecutor(4) as pool:
+        list(pool.map(rs.update, [x] * 8))
+    check(rs.result(), np.vstack([x] * 8))
+
+def test_running_errors():
+    """Test shape and dimension checks."""
+    rs = ch.RunningStats(3)
+    with pytest.raises(RuntimeError):
+        rs.update(np.zeros((4, 2)))
+    with pytest.raises(RuntimeError):
+        rs.merge(ch.RunningStats(2))
+    with pytest.raises(RuntimeError):
+        rs.result()
+    with pytest.raises(RuntimeError):
+        ch.RunningStats(0)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -0,0 +1,98 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+sizes = [1, 1000, 3_000_001]
+
+@pytest.fixture(params=sizes)
+def data(request):
+    """Generate normal samples in each dtype."""
+    n = request.param
+    x = np.random.default_rng(0).normal(3.0, 2.0, n)
+    return {
+        'float32': x.astype(np.float32),
+        'float64': x
+    }
+
+ALL_OPS = ["sum", "mean", "var", "std", "min", "max", "argmin", "argmax", "count"]
+
+def check(stats, x):
+    """Compare a stream.reduce result against numpy."""
+    x64 = x.astype(np.float64)
+    assert np.isclose(stats["sum"], x64.sum(), rtol=1e-5, atol=ATOL)
+    assert np.isclose(stats["mean"], x64.mean(), rtol=1e-5, atol=ATOL)
+    assert np.isclose(stats["var"], x64.var(), rtol=1e-4, atol=ATOL)
+    assert np.isclose(stats["std"], x64.std(), rtol=1e-4, atol=ATOL)
+    assert stats["min"] == x.min()
+    assert stats["max"] == x.max()
+    assert stats["argmin"] == np.argmin(x)
+    assert stats["argmax"] == np.argmax(x)
+    assert stats["count"] == x.size
+
+def test_stream_path(data, tmp_path):
+    """Test reducing a raw file from its path in small chunks."""
+    for dtype in ['float32', 'float64']:
+        x = data[dtype]
+        path = tmp_path / f"x_{dtype}.bin"
+        x.tofile(path)
+        check(ch.stream.reduce(str(path), ops=ALL_OPS, dtype=dtype, chunk_bytes=1 << 16), x)
+        check(ch.stream.reduce(path, ops=ALL_OPS, dtype=dtype), x)
+
+def test_stream_offset(data, tmp_path):
+    """Test a header before the data is skipped."""
+    x = data['float32']
+    path = tmp_path / "with_header.bin"
+    with open(path, "wb") as f:
+        f.write(b"\x01" * 12)
+        f.write(x.tobytes())
+    check(ch.stream.reduce(path, ops=ALL_OPS, dtype='float32', offset=12, chunk_bytes=8192), x)
+
+def test_stream_memmap(data, tmp_path):
+    """Test np.memmap and in-memory arrays give the same results."""
+    for dtype in ['float32', 'float64']:
+        x = data[dtype]
+        path = tmp_path / f"m_{dtype}.bin"
+        x.tofile(path)
+        mm = np.memmap(path, dtype=dtype, mode='r')
+        check(ch.stream.reduce(mm, ops=ALL_OPS, chunk_bytes=1 << 16), x)
+        check(ch.stream.reduce(x, ops=ALL_OPS), x)
+        assert np.array_equal(np.asarray(mm), x)
+
+def test_stream_default_ops(data):
+    """Test the default ops are sum, mean, min and max."""
+    stats = ch.stream.reduce(data['float64'])
+    assert set(stats) == {"sum", "mean", "min", "max"}
+
+def test_stream_nan(data):
+    """Test NaN propagates to min and max, with argmin/argmax at the first NaN."""
+    for dtype in ['float32', 'float64']:
+        x = data[dtype].copy()
+        nans = [x.size - 1, x.size // 2]
+        x[nans] = np.nan
+        stats = ch.stream.reduce(x, ops=ALL_OPS, chunk_bytes=8192)
+        for op in ["sum", "mean", "var", "std", "min", "max"]:
+            assert np.isnan(stats[op])
+        assert stats["argmin"] == np.argmin(x) == min(nans)
+        assert stats["argmax"] == np.argmax(x) == min(nans)
+        assert stats["count"] == x.size
+
+def test_stream_errors(tmp_path):
+    """Test invalid ops, dtypes and sizes are rejected."""
+    path = tmp_path / "odd.bin"
+    path.write_bytes(b"\x00" * 6)
+    with pytest.raises(Exception):
+        ch.stream.reduce(str(path), dtype='float32')
+    with pytest.raises(Exception):
+        ch.stream.reduce(str(path))
+    with pytest.raises(Exception):
+        ch.stream.reduce(np.ones(4), ops=["median"])
+    with pytest.raises(Exception):
+        ch.stream.reduce(np.ones(4, dtype=np.int32))
+    with pytest.raises(Exception):
+        ch.stream.reduce(np.ones(4), dtype='float32')
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
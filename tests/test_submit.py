@@ -0,0 +1,81 @@
+import asyncio
+import time
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+def test_submit_fast_ops():
+    """Test that futures of fast-path ops resolve to the synchronous results."""
+    for dtype in [np.float32, np.float64]:
+        a = np.random.uniform(0.1, 10.0, 100_001).astype(dtype)
+        b = np.random.uniform(0.1, 10.0, 100_001).astype(dtype)
+        add = ch.submit(ch.add, a, b)
+        log = ch.submit("log", a)
+        total = ch.submit(ch.reduce_sum, a)
+        idx = ch.submit(ch.argmax, a)
+        d = ch.submit(ch.dot, a, b)
+        assert np.allclose(add.result(), a + b, rtol=RTOL, atol=ATOL)
+        assert add.result().dtype == dtype
+        assert np.allclose(log.result(), np.log(a), rtol=RTOL, atol=ATOL)
+        assert np.isclose(total.result(), a.sum(), rtol=RTOL, atol=ATOL)
+        assert idx.result() == np.argmax(a)
+        assert np.isclose(d.result(), np.dot(a, b), rtol=RTOL, atol=ATOL)
+
+def test_submit_other_ops():
+    """Test ops without a fast path, keyword arguments and temporaries."""
+    A = np.random.uniform(-1.0, 1.0, (64, 32))
+    mm = ch.submit(ch.matmul, A, A.T.copy())
+    clipped = ch.submit(ch.clip, A, -0.5, 0.5)
+    # the only reference to the input is held by the task
+    tmp = ch.submit(ch.sqrt, np.full(10_000, 4.0))
+    assert np.allclose(mm.result(), A @ A.T, rtol=RTOL, atol=ATOL)
+    assert np.array_equal(clipped.result(), np.clip(A, -0.5, 0.5))
+    assert np.allclose(tmp.result(), 2.0)
+
+def test_submit_releases_gil():
+    """Test that Python keeps running while a large matmul future is pending."""
+    A = np.random.uniform(-1.0, 1.0, (2000, 2000))
+    start = time.perf_counter()
+    fut = ch.submit(ch.matmul, A, A)
+    # with the GIL held by the op, the loop would stall for the whole product
+    last, gap, ticks = start, 0.0, 0
+    while not fut.done():
+        now = time.perf_counter()
+        gap, last = max(gap, now - last), now
+        ticks += 1
+    elapsed = time.perf_counter() - start
+    assert np.allclose(fut.result(), A @ A, rtol=RTOL, atol=ATOL)
+    assert ticks > 1
+    assert gap < 0.5 * elapsed
+
+def test_submit_errors():
+    """Test that errors surface through the future or at submission."""
+    fut = ch.submit(ch.maximum, np.zeros(3), np.zeros(4))
+    with pytest.raises(Exception):
+        fut.result()
+    with pytest.raises(Exception):
+        ch.submit(ch.add, np.zeros(3), np.zeros(4))
+
+def test_submit_order():
+    """Test that many queued submissions all resolve correctly."""
+    xs = [np.random.uniform(-1.0, 1.0, 1000) for _ in range(200)]
+    futures = [ch.submit(ch.reduce_max, x) for x in xs]
+    assert [f.result() for f in futures] == [x.max() for x in xs]
+
+def test_asubmit():
+    """Test awaiting submissions from an asyncio event loop."""
+    a = np.random.uniform(-1.0, 1.0, 500_000)
+
+    async def main():
+        results = await asyncio.gather(ch.asubmit(ch.exp, a), ch.asubmit("reduce_sum", a))
+        return results
+
+    e, s = asyncio.run(main())
+    assert np.allclose(e, np.exp(a), rtol=RTOL, atol=ATOL)
+    assert np.isclose(s, a.sum(), rtol=RTOL, atol=ATOL)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
@@ -0,0 +1,98 @@
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+sizes = [1, 7, 1000, 10001]
+
+@pytest.fixture(params=sizes)
+def test_arrays(request):
+    """Generate test arrays and a mask of various sizes."""
+    size = request.param
+    rng = np.random.default_rng(size)
+    x = rng.uniform(-10.0, 10.0, (3, size))
+    return {
+        'float32': x.astype(np.float32),
+        'float64': x,
+        'mask': rng.uniform(size=size) < 0.5
+    }
+
+def test_fma(test_arrays):
+    """Test a * b + c with array and scalar operands."""
+    for dtype in ['float32', 'float64']:
+        a, b, c = test_arrays[dtype]
+        assert np.allclose(ch.fma(a, b, c), a * b + c, rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.fma(a, 2.0, c), a * 2.0 + c, rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.fma(a, b, 1.5), a * b + 1.5, rtol=RTOL, atol=ATOL)
+        assert ch.fma(a, b, c).dtype == a.dtype
+
+def test_clip(test_arrays):
+    """Test clipping to scalar and per-element bounds."""
+    for dtype in ['float32', 'float64']:
+        x, lo, _ = test_arrays[dtype]
+        assert np.array_equal(ch.clip(x, -1.0, 1.0), np.clip(x, -1.0, 1.0))
+        assert np.array_equal(ch.clip(x, lo, 5.0), np.clip(x, lo, 5.0))
+
+def test_where(test_arrays):
+    """Test selection by a boolean mask."""
+    mask = test_arrays['mask']
+    for dtype in ['float32', 'float64']:
+        a, b, _ = test_arrays[dtype]
+        assert np.array_equal(ch.where(mask, a, b), np.where(mask, a, b))
+        assert np.array_equal(ch.where(mask, a, 0.0), np.where(mask, a, 0.0).astype(a.dtype))
+
+def test_lerp(test_arrays):
+    """Test linear interpolation with scalar and array weights."""
+    for dtype in ['float32', 'float64']:
+        a, b, t = test_arrays[dtype]
+        assert np.allclose(ch.lerp(a, b, 0.25), a + 0.25 * (b - a), rtol=RTOL, atol=ATOL)
+        assert np.allclose(ch.lerp(a, b, t), a + t * (b - a), rtol=RTOL, atol=ATOL)
+
+def test_maximum_minimum(test_arrays):
+    """Test element-wise maximum and minimum."""
+    for dtype in ['float32', 'float64']:
+        a, b, _ = test_arrays[dtype]
+        assert np.array_equal(ch.maximum(a, b), np.maximum(a, b))
+        assert np.array_equal(ch.minimum(a, b), np.minimum(a, b))
+        assert np.array_equal(ch.maximum(a, 0.0), np.maximum(a, 0.0).astype(a.dtype))
+
+def test_int_scalars(test_arrays):
+    """Test that Python int scalars keep the array dtype and value."""
+    for dtype in ['float32', 'float64']:
+        a, b, _ = test_arrays[dtype]
+        # 2**24 + 1 is not a float32, so a downcast would show in the values
+        big = 2**24 + 1
+        clipped = ch.clip(a, 0, 1)
+        assert clipped.dtype == a.dtype
+        assert np.array_equal(clipped, np.clip(a, 0, 1).astype(a.dtype))
+        top = ch.maximum(a, -3)
+        assert top.dtype == a.dtype
+        assert np.array_equal(top, np.maximum(a, -3).astype(a.dtype))
+        fused = ch.fma(a, 2, big)
+        assert fused.dtype == a.dtype
+        if dtype == 'float64':
+            assert np.array_equal(fused, a * 2 + big)
+        assert np.allclose(ch.fma(a, b, 1), a * b + 1, rtol=RTOL, atol=ATOL)
+        assert ch.clip(a, False, True).dtype == a.dtype
+
+def test_nan_propagation():
+    """Test that NaN propagates like numpy."""
+    a = np.array([np.nan, 1.0, 2.0, np.nan, 5.0])
+    b = np.array([1.0, np.nan, 3.0, np.nan, 4.0])
+    assert np.array_equal(ch.maximum(a, b), np.maximum(a, b), equal_nan=True)
+    assert np.array_equal(ch.minimum(a, b), np.minimum(a, b), equal_nan=True)
+    assert np.array_equal(ch.clip(a, 0.0, 3.0), np.clip(a, 0.0, 3.0), equal_nan=True)
+
+def test_shapes():
+    """Test that results keep the operand shape and mismatches raise."""
+    x = np.random.uniform(-1.0, 1.0, (4, 5))
+    assert ch.clip(x, 0.0, 0.5).shape == (4, 5)
+    with pytest.raises(Exception):
+        ch.maximum(x, np.zeros(3))
+    with pytest.raises(Exception):
+        ch.fma(1.0, 2.0, 3.0)
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])
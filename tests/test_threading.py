@@ -0,0 +1,164 @@
+import os
+import signal
+import threading
+import time
+import numpy as np
+import capnhook_ml as ch
+import pytest
+
+RTOL = 1e-2
+ATOL = 1e-4
+
+@pytest.fixture
+def restore_threads():
+    """Restore the default thread count after a test."""
+    yield
+    ch.set_num_threads(0)
+    ch.set_thread_pinning(False)
+
+def test_set_num_threads(restore_threads):
+    """Test that the thread count round-trips and 0 restores the default."""
+    default = ch.get_num_threads()
+    assert default >= 1
+    assert ch.set_num_threads(2) == default
+    assert ch.get_num_threads() == 2
+    assert ch.set_num_threads(0) == 2
+    assert ch.get_num_threads() == default
+
+def test_results_independent_of_threads(restore_threads):
+    """Test that kernels agree on one thread and on many."""
+    x = np.random.uniform(-10.0, 10.0, 3_000_001)
+    A = np.random.uniform(-1.0, 1.0, (300, 200))
+    results = []
+    for n in [1, 4]:
+        ch.set_num_threads(n)
+        results.append((ch.reduce_sum(x), ch.reduce_max(x), ch.add(x, x), ch.matmul(A, A.T)))
+    (s1, m1, a1, c1), (s4, m4, a4, c4) = results
+    assert np.isclose(s1, s4, rtol=1e-6, atol=ATOL)
+    assert m1 == m4
+    assert np.array_equal(a1, a4)
+    assert np.allclose(c1, c4, rtol=RTOL, atol=ATOL)
+
+def test_pinning(restore_threads):
+    """Test that pinning can be toggled without changing results."""
+    x = np.random.uniform(-10.0, 10.0, 1_000_001)
+    assert ch.set_thread_pinning(True) is False
+    assert np.isclose(ch.reduce_sum(x), x.sum(), rtol=1e-4, atol=1e-2)
+    assert ch.set_thread_pinning(False) is True
+
+def test_concurrent_callers(restore_threads):
+    """Test kernels and BLAS running at once from several threads without the GIL."""
+    ch.set_num_threads(4)
+    rng = np.random.default_rng(5)
+    A = rng.uniform(-1.0, 1.0, (512, 512))
+    x = rng.uniform(-10.0, 10.0, 4_000_001)
+    expected_mm = A @ A
+    expected_sum = x.sum()
+    barrier = threading.Barrier(5)
+    errors = []
+
+    def work(i):
+        # each thread enters through a GIL-free path: stream.reduce and the
+        # heavy ops release it around their compute, submit runs fast-path
+        # kernels on the executor thread
+        try:
+            barrier.wait()
+            for _ in range(5):
+                if i % 2 == 0:
+                    stats = ch.stream.reduce(x, ["sum", "max"], chunk_bytes=1 << 20)
+                    assert np.isclose(stats["sum"], expected_sum, rtol=1e-4, atol=1e-2)
+                    assert stats["max"] == x.max()
+                else:
+                    assert np.allclose(ch.matmul(A, A), expected_mm, rtol=RTOL, atol=ATOL)
+                total = ch.submit(ch.reduce_sum, x).result()
+                assert np.isclose(total, expected_sum, rtol=1e-4, atol=1e-2)
+        except Exception as e:
+            errors.append(e)
+
+    ch.profile(True)
+    ch.profile_reset()
+    try:
+        # timed from before any call can start
+        start = time.perf_counter()
+        threads = [threading.Thread(target=work, args=(i,)) for i in range(4)]
+        for t in threads:
+            t.start()
+        # the main thread multiplies alongside, contending for the pool and BLAS
+        barrier.wait()
+        for _ in range(5):
+            assert np.allclose(ch.matmul(A, A), expected_mm, rtol=RTOL, atol=ATOL)
+        for t in threads:
+            t.join()
+        wall = time.perf_counter() - start
+        stats = ch.profile_stats()
+    finally:
+        ch.profile(False)
+        ch.profile_reset()
+    assert not errors
+    # the profiler times each call between entering and leaving the binding,
+    # both under the GIL; ops holding it throughout would give disjoint
+    # intervals summing to less than the wall time
+    busy = stats["stream.reduce"]["total_s"] + stats["matmul"]["total_s"]
+    assert stats["stream.reduce"]["calls"] == 10 and stats["matmul"]["calls"] == 15
+    assert busy > wall
+
+def test_set_num_threads_during_loops(restore_threads):
+    """Test changing the thread count while GIL-free loops size per-thread state."""
+    rng = np.random.default_rng(6)
+    x = rng.uniform(-10.0, 10.0, 2_000_001)
+    expected_sum = x.sum()
+    expected_counts = np.histogram(x, 64)[0]
+    stop = threading.Event()
+
+    def toggle():
+        # grows the budget between a loop sizing its buffers and running
+        while not stop.is_set():
+            for n in [1, 32, 3]:
+                ch.set_num_threads(n)
+
+    toggler = threading.Thread(target=toggle)
+    toggler.start()
+    try:
+        for _ in range(50):
+            futures = [ch.submit(ch.reduce_sum, x) for _ in range(4)]
+            counts, _ = ch.histogram(x, 64)
+            assert np.abs(counts - expected_counts).sum() <= 2
+            for f in futures:
+                assert np.isclose(f.result(), expected_sum, rtol=1e-4, atol=1e-2)
+    finally:
+        stop.set()
+        toggler.join()
+
+@pytest.mark.skipif(not hasattr(os, "fork"), reason="needs os.fork")
+def test_fork(restore_threads):
+    """Test parallel ops and submit in a child forked with the pool running."""
+    ch.set_num_threads(4)
+    x = np.random.default_rng(7).uniform(-10.0, 10.0, 2_000_001)
+    expected = x.sum()
+    # start the workers and the executor before forking
+    assert np.isclose(ch.submit(ch.reduce_sum, x).result(), expected, rtol=1e-4, atol=1e-2)
+    assert np.isclose(ch.stream.reduce(x)["sum"], expected, rtol=1e-4, atol=1e-2)
+    pid = os.fork()
+    if pid == 0:
+        ok = False
+        try:
+            ok = (np.isclose(ch.reduce_sum(x), expected, rtol=1e-4, atol=1e-2)
+                  and np.isclose(ch.stream.reduce(x)["sum"], expected, rtol=1e-4, atol=1e-2)
+                  and np.isclose(ch.submit(ch.reduce_sum, x).result(timeout=30), expected, rtol=1e-4, atol=1e-2))
+        finally:
+            os._exit(0 if ok else 1)
+    # a child stuck on the parent's workers never exits
+    deadline = time.monotonic() + 60
+    while True:
+        done, status = os.waitpid(pid, os.WNOHANG)
+        if done:
+            break
+        if time.monotonic() > deadline:
+            os.kill(pid, signal.SIGKILL)
+            os.waitpid(pid, 0)
+            pytest.fail("forked child hung")
+        time.sleep(0.05)
+    assert os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0
+
+if __name__ == "__main__":
+    pytest.main(["-xvs", __file__])